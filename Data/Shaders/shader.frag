@@ -42,11 +42,6 @@ layout(std140, binding = 0) uniform UniformBufferObject
     Light lights[8];
 } ubo;
 
-layout(std140, push_constant) uniform UniformPushConstant 
-{
-    mat4 model;
-} upc;
-
 layout(binding = 1) uniform sampler2D texSampler;
 
 layout(location = 0) in vec3 fragPos;
@@ -42,10 +42,36 @@ layout(std140, binding = 0) uniform UniformBufferObject
     Light lights[8];
 } ubo;
 
-layout(std140, push_constant) uniform UniformPushConstant 
+// InstanceLod - see Renderer.h
+struct InstanceLod
 {
-    mat4 model;
-} upc;
+    uint  firstIndex;
+    uint  indexCount;
+    float error;
+    uint  padding;
+};
+
+// InstanceData - see Renderer.h, the draw n reads the instance n
+struct InstanceData
+{
+    mat4  model;
+    vec4  positionScale;
+    vec4  positionOffset;
+    vec4  boundingSphere;
+
+    uint  materialIndex;
+    int   vertexOffset;
+    uint  lodCount;
+    uint  drawGroup;
+    uint  drawGroupStart;
+
+    InstanceLod lods[5];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -64,10 +90,12 @@ out gl_PerVertex
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * upc.model * vec4(inPosition, 1.0);
+    mat4 model = instances[gl_InstanceIndex].model;
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
 
     fragColor = inColor;
     fragTexCoord = inTexCoord;
-    fragNormal = mat3(transpose(inverse(upc.model))) * inNormal;
-    fragPos = (upc.model * vec4(inPosition, 1.0)).xyz;
+    fragNormal = mat3(transpose(inverse(model))) * inNormal;
+    fragPos = (model * vec4(inPosition, 1.0)).xyz;
 }
@@ -0,0 +1,121 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+const int LightType_Directional = 0;
+const int LightType_Point = 1;
+const int LightType_Spot = 2;
+const int LightType_Area = 3;
+
+struct Light
+{
+    vec3  position;
+    int   type;
+
+    vec3  direction;
+    float range;
+          
+    vec3  color;
+    float intensity;
+          
+    float innerAngle;
+    float outerAngle;
+};
+
+layout(std140, binding = 0) uniform UniformBufferObject
+{
+    mat4 view;
+    mat4 proj;
+    vec3 cameraPosition;
+    
+    float ambientLightIntensity;
+    vec3  ambientLightColor;
+    
+    float directionalLightIntensity;
+    vec3  directionalLightColor;
+    vec3  directionalLightDirection;
+
+    vec3  materialColor;
+    vec3  materialSpecularColor;
+    float materialRoughness;
+
+    int   lightCount;
+    Light lights[8];
+} ubo;
+
+// InstanceLod - see Renderer.h
+struct InstanceLod
+{
+    uint  firstIndex;
+    uint  indexCount;
+    float error;
+    uint  padding;
+};
+
+// InstanceData - see Renderer.h, the draw n reads the instance n
+struct InstanceData
+{
+    mat4  model;
+    vec4  positionScale;
+    vec4  positionOffset;
+    vec4  boundingSphere;
+
+    uint  materialIndex;
+    int   vertexOffset;
+    uint  lodCount;
+    uint  drawGroup;
+    uint  drawGroupStart;
+
+    InstanceLod lods[5];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
+
+// PackedVertex - see Scene.h
+layout(location = 0) in uvec4 inPosition;   // xyz - unorm16 relative to the model bounds, w - RGB565 color
+layout(location = 1) in vec2  inTexCoord;
+layout(location = 2) in vec2  inNormal;     // octahedral encoded
+
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec3 fragColor;
+layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) out vec3 fragNormal;
+
+out gl_PerVertex
+{
+    vec4 gl_Position;
+};
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+vec3 DecodeRGB565(uint color)
+{
+    return vec3((color >> 11) & 0x1Fu, (color >> 5) & 0x3Fu, color & 0x1Fu) / vec3(31.0, 63.0, 31.0);
+}
+
+void main()
+{
+    // only the members used, the levels of detail are for the cull pass
+    mat4 model = instances[gl_InstanceIndex].model;
+    vec4 positionScale = instances[gl_InstanceIndex].positionScale;
+    vec4 positionOffset = instances[gl_InstanceIndex].positionOffset;
+
+    vec3 position = vec3(inPosition.xyz) * positionScale.xyz + positionOffset.xyz;
+    vec3 normal = OctDecode(inNormal);
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(position, 1.0);
+
+    fragColor = DecodeRGB565(inPosition.w);
+    fragTexCoord = inTexCoord;
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    fragPos = (model * vec4(position, 1.0)).xyz;
+}
@@ -0,0 +1,182 @@
+#include "BoundingVolumes.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Positions are read with a 16 byte load, the 4th lane is the first float that follows them and is ignored
+static_assert(offsetof(Vertex, Position) + sizeof(float) * 4 <= sizeof(Vertex), "position load reads past the vertex");
+
+static inline glm::vec3 StoreVec3(__m128 value)
+{
+	float lanes[4];
+	_mm_storeu_ps(lanes, value);
+	return glm::vec3(lanes[0], lanes[1], lanes[2]);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                              Reduction                               //
+//////////////////////////////////////////////////////////////////////////
+// getPosition(i) returns the address of the i-th position, so the plain and the indexed variants share the same loops
+template <typename GetPosition>
+static Bounds ReduceBounds(size_t count, const GetPosition& getPosition)
+{
+	Bounds bounds;
+	if (count == 0)
+		return bounds;
+
+	// Box - four independent accumulators hide the latency of minps/maxps
+	__m128 min0 = _mm_loadu_ps(getPosition(0));
+	__m128 max0 = min0;
+	__m128 min1 = min0, max1 = min0;
+	__m128 min2 = min0, max2 = min0;
+	__m128 min3 = min0, max3 = min0;
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 p0 = _mm_loadu_ps(getPosition(i + 0));
+		const __m128 p1 = _mm_loadu_ps(getPosition(i + 1));
+		const __m128 p2 = _mm_loadu_ps(getPosition(i + 2));
+		const __m128 p3 = _mm_loadu_ps(getPosition(i + 3));
+
+		min0 = _mm_min_ps(min0, p0); max0 = _mm_max_ps(max0, p0);
+		min1 = _mm_min_ps(min1, p1); max1 = _mm_max_ps(max1, p1);
+		min2 = _mm_min_ps(min2, p2); max2 = _mm_max_ps(max2, p2);
+		min3 = _mm_min_ps(min3, p3); max3 = _mm_max_ps(max3, p3);
+	}
+	for (; i < count; ++i)
+	{
+		const __m128 p = _mm_loadu_ps(getPosition(i));
+		min0 = _mm_min_ps(min0, p);
+		max0 = _mm_max_ps(max0, p);
+	}
+
+	const __m128 boundsMin = _mm_min_ps(_mm_min_ps(min0, min1), _mm_min_ps(min2, min3));
+	const __m128 boundsMax = _mm_max_ps(_mm_max_ps(max0, max1), _mm_max_ps(max2, max3));
+
+	// Sphere - centered on the box, the radius is the farthest vertex which is tighter than the box corner.
+	// Four vertices are transposed to xxxx/yyyy/zzzz so one lane holds one squared distance.
+	const __m128 center = _mm_mul_ps(_mm_add_ps(boundsMin, boundsMax), _mm_set1_ps(0.5f));
+
+	__m128 maxDistance = _mm_setzero_ps();
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		__m128 d0 = _mm_sub_ps(_mm_loadu_ps(getPosition(i + 0)), center);
+		__m128 d1 = _mm_sub_ps(_mm_loadu_ps(getPosition(i + 1)), center);
+		__m128 d2 = _mm_sub_ps(_mm_loadu_ps(getPosition(i + 2)), center);
+		__m128 d3 = _mm_sub_ps(_mm_loadu_ps(getPosition(i + 3)), center);
+		_MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+
+		const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d0, d0), _mm_mul_ps(d1, d1)), _mm_mul_ps(d2, d2));
+		maxDistance = _mm_max_ps(maxDistance, distance);
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, maxDistance);
+	float radiusSquared = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+
+	const glm::vec3 sphereCenter = StoreVec3(center);
+	for (; i < count; ++i)
+	{
+		const float* position = getPosition(i);
+		const glm::vec3 d = glm::vec3(position[0], position[1], position[2]) - sphereCenter;
+		radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+	}
+
+	bounds.Min = StoreVec3(boundsMin);
+	bounds.Max = StoreVec3(boundsMax);
+	bounds.Sphere = glm::vec4(sphereCenter, std::sqrt(radiusSquared));
+	return bounds;
+}
+
+Bounds BoundingVolumes::Compute(const Vertex* vertices, size_t vertexCount)
+{
+	return ReduceBounds(vertexCount, [vertices](size_t i) { return &vertices[i].Position.x; });
+}
+
+Bounds BoundingVolumes::Compute(const Vertex* vertices, const uint32_t* indices, size_t indexCount)
+{
+	return ReduceBounds(indexCount, [vertices, indices](size_t i) { return &vertices[indices[i]].Position.x; });
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                              Transform                               //
+//////////////////////////////////////////////////////////////////////////
+Bounds BoundingVolumes::Transform(const Bounds& bounds, const glm::mat4& transform)
+{
+	const glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+	const glm::vec3 extent = (bounds.Max - bounds.Min) * 0.5f;
+
+	// Each world axis extent is the sum of the absolute contributions of the local axes
+	const glm::vec3 axisX = glm::vec3(transform[0]);
+	const glm::vec3 axisY = glm::vec3(transform[1]);
+	const glm::vec3 axisZ = glm::vec3(transform[2]);
+
+	const glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+	const glm::vec3 worldExtent = glm::abs(axisX) * extent.x + glm::abs(axisY) * extent.y + glm::abs(axisZ) * extent.z;
+
+	const float maxScale = std::sqrt(std::max(glm::dot(axisX, axisX), std::max(glm::dot(axisY, axisY), glm::dot(axisZ, axisZ))));
+
+	Bounds result;
+	result.Min = worldCenter - worldExtent;
+	result.Max = worldCenter + worldExtent;
+	result.Sphere = glm::vec4(glm::vec3(transform * glm::vec4(glm::vec3(bounds.Sphere), 1.0f)), bounds.Sphere.w * maxScale);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                Frustum                               //
+//////////////////////////////////////////////////////////////////////////
+void BoundingVolumes::FrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	const glm::vec4 rowW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const glm::vec4 row(viewProjection[0][axis], viewProjection[1][axis], viewProjection[2][axis], viewProjection[3][axis]);
+
+		// vulkan clip space depth is [0, w]
+		planes[axis * 2 + 0] = (axis == 2) ? row : rowW + row;
+		planes[axis * 2 + 1] = rowW - row;
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                 Model                                //
+//////////////////////////////////////////////////////////////////////////
+void BoundingVolumes::Build(Model& model)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	model.LocalBounds = Compute(model.Vertices.data(), model.Vertices.size());
+
+	for (Mesh& mesh : model.Meshs)
+	{
+		const size_t indexCount = size_t(mesh.TriangleCount) * 3;
+		Debug_Assert(size_t(mesh.IndexOffset) + indexCount <= model.Indices.size());
+		mesh.LocalBounds = Compute(model.Vertices.data(), model.Indices.data() + mesh.IndexOffset, indexCount);
+	}
+
+	const auto endTime = std::chrono::steady_clock::now();
+	const float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+
+	W::Logger::PrintFormat("BoundingVolumes - %s: %zu vertices %zu meshes in %.2f ms, radius %f\n",
+		model.Name.c_str(), model.Vertices.size(), model.Meshs.size(), milliseconds, model.LocalBounds.Sphere.w);
+}
+
+void Model::UpdateWorldBounds(const glm::mat4& worldTransform)
+{
+	WorldBounds = BoundingVolumes::Transform(LocalBounds, worldTransform);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Bounds;
+struct Vertex;
+struct Model;
+
+namespace BoundingVolumes
+{
+	// SIMD min/max reduction over the vertex positions, the sphere is centered on the box
+	Bounds Compute(const Vertex* vertices, size_t vertexCount);
+
+	// Same over the vertices referenced by an index range
+	Bounds Compute(const Vertex* vertices, const uint32_t* indices, size_t indexCount);
+
+	// Box of the transformed box (Arvo 1990) and the sphere scaled by the largest axis scale
+	Bounds Transform(const Bounds& bounds, const glm::mat4& transform);
+
+	// Normalized planes of the view frustum facing inward, left right bottom top near far. Vulkan clip space depth.
+	// A sphere is outside when dot(plane.xyz, center) + plane.w < -radius for any of them.
+	void FrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+	// Local bounds of the model and of the full resolution range of each Mesh
+	void Build(Model& model);
+} // namespace BoundingVolumes
@@ -0,0 +1,216 @@
+#include "DeviceMemory.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Graphics/Backend/Vk.Graphics.hpp>
+
+#include <algorithm>
+
+static const VkDeviceSize MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// One VkDeviceMemory and the TLSF allocator handing out its ranges
+struct DeviceMemoryBlock
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	void* MappedData = nullptr;
+	uint32_t MemoryTypeIndex = 0;
+	DeviceResourceType ResourceType = DeviceResourceType::Linear;
+	bool Dedicated = false;
+
+	W::TlsfAllocator Allocator;
+
+	explicit DeviceMemoryBlock(VkDeviceSize size)
+		: Allocator(size)
+	{
+	}
+};
+
+float DeviceMemoryAllocator::HeapStatistics::GetFragmentation() const
+{
+	const VkDeviceSize freeSize = BlockSize - UsedSize;
+	if (freeSize == 0)
+		return 0.0f;
+
+	return 1.0f - static_cast<float>(LargestFreeRange) / static_cast<float>(freeSize);
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+{
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+	Debug_Assert(mDevice == VK_NULL_HANDLE);
+}
+
+void DeviceMemoryAllocator::Startup(VkPhysicalDevice physicalDevice, VkDevice device)
+{
+	mDevice = device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemoryProperties);
+
+	// small heaps (the 256 MB device local and host visible window) are split finer so one block does not take all of it
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount; ++memoryTypeIndex)
+	{
+		const VkMemoryHeap& heap = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+		mBlockSizes[memoryTypeIndex] = std::min(MAX_BLOCK_SIZE, heap.size / 8);
+	}
+}
+
+void DeviceMemoryAllocator::Shutdown()
+{
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; ++memoryTypeIndex)
+	{
+		for (std::vector<std::unique_ptr<DeviceMemoryBlock>>& blocks : mBlocks[memoryTypeIndex])
+		{
+			for (std::unique_ptr<DeviceMemoryBlock>& block : blocks)
+			{
+				Debug_AssertMsg(block->Allocator.IsEmpty(), "%u device allocations were not freed", block->Allocator.GetAllocationCount());
+				vkFreeMemory(mDevice, block->Memory, nullptr);
+			}
+			blocks.clear();
+		}
+	}
+
+	mDeviceAllocationCount = 0;
+	mDevice = VK_NULL_HANDLE;
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) && (mMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	Debug_AssertMsg(false, "failed to find suitable memory type!");
+	return VK_MAX_MEMORY_TYPES;
+}
+
+DeviceAllocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, DeviceResourceType resourceType)
+{
+	const uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+	const bool hostVisible = (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::vector<std::unique_ptr<DeviceMemoryBlock>>& blocks = mBlocks[memoryTypeIndex][static_cast<size_t>(resourceType)];
+	const VkDeviceSize blockSize = mBlockSizes[memoryTypeIndex];
+	const bool dedicated = requirements.size > blockSize / 2;
+
+	DeviceAllocation allocation;
+	if (dedicated == false)
+	{
+		for (std::unique_ptr<DeviceMemoryBlock>& block : blocks)
+		{
+			if (block->Dedicated)
+				continue;
+
+			allocation.Range = block->Allocator.Allocate(requirements.size, requirements.alignment);
+			if (allocation.Range.IsValid())
+			{
+				allocation.Block = block.get();
+				break;
+			}
+		}
+	}
+
+	if (allocation.Block == nullptr)
+	{
+		std::unique_ptr<DeviceMemoryBlock> block(new DeviceMemoryBlock(dedicated ? requirements.size : blockSize));
+		block->MemoryTypeIndex = memoryTypeIndex;
+		block->ResourceType = resourceType;
+		block->Dedicated = dedicated;
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block->Allocator.GetSize();
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		VK_CHECK(vkAllocateMemory(mDevice, &allocInfo, nullptr, &block->Memory));
+		++mDeviceAllocationCount;
+
+		if (hostVisible)
+		{
+			VK_CHECK(vkMapMemory(mDevice, block->Memory, 0, VK_WHOLE_SIZE, 0, &block->MappedData));
+		}
+
+		allocation.Range = block->Allocator.Allocate(requirements.size, requirements.alignment);
+		Debug_Assert(allocation.Range.IsValid());
+
+		allocation.Block = block.get();
+		blocks.push_back(std::move(block));
+	}
+
+	allocation.Memory = allocation.Block->Memory;
+	allocation.Offset = allocation.Range.Offset;
+	allocation.Size = allocation.Range.Size;
+	if (allocation.Block->MappedData != nullptr)
+	{
+		allocation.MappedData = static_cast<uint8_t*>(allocation.Block->MappedData) + allocation.Offset;
+	}
+	return allocation;
+}
+
+void DeviceMemoryAllocator::Free(DeviceAllocation& allocation)
+{
+	if (allocation.IsValid() == false)
+		return;
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	DeviceMemoryBlock* block = allocation.Block;
+	block->Allocator.Free(allocation.Range);
+	allocation = DeviceAllocation();
+
+	if (block->Allocator.IsEmpty() == false)
+		return;
+
+	// one empty block stays around per pool so a resource freed and created every frame does not hit vkAllocateMemory
+	std::vector<std::unique_ptr<DeviceMemoryBlock>>& blocks = mBlocks[block->MemoryTypeIndex][static_cast<size_t>(block->ResourceType)];
+	if (block->Dedicated == false)
+	{
+		const size_t emptyBlockCount = std::count_if(blocks.begin(), blocks.end(), [](const std::unique_ptr<DeviceMemoryBlock>& other)
+		{
+			return other->Dedicated == false && other->Allocator.IsEmpty();
+		});
+
+		if (emptyBlockCount == 1)
+			return;
+	}
+
+	vkFreeMemory(mDevice, block->Memory, nullptr);
+	--mDeviceAllocationCount;
+
+	blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<DeviceMemoryBlock>& other) { return other.get() == block; }));
+}
+
+void DeviceMemoryAllocator::GetHeapStatistics(std::vector<HeapStatistics>& heapStatistics)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	heapStatistics.assign(mMemoryProperties.memoryHeapCount, HeapStatistics());
+	for (uint32_t heapIndex = 0; heapIndex < mMemoryProperties.memoryHeapCount; ++heapIndex)
+	{
+		heapStatistics[heapIndex].HeapSize = mMemoryProperties.memoryHeaps[heapIndex].size;
+		heapStatistics[heapIndex].DeviceLocal = (mMemoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < mMemoryProperties.memoryTypeCount; ++memoryTypeIndex)
+	{
+		HeapStatistics& statistics = heapStatistics[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+		for (const std::vector<std::unique_ptr<DeviceMemoryBlock>>& blocks : mBlocks[memoryTypeIndex])
+		{
+			for (const std::unique_ptr<DeviceMemoryBlock>& block : blocks)
+			{
+				const W::TlsfAllocator::Statistics blockStatistics = block->Allocator.GetStatistics();
+				statistics.BlockSize += blockStatistics.Size;
+				statistics.UsedSize += blockStatistics.UsedSize;
+				statistics.LargestFreeRange = std::max(statistics.LargestFreeRange, static_cast<VkDeviceSize>(blockStatistics.LargestFreeRange));
+				statistics.AllocationCount += blockStatistics.AllocationCount;
+				statistics.BlockCount++;
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <Framework/Memory/TlsfAllocator.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct DeviceMemoryBlock;
+
+// Range of a VkDeviceMemory block handed out by DeviceMemoryAllocator, bind the resource at Memory + Offset
+struct DeviceAllocation
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* MappedData = nullptr;		// host visible memory stays mapped for the lifetime of its block
+
+	DeviceMemoryBlock* Block = nullptr;
+	W::TlsfAllocator::Allocation Range;
+
+	bool IsValid() const { return Block != nullptr; }
+};
+
+// What the range is bound to. Buffers and linear images never share a block with optimal images, so
+// neighbouring ranges can not violate bufferImageGranularity whatever their alignment.
+enum class DeviceResourceType : uint32_t
+{
+	Linear,		// buffers, VK_IMAGE_TILING_LINEAR images
+	Optimal,	// VK_IMAGE_TILING_OPTIMAL images
+	Count
+};
+
+// Sub-allocates the buffers and images from a few large VkDeviceMemory blocks per memory type instead of one
+// vkAllocateMemory per resource, which is slow and runs into maxMemoryAllocationCount on large scenes.
+// The ranges are handed out by a W::TlsfAllocator per block, resources larger than half a block get a block of their own.
+class DeviceMemoryAllocator
+{
+public:
+	struct HeapStatistics
+	{
+		VkDeviceSize HeapSize = 0;
+		VkDeviceSize BlockSize = 0;			// allocated from the device
+		VkDeviceSize UsedSize = 0;			// handed out to resources
+		VkDeviceSize LargestFreeRange = 0;
+		uint32_t BlockCount = 0;
+		uint32_t AllocationCount = 0;
+		bool DeviceLocal = false;
+
+		// 0 when the free space of the blocks is one range, towards 1 the more it is split up
+		float GetFragmentation() const;
+	};
+
+private:
+	VkDevice mDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties mMemoryProperties = {};
+	VkDeviceSize mBlockSizes[VK_MAX_MEMORY_TYPES] = {};
+
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<DeviceMemoryBlock>> mBlocks[VK_MAX_MEMORY_TYPES][static_cast<size_t>(DeviceResourceType::Count)];
+	uint32_t mDeviceAllocationCount = 0;
+
+public:
+	DeviceMemoryAllocator();
+	~DeviceMemoryAllocator();
+
+	void Startup(VkPhysicalDevice physicalDevice, VkDevice device);
+	void Shutdown();
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	// Aligned range for a resource with these requirements in a memory type with the properties. Host visible memory comes mapped.
+	DeviceAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, DeviceResourceType resourceType);
+	void Free(DeviceAllocation& allocation);
+
+	// One entry per memory heap
+	void GetHeapStatistics(std::vector<HeapStatistics>& heapStatistics);
+	uint32_t GetDeviceAllocationCount() const { return mDeviceAllocationCount; }
+};
@@ -0,0 +1,87 @@
+#include "DrawList.h"
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <algorithm>
+
+static const uint32_t RADIX_BITS = 8;
+static const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+static const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+void DrawList::Clear()
+{
+	mKeys.clear();
+	mCommands.clear();
+}
+
+void DrawList::Add(uint32_t pipeline, uint32_t material, uint32_t geometry, float depth, const DrawCommand& command)
+{
+	Debug_Assert(pipeline < MAX_PIPELINES && material < MAX_MATERIALS && geometry < MAX_GEOMETRIES);
+	Debug_AssertMsg(mCommands.size() < MAX_DRAWS, "draw list is full! %zu draws", mCommands.size());
+
+	const uint64_t depthMax = (1ull << DEPTH_BITS) - 1;
+	const uint64_t quantizedDepth = static_cast<uint64_t>(std::min(std::max(depth, 0.0f), 1.0f) * depthMax);
+
+	uint64_t key = 0;
+	key |= static_cast<uint64_t>(pipeline) << PIPELINE_SHIFT;
+	key |= static_cast<uint64_t>(material) << MATERIAL_SHIFT;
+	key |= static_cast<uint64_t>(geometry) << GEOMETRY_SHIFT;
+	key |= quantizedDepth << DEPTH_SHIFT;
+	key |= static_cast<uint64_t>(mCommands.size());
+
+	mKeys.push_back(key);
+	mCommands.push_back(command);
+}
+
+void DrawList::Sort()
+{
+	const size_t count = mKeys.size();
+	if (count < 2)
+		return;
+
+	// the histograms of every pass in one read of the keys
+	uint32_t histograms[RADIX_PASSES][RADIX_SIZE] = {};
+	for (uint64_t key : mKeys)
+	{
+		for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+		{
+			++histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+		}
+	}
+
+	mScratchKeys.resize(count);
+	uint64_t* source = mKeys.data();
+	uint64_t* destination = mScratchKeys.data();
+
+	for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass)
+	{
+		uint32_t* histogram = histograms[pass];
+		const uint32_t shift = pass * RADIX_BITS;
+
+		// every key has the same digit, the pass would not move anything
+		if (histogram[(source[0] >> shift) & (RADIX_SIZE - 1)] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+		{
+			const uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint64_t key = source[i];
+			destination[histogram[(key >> shift) & (RADIX_SIZE - 1)]++] = key;
+		}
+
+		std::swap(source, destination);
+	}
+
+	// an odd number of passes left the keys in the scratch buffer
+	if (source != mKeys.data())
+	{
+		mKeys.swap(mScratchKeys);
+	}
+}
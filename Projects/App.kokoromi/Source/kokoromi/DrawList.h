@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Model;
+struct Mesh;
+struct Material;
+
+// Draw of a mesh of a model out of the scene geometry pool, see GeometryPool. The level of detail is picked when it
+// is drawn.
+struct DrawCommand
+{
+	const Model* DrawModel = nullptr;
+	const Mesh* DrawMesh = nullptr;
+	const Material* DrawMaterial = nullptr;
+	uint32_t ModelIndex = 0;	// in Scene::Models
+};
+
+// Draws of the scene ordered by a 64 bit sort key, so the ones sharing a pipeline, a material and an index binding are
+// recorded next to each other and the state only changes between the groups. Inside a group they go front to back
+// for early depth rejection. From the high bits down the key holds:
+//
+//     pipeline (2) | material (16) | geometry (1) | view depth (24) | draw index (21)
+//
+// The draw index makes the keys unique and maps a sorted key back to its command.
+class DrawList
+{
+public:
+	static const uint32_t MAX_PIPELINES = 1u << 2;
+	static const uint32_t MAX_MATERIALS = 1u << 16;
+	static const uint32_t MAX_GEOMETRIES = 1u << 1;
+	static const uint32_t MAX_DRAWS = 1u << 21;
+
+private:
+	static const uint32_t DEPTH_BITS = 24;
+	static const uint32_t DEPTH_SHIFT = 21;
+	static const uint32_t GEOMETRY_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+	static const uint32_t MATERIAL_SHIFT = GEOMETRY_SHIFT + 1;
+	static const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + 16;
+
+	std::vector<uint64_t> mKeys;
+	std::vector<uint64_t> mScratchKeys;
+	std::vector<DrawCommand> mCommands;
+
+public:
+	void Clear();
+
+	// depth is the distance to the camera over the far plane, clamped to [0, 1]
+	void Add(uint32_t pipeline, uint32_t material, uint32_t geometry, float depth, const DrawCommand& command);
+
+	// LSD radix sort of the keys, 8 bits a pass. The passes where every key has the same byte are skipped, the top
+	// byte is one of them as long as there is a single pipeline and fewer than 1024 materials.
+	void Sort();
+
+	size_t GetDrawCount() const { return mKeys.size(); }
+
+	// In key order once sorted, in the order added otherwise
+	const DrawCommand& GetDraw(size_t index) const { return mCommands[mKeys[index] & (MAX_DRAWS - 1)]; }
+	uint64_t GetKey(size_t index) const { return mKeys[index]; }
+
+	// The state part of the key, equal for draws that need no bind between them
+	static uint64_t GetState(uint64_t key) { return key >> GEOMETRY_SHIFT; }
+	static uint32_t GetPipeline(uint64_t key) { return static_cast<uint32_t>(key >> PIPELINE_SHIFT); }
+	static uint32_t GetMaterial(uint64_t key) { return static_cast<uint32_t>(key >> MATERIAL_SHIFT) & (MAX_MATERIALS - 1); }
+	static uint32_t GetGeometry(uint64_t key) { return static_cast<uint32_t>(key >> GEOMETRY_SHIFT) & (MAX_GEOMETRIES - 1); }
+};
@@ -0,0 +1,163 @@
+#include "GeometryPool.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Graphics/Backend/Vk.Graphics.hpp>
+
+#include <algorithm>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+GeometryPool::GeometryPool()
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+	Debug_Assert(mDevice == VK_NULL_HANDLE);
+}
+
+void GeometryPool::Startup(VkDevice device, DeviceMemoryAllocator& deviceMemory, VkDeviceSize vertexSize, VkDeviceSize indexSize)
+{
+	mDevice = device;
+	mDeviceMemory = &deviceMemory;
+
+	mVertexBuffer = CreateBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mVertexMemory);
+	mIndexBuffer = CreateBuffer(indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mIndexMemory);
+
+	mVertexRanges = std::make_unique<W::TlsfAllocator>(vertexSize);
+	mIndexRanges = std::make_unique<W::TlsfAllocator>(indexSize);
+}
+
+void GeometryPool::Shutdown()
+{
+	if (mDevice == VK_NULL_HANDLE)
+		return;
+
+	Update(UINT64_MAX);
+	Debug_AssertMsg(mVertexRanges->IsEmpty() && mIndexRanges->IsEmpty(), "geometry pool shut down with %u ranges in use", mVertexRanges->GetAllocationCount());
+
+	mVertexRanges.reset();
+	mIndexRanges.reset();
+
+	vkDestroyBuffer(mDevice, mVertexBuffer, nullptr);
+	mDeviceMemory->Free(mVertexMemory);
+	vkDestroyBuffer(mDevice, mIndexBuffer, nullptr);
+	mDeviceMemory->Free(mIndexMemory);
+
+	mVertexBuffer = VK_NULL_HANDLE;
+	mIndexBuffer = VK_NULL_HANDLE;
+	mDeviceMemory = nullptr;
+	mDevice = VK_NULL_HANDLE;
+}
+
+GeometryRange GeometryPool::Allocate(VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride)
+{
+	Debug_Assert(vertexSize > 0 && indexSize > 0);
+	Debug_Assert(vertexSize % vertexStride == 0 && indexSize % indexStride == 0);
+
+	// a stride that is not a power of two (44 bytes for Vertex) gets the largest power of two dividing it as the
+	// alignment and room to move the start up to the next multiple of the stride
+	const VkDeviceSize vertexAlignment = vertexStride & (~vertexStride + 1);
+	const VkDeviceSize vertexSlack = vertexStride - vertexAlignment;
+	const VkDeviceSize indexAlignment = std::max<VkDeviceSize>(indexStride, 4);
+
+	GeometryRange range;
+	range.VertexRange = mVertexRanges->Allocate(vertexSize + vertexSlack, vertexAlignment);
+	if (range.VertexRange.IsValid() == false)
+		return GeometryRange();
+
+	range.IndexRange = mIndexRanges->Allocate(indexSize, indexAlignment);
+	if (range.IndexRange.IsValid() == false)
+	{
+		mVertexRanges->Free(range.VertexRange);
+		return GeometryRange();
+	}
+
+	range.VertexByteOffset = AlignUp(range.VertexRange.Offset, vertexStride);
+	range.VertexSize = vertexSize;
+	range.IndexByteOffset = range.IndexRange.Offset;
+	range.IndexSize = indexSize;
+
+	range.VertexOffset = static_cast<int32_t>(range.VertexByteOffset / vertexStride);
+	range.FirstIndex = static_cast<uint32_t>(range.IndexByteOffset / indexStride);
+	return range;
+}
+
+void GeometryPool::Free(GeometryRange& range, uint64_t retireFrame)
+{
+	if (range.IsValid() == false)
+		return;
+
+	RetiredRange retired;
+	retired.RetireFrame = retireFrame;
+	retired.Range = range;
+	mRetiredRanges.push_back(retired);
+
+	range = GeometryRange();
+}
+
+void GeometryPool::Update(uint64_t completedFrame)
+{
+	for (size_t i = 0; i < mRetiredRanges.size();)
+	{
+		RetiredRange& retired = mRetiredRanges[i];
+		if (retired.RetireFrame > completedFrame)
+		{
+			++i;
+			continue;
+		}
+
+		Release(retired.Range);
+
+		mRetiredRanges[i] = mRetiredRanges.back();
+		mRetiredRanges.pop_back();
+	}
+}
+
+GeometryPool::Statistics GeometryPool::GetStatistics() const
+{
+	Statistics statistics;
+	if (mDevice == VK_NULL_HANDLE)
+		return statistics;
+
+	const W::TlsfAllocator::Statistics vertexStatistics = mVertexRanges->GetStatistics();
+	const W::TlsfAllocator::Statistics indexStatistics = mIndexRanges->GetStatistics();
+
+	statistics.VertexSize = vertexStatistics.Size;
+	statistics.VertexUsedSize = vertexStatistics.UsedSize;
+	statistics.IndexSize = indexStatistics.Size;
+	statistics.IndexUsedSize = indexStatistics.UsedSize;
+	statistics.LargestFreeVertexRange = vertexStatistics.LargestFreeRange;
+	statistics.RangeCount = vertexStatistics.AllocationCount - static_cast<uint32_t>(mRetiredRanges.size());
+	statistics.RetiredRangeCount = static_cast<uint32_t>(mRetiredRanges.size());
+	return statistics;
+}
+
+VkBuffer GeometryPool::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, DeviceAllocation& memory)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer buffer;
+	VK_CHECK(vkCreateBuffer(mDevice, &bufferInfo, nullptr, &buffer));
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(mDevice, buffer, &memRequirements);
+
+	memory = mDeviceMemory->Allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DeviceResourceType::Linear);
+	VK_CHECK(vkBindBufferMemory(mDevice, buffer, memory.Memory, memory.Offset));
+	return buffer;
+}
+
+void GeometryPool::Release(GeometryRange& range)
+{
+	mVertexRanges->Free(range.VertexRange);
+	mIndexRanges->Free(range.IndexRange);
+	range = GeometryRange();
+}
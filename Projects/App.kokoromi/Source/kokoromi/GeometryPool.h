@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemory.h"
+
+#include <Framework/Memory/TlsfAllocator.hpp>
+
+#include <memory>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Part of the scene geometry buffers a model is drawn from. Draw its meshes with FirstIndex added to their index
+// offsets and VertexOffset as the vertexOffset, the buffers stay bound at offset 0.
+struct GeometryRange
+{
+	int32_t VertexOffset = 0;		// in vertices of the model vertex format
+	uint32_t FirstIndex = 0;		// in indices of the model index stride
+
+	VkDeviceSize VertexByteOffset = 0;
+	VkDeviceSize VertexSize = 0;
+	VkDeviceSize IndexByteOffset = 0;
+	VkDeviceSize IndexSize = 0;
+
+	W::TlsfAllocator::Allocation VertexRange;
+	W::TlsfAllocator::Allocation IndexRange;
+
+	bool IsValid() const { return VertexRange.IsValid(); }
+};
+
+// One vertex buffer and one index buffer the models of the scene are sub-allocated from, so a frame binds the
+// geometry once instead of once per model. The ranges come from a W::TlsfAllocator each and go back to it when the
+// frames that may still draw them are done, the space is reused by the models created after.
+//
+// The models keep their own vertex format and index type, a range starts at a multiple of the vertex stride and of
+// the index stride so the offsets are whole vertices and indices of the buffers bound at 0.
+class GeometryPool
+{
+public:
+	struct Statistics
+	{
+		VkDeviceSize VertexSize = 0;
+		VkDeviceSize VertexUsedSize = 0;
+		VkDeviceSize IndexSize = 0;
+		VkDeviceSize IndexUsedSize = 0;
+		VkDeviceSize LargestFreeVertexRange = 0;
+		uint32_t RangeCount = 0;
+		uint32_t RetiredRangeCount = 0;		// freed, waiting for the frames drawing them
+	};
+
+private:
+	struct RetiredRange
+	{
+		uint64_t RetireFrame;
+		GeometryRange Range;
+	};
+
+	VkDevice mDevice = VK_NULL_HANDLE;
+	DeviceMemoryAllocator* mDeviceMemory = nullptr;
+
+	VkBuffer mVertexBuffer = VK_NULL_HANDLE;
+	DeviceAllocation mVertexMemory;
+	VkBuffer mIndexBuffer = VK_NULL_HANDLE;
+	DeviceAllocation mIndexMemory;
+
+	std::unique_ptr<W::TlsfAllocator> mVertexRanges;
+	std::unique_ptr<W::TlsfAllocator> mIndexRanges;
+
+	std::vector<RetiredRange> mRetiredRanges;
+
+public:
+	GeometryPool();
+	~GeometryPool();
+
+	void Startup(VkDevice device, DeviceMemoryAllocator& deviceMemory, VkDeviceSize vertexSize, VkDeviceSize indexSize);
+	void Shutdown();
+
+	bool IsStarted() const { return mDevice != VK_NULL_HANDLE; }
+
+	// Space for vertexSize bytes of vertices and indexSize bytes of indices, an invalid range when the pool is full
+	GeometryRange Allocate(VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride);
+
+	// Gives the range back once the frames up to retireFrame are done with it, see Update
+	void Free(GeometryRange& range, uint64_t retireFrame);
+	void Update(uint64_t completedFrame);
+
+	VkBuffer GetVertexBuffer() const { return mVertexBuffer; }
+	VkBuffer GetIndexBuffer() const { return mIndexBuffer; }
+
+	Statistics GetStatistics() const;
+
+private:
+	VkBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, DeviceAllocation& memory);
+	void Release(GeometryRange& range);
+};
@@ -0,0 +1,401 @@
+#include "MeshOptimizer.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <algorithm>
+
+static const uint32_t VERTEX_CACHE_SIZE = 16;
+static const float OVERDRAW_THRESHOLD = 1.05f; // allowed ACMR degradation when splitting clusters for overdraw
+
+static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+//////////////////////////////////////////////////////////////////////////
+//                           Vertex Cache Model                         //
+//////////////////////////////////////////////////////////////////////////
+// FIFO cache approximated with timestamps, a vertex is resident while fewer than
+// cacheSize misses happened since it was loaded. Bumping the timestamp past the
+// cache size flushes the whole cache in O(1).
+struct VertexCacheSimulator
+{
+	std::vector<uint32_t> Timestamps;
+	uint32_t CacheSize;
+	uint32_t Timestamp;
+
+	VertexCacheSimulator(size_t vertexCount, uint32_t cacheSize)
+		: Timestamps(vertexCount, 0)
+		, CacheSize(cacheSize)
+		, Timestamp(cacheSize + 1)
+	{
+	}
+
+	// returns 1 on a cache miss
+	uint32_t Access(uint32_t vertex)
+	{
+		if (Timestamp - Timestamps[vertex] > CacheSize)
+		{
+			Timestamps[vertex] = Timestamp++;
+			return 1;
+		}
+		return 0;
+	}
+
+	uint32_t AccessTriangle(const uint32_t* triangle)
+	{
+		return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]);
+	}
+
+	void Flush()
+	{
+		Timestamp += CacheSize + 1;
+	}
+};
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return stats;
+
+	VertexCacheSimulator cache(vertexCount, cacheSize);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		misses += cache.Access(indices[i]);
+
+		uniqueVertices += (referenced[indices[i]] == 0) ? 1 : 0;
+		referenced[indices[i]] = 1;
+	}
+
+	stats.ACMR = static_cast<float>(misses) / static_cast<float>(triangleCount);
+	stats.ATVR = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+	return stats;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                      Vertex Cache Optimization                       //
+//////////////////////////////////////////////////////////////////////////
+static uint32_t SkipDeadEnd(std::vector<uint32_t>& deadEnd, const std::vector<uint32_t>& liveTriangles, size_t& cursor)
+{
+	// most recently referenced vertices that still have triangles left
+	while (deadEnd.empty() == false)
+	{
+		const uint32_t vertex = deadEnd.back();
+		deadEnd.pop_back();
+
+		if (liveTriangles[vertex] > 0)
+			return vertex;
+	}
+
+	// otherwise continue with the next vertex in input order
+	while (cursor < liveTriangles.size())
+	{
+		if (liveTriangles[cursor] > 0)
+			return static_cast<uint32_t>(cursor);
+
+		++cursor;
+	}
+
+	return INVALID_INDEX;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* hardClusters)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// vertex -> triangle adjacency
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		liveTriangles[indices[i]] += 1;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+	}
+
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	deadEnd.reserve(indexCount);
+	output.reserve(indexCount);
+
+	if (hardClusters != nullptr)
+	{
+		hardClusters->clear();
+		hardClusters->push_back(0);
+	}
+
+	uint32_t timestamp = cacheSize + 1;
+	size_t cursor = 0;
+
+	uint32_t fanningVertex = SkipDeadEnd(deadEnd, liveTriangles, cursor);
+	while (fanningVertex != INVALID_INDEX)
+	{
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a)
+		{
+			const uint32_t triangle = adjacency[a];
+			if (emitted[triangle] != 0)
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+
+				liveTriangles[vertex] -= 1;
+				if (timestamp - cacheTimestamps[vertex] > cacheSize)
+				{
+					cacheTimestamps[vertex] = timestamp++;
+				}
+			}
+
+			emitted[triangle] = 1;
+		}
+
+		// pick the candidate that stays in the cache for its remaining triangles, preferring the oldest one
+		uint32_t nextVertex = INVALID_INDEX;
+		int32_t bestPriority = -1;
+		for (uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+
+			int32_t priority = 0;
+			const uint32_t age = timestamp - cacheTimestamps[vertex];
+			if (age + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = static_cast<int32_t>(age);
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = vertex;
+			}
+		}
+
+		if (nextVertex == INVALID_INDEX)
+		{
+			nextVertex = SkipDeadEnd(deadEnd, liveTriangles, cursor);
+
+			// jumping to an unrelated vertex effectively flushes the cache
+			const uint32_t triangleOffset = static_cast<uint32_t>(output.size() / 3);
+			if (hardClusters != nullptr && nextVertex != INVALID_INDEX && hardClusters->back() != triangleOffset)
+			{
+				hardClusters->push_back(triangleOffset);
+			}
+		}
+
+		fanningVertex = nextVertex;
+	}
+
+	Debug_Assert(output.size() == triangleCount * 3);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                        Overdraw Optimization                         //
+//////////////////////////////////////////////////////////////////////////
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, const std::vector<uint32_t>& hardClusters, uint32_t cacheSize, float threshold)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || hardClusters.empty())
+		return;
+
+	// Soft boundaries - split the hard clusters wherever the running ACMR is already within the threshold of the cluster ACMR
+	std::vector<uint32_t> clusters;
+	{
+		VertexCacheSimulator cache(vertexCount, cacheSize);
+
+		for (size_t c = 0; c < hardClusters.size(); ++c)
+		{
+			const uint32_t start = hardClusters[c];
+			const uint32_t end = (c + 1 < hardClusters.size()) ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+			cache.Flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t triangle = start; triangle < end; ++triangle)
+			{
+				clusterMisses += cache.AccessTriangle(&indices[triangle * 3]);
+			}
+
+			const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+			clusters.push_back(start);
+			cache.Flush();
+
+			uint32_t runningMisses = 0;
+			uint32_t runningTriangles = 0;
+			for (uint32_t triangle = start; triangle < end; ++triangle)
+			{
+				runningMisses += cache.AccessTriangle(&indices[triangle * 3]);
+				runningTriangles += 1;
+
+				if (triangle + 1 < end && static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold)
+				{
+					clusters.push_back(triangle + 1);
+					cache.Flush();
+
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+		}
+	}
+
+	// Mesh centroid, area weighted
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	std::vector<glm::vec3> triangleCentroids(triangleCount);
+	std::vector<glm::vec3> triangleNormals(triangleCount); // length is twice the area
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].Position;
+		const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].Position;
+		const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].Position;
+
+		triangleCentroids[triangle] = (p0 + p1 + p2) / 3.0f;
+		triangleNormals[triangle] = glm::cross(p1 - p0, p2 - p0);
+
+		const float area = glm::length(triangleNormals[triangle]);
+		meshCentroid += triangleCentroids[triangle] * area;
+		meshArea += area;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	// Sort key - clusters that face away from the center are likely to occlude the others, draw those first
+	struct ClusterSortKey
+	{
+		float Key;
+		uint32_t Cluster;
+	};
+
+	std::vector<ClusterSortKey> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		const uint32_t start = clusters[c];
+		const uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+		glm::vec3 clusterCentroid(0.0f);
+		glm::vec3 clusterNormal(0.0f);
+		float clusterArea = 0.0f;
+		for (uint32_t triangle = start; triangle < end; ++triangle)
+		{
+			const float area = glm::length(triangleNormals[triangle]);
+			clusterCentroid += triangleCentroids[triangle] * area;
+			clusterNormal += triangleNormals[triangle];
+			clusterArea += area;
+		}
+
+		float key = 0.0f;
+		const float normalLength = glm::length(clusterNormal);
+		if (clusterArea > 0.0f && normalLength > 0.0f)
+		{
+			clusterCentroid /= clusterArea;
+			key = glm::dot(clusterCentroid - meshCentroid, clusterNormal / normalLength);
+		}
+
+		sortKeys[c].Key = key;
+		sortKeys[c].Cluster = static_cast<uint32_t>(c);
+	}
+
+	std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const ClusterSortKey& a, const ClusterSortKey& b) { return a.Key > b.Key; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+	for (const ClusterSortKey& sortKey : sortKeys)
+	{
+		const uint32_t start = clusters[sortKey.Cluster];
+		const uint32_t end = (sortKey.Cluster + 1 < clusters.size()) ? clusters[sortKey.Cluster + 1] : static_cast<uint32_t>(triangleCount);
+
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                      Vertex Fetch Optimization                       //
+//////////////////////////////////////////////////////////////////////////
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+
+	std::vector<Vertex> orderedVertices;
+	orderedVertices.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == INVALID_INDEX)
+		{
+			remap[index] = static_cast<uint32_t>(orderedVertices.size());
+			orderedVertices.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices = std::move(orderedVertices);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Mesh Optimizer                            //
+//////////////////////////////////////////////////////////////////////////
+MeshOptimizer::OptimizeStats MeshOptimizer::Optimize(Model& model)
+{
+	OptimizeStats stats;
+	stats.Before = AnalyzeVertexCache(model.Indices.data(), model.Indices.size(), model.Vertices.size(), VERTEX_CACHE_SIZE);
+
+	// Each Mesh range is reordered in place so every material draw stays contiguous
+	std::vector<uint32_t> hardClusters;
+	for (const Mesh& mesh : model.Meshs)
+	{
+		uint32_t* meshIndices = model.Indices.data() + mesh.IndexOffset;
+		const size_t meshIndexCount = static_cast<size_t>(mesh.TriangleCount) * 3;
+
+		OptimizeVertexCache(meshIndices, meshIndexCount, model.Vertices.size(), VERTEX_CACHE_SIZE, &hardClusters);
+		OptimizeOverdraw(meshIndices, meshIndexCount, model.Vertices.data(), model.Vertices.size(), hardClusters, VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+	}
+
+	OptimizeVertexFetch(model.Vertices, model.Indices);
+
+	stats.After = AnalyzeVertexCache(model.Indices.data(), model.Indices.size(), model.Vertices.size(), VERTEX_CACHE_SIZE);
+
+	W::Logger::PrintFormat("MeshOptimizer - %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		model.Name.c_str(),
+		stats.Before.ACMR, stats.After.ACMR,
+		stats.Before.ATVR, stats.After.ATVR);
+
+	return stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Vertex;
+struct Model;
+
+namespace MeshOptimizer
+{
+	struct VertexCacheStats
+	{
+		float ACMR = 0.0f; // average cache miss ratio, transformed vertices per triangle (0.5 is optimal)
+		float ATVR = 0.0f; // average transform to vertex ratio, transformed vertices per unique vertex (1.0 is optimal)
+	};
+
+	struct OptimizeStats
+	{
+		VertexCacheStats Before;
+		VertexCacheStats After;
+	};
+
+	// Simulates a FIFO post-transform cache of the given size over a triangle list
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize);
+
+	// Tipsy triangle ordering (Sander et al. 2007), the triangle offsets of the cache flushes are written to hardClusters
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* hardClusters);
+
+	// Splits the clusters further where the cache efficiency allows it and orders them so outward facing clusters draw first
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, const std::vector<uint32_t>& hardClusters, uint32_t cacheSize, float threshold);
+
+	// Reorders the vertex buffer into first use order and drops unreferenced vertices
+	void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Runs the cache and overdraw passes per Mesh range, then the vertex fetch pass over the whole model
+	OptimizeStats Optimize(Model& model);
+} // namespace MeshOptimizer
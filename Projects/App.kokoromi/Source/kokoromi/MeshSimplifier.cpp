@@ -0,0 +1,380 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static const uint32_t VERTEX_CACHE_SIZE = 16;
+static const float MIN_LOD_REDUCTION = 0.9f;	// a LOD has to drop at least 10% of the triangles of the previous one
+
+//////////////////////////////////////////////////////////////////////////
+//                                Quadric                               //
+//////////////////////////////////////////////////////////////////////////
+// Symmetric 4x4 matrix of the plane equations, weighted by the triangle area. Dividing by the weight
+// keeps the error a squared distance no matter how many triangles were merged into the vertex.
+struct Quadric
+{
+	float A00 = 0.0f, A11 = 0.0f, A22 = 0.0f;
+	float A01 = 0.0f, A02 = 0.0f, A12 = 0.0f;
+	float B0 = 0.0f, B1 = 0.0f, B2 = 0.0f;
+	float C = 0.0f;
+	float Weight = 0.0f;
+
+	void AddPlane(const glm::vec3& normal, float distance, float weight)
+	{
+		A00 += weight * normal.x * normal.x;
+		A11 += weight * normal.y * normal.y;
+		A22 += weight * normal.z * normal.z;
+		A01 += weight * normal.x * normal.y;
+		A02 += weight * normal.x * normal.z;
+		A12 += weight * normal.y * normal.z;
+		B0 += weight * normal.x * distance;
+		B1 += weight * normal.y * distance;
+		B2 += weight * normal.z * distance;
+		C += weight * distance * distance;
+		Weight += weight;
+	}
+
+	void Add(const Quadric& other)
+	{
+		A00 += other.A00; A11 += other.A11; A22 += other.A22;
+		A01 += other.A01; A02 += other.A02; A12 += other.A12;
+		B0 += other.B0; B1 += other.B1; B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+	}
+
+	// squared distance of the point to the planes
+	float Error(const glm::vec3& p) const
+	{
+		const float rx = A00 * p.x + A01 * p.y + A02 * p.z + B0 * 2.0f;
+		const float ry = A01 * p.x + A11 * p.y + A12 * p.z + B1 * 2.0f;
+		const float rz = A02 * p.x + A12 * p.y + A22 * p.z + B2 * 2.0f;
+		const float error = rx * p.x + ry * p.y + rz * p.z + C;
+
+		return (Weight > 0.0f) ? std::fabs(error) / Weight : 0.0f;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                               Topology                               //
+//////////////////////////////////////////////////////////////////////////
+enum class VertexKind : uint8_t
+{
+	Manifold,	// can collapse into any neighbor
+	Locked,		// never moves
+};
+
+// vertex -> triangle adjacency in compressed rows
+struct TriangleAdjacency
+{
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Triangles;
+
+	void Build(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		Offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : indices)
+		{
+			Offsets[index + 1] += 1;
+		}
+
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			Offsets[vertex + 1] += Offsets[vertex];
+		}
+
+		Triangles.resize(indices.size());
+		std::vector<uint32_t> fillOffsets(Offsets.begin(), Offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			Triangles[fillOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	const uint32_t* begin(uint32_t vertex) const { return Triangles.data() + Offsets[vertex]; }
+	const uint32_t* end(uint32_t vertex) const { return Triangles.data() + Offsets[vertex + 1]; }
+};
+
+static void ClassifyVertices(std::vector<VertexKind>& kinds, const std::vector<uint32_t>& indices, const Vertex* vertices, size_t vertexCount, const TriangleAdjacency& adjacency)
+{
+	kinds.assign(vertexCount, VertexKind::Manifold);
+
+	// Seams - welding keeps vertices apart when their attributes differ, those positions exist more than once
+	{
+		std::vector<uint32_t> order(vertexCount);
+		for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			order[vertex] = vertex;
+		}
+
+		auto positionLess = [vertices](uint32_t a, uint32_t b)
+		{
+			return memcmp(&vertices[a].Position, &vertices[b].Position, sizeof(glm::vec3)) < 0;
+		};
+
+		std::sort(order.begin(), order.end(), positionLess);
+		for (size_t i = 1; i < order.size(); ++i)
+		{
+			if (memcmp(&vertices[order[i - 1]].Position, &vertices[order[i]].Position, sizeof(glm::vec3)) == 0)
+			{
+				kinds[order[i - 1]] = VertexKind::Locked;
+				kinds[order[i]] = VertexKind::Locked;
+			}
+		}
+	}
+
+	// Borders and non-manifold edges - every edge of a closed manifold surface has exactly two triangles
+	for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+	{
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t a = indices[triangle * 3 + corner];
+			const uint32_t b = indices[triangle * 3 + (corner + 1) % 3];
+
+			uint32_t edgeTriangleCount = 0;
+			for (const uint32_t* t = adjacency.begin(a); t != adjacency.end(a); ++t)
+			{
+				const uint32_t* tri = &indices[*t * 3];
+				edgeTriangleCount += (tri[0] == b || tri[1] == b || tri[2] == b) ? 1 : 0;
+			}
+
+			if (edgeTriangleCount != 2)
+			{
+				kinds[a] = VertexKind::Locked;
+				kinds[b] = VertexKind::Locked;
+			}
+		}
+	}
+}
+
+// Moving the vertex onto the target must not turn any of its remaining triangles over
+static bool HasTriangleFlip(uint32_t vertex, uint32_t target, const std::vector<uint32_t>& indices, const Vertex* vertices, const TriangleAdjacency& adjacency)
+{
+	const glm::vec3& targetPosition = vertices[target].Position;
+
+	for (const uint32_t* t = adjacency.begin(vertex); t != adjacency.end(vertex); ++t)
+	{
+		const uint32_t* tri = &indices[*t * 3];
+		if (tri[0] == target || tri[1] == target || tri[2] == target)
+			continue; // collapses away
+
+		// rotate so the collapsing vertex comes first
+		const uint32_t corner = (tri[0] == vertex) ? 0 : (tri[1] == vertex) ? 1 : 2;
+		const glm::vec3& p0 = vertices[tri[corner]].Position;
+		const glm::vec3& p1 = vertices[tri[(corner + 1) % 3]].Position;
+		const glm::vec3& p2 = vertices[tri[(corner + 2) % 3]].Position;
+
+		const glm::vec3 normalBefore = glm::cross(p1 - p0, p2 - p0);
+		const glm::vec3 normalAfter = glm::cross(p1 - targetPosition, p2 - targetPosition);
+
+		// rejects flips as well as slivers that are close to it
+		if (glm::dot(normalBefore, normalAfter) <= 1e-2f * glm::length(normalBefore) * glm::length(normalAfter))
+			return true;
+	}
+
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Mesh Simplifier                           //
+//////////////////////////////////////////////////////////////////////////
+std::vector<uint32_t> MeshSimplifier::Simplify(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError)
+{
+	std::vector<uint32_t> result(indices, indices + indexCount);
+
+	float maxError = 0.0f;
+	if (resultError != nullptr)
+	{
+		*resultError = 0.0f;
+	}
+
+	if (indexCount <= targetIndexCount)
+		return result;
+
+	TriangleAdjacency adjacency;
+	adjacency.Build(result, vertexCount);
+
+	std::vector<VertexKind> kinds;
+	ClassifyVertices(kinds, result, vertices, vertexCount, adjacency);
+
+	// Vertex quadrics from the planes of the triangles around them
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t triangle = 0; triangle < indexCount / 3; ++triangle)
+	{
+		const uint32_t* tri = &result[triangle * 3];
+		const glm::vec3& p0 = vertices[tri[0]].Position;
+		const glm::vec3& p1 = vertices[tri[1]].Position;
+		const glm::vec3& p2 = vertices[tri[2]].Position;
+
+		const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+
+		const glm::vec3 unitNormal = normal / length;
+		const float area = length * 0.5f;
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			quadrics[tri[corner]].AddPlane(unitNormal, -glm::dot(unitNormal, p0), area);
+		}
+	}
+
+	struct Collapse
+	{
+		uint32_t Vertex;
+		uint32_t Target;
+		float Error;
+	};
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+
+	const float targetSquaredError = (targetError < std::sqrt(std::numeric_limits<float>::max())) ? targetError * targetError : std::numeric_limits<float>::max();
+
+	// Each pass collapses the cheapest edges that do not share a neighborhood, then rebuilds the topology
+	while (result.size() > targetIndexCount)
+	{
+		collapses.clear();
+		for (size_t triangle = 0; triangle < result.size() / 3; ++triangle)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t a = result[triangle * 3 + corner];
+				const uint32_t b = result[triangle * 3 + (corner + 1) % 3];
+
+				// interior edges are seen from both triangles, keep one
+				if (a > b)
+					continue;
+
+				const float errorAB = (kinds[a] == VertexKind::Manifold) ? quadrics[a].Error(vertices[b].Position) : std::numeric_limits<float>::max();
+				const float errorBA = (kinds[b] == VertexKind::Manifold) ? quadrics[b].Error(vertices[a].Position) : std::numeric_limits<float>::max();
+				if (errorAB == std::numeric_limits<float>::max() && errorBA == std::numeric_limits<float>::max())
+					continue;
+
+				Collapse collapse;
+				collapse.Vertex = (errorAB <= errorBA) ? a : b;
+				collapse.Target = (errorAB <= errorBA) ? b : a;
+				collapse.Error = std::min(errorAB, errorBA);
+				collapses.push_back(collapse);
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+		for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			remap[vertex] = vertex;
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+
+		// a collapse removes two triangles on a closed surface
+		const size_t collapseBudget = (result.size() - targetIndexCount) / 6 + 1;
+		size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapseCount >= collapseBudget || collapse.Error > targetSquaredError)
+				break;
+
+			if (touched[collapse.Vertex] != 0 || touched[collapse.Target] != 0)
+				continue;
+
+			if (HasTriangleFlip(collapse.Vertex, collapse.Target, result, vertices, adjacency))
+				continue;
+
+			remap[collapse.Vertex] = collapse.Target;
+			quadrics[collapse.Target].Add(quadrics[collapse.Vertex]);
+			maxError = std::max(maxError, collapse.Error);
+
+			// the adjacency of the whole neighborhood is stale until the next pass
+			for (const uint32_t* t = adjacency.begin(collapse.Vertex); t != adjacency.end(collapse.Vertex); ++t)
+			{
+				touched[result[*t * 3 + 0]] = 1;
+				touched[result[*t * 3 + 1]] = 1;
+				touched[result[*t * 3 + 2]] = 1;
+			}
+
+			collapseCount += 1;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const uint32_t a = remap[result[i + 0]];
+			const uint32_t b = remap[result[i + 1]];
+			const uint32_t c = remap[result[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[writeIndex++] = a;
+			result[writeIndex++] = b;
+			result[writeIndex++] = c;
+		}
+		result.resize(writeIndex);
+
+		adjacency.Build(result, vertexCount);
+	}
+
+	if (resultError != nullptr)
+	{
+		*resultError = std::sqrt(maxError);
+	}
+
+	return result;
+}
+
+void MeshSimplifier::BuildLods(Model& model)
+{
+	for (Mesh& mesh : model.Meshs)
+	{
+		mesh.LodCount = 1;
+		mesh.Lods[0].IndexOffset = mesh.IndexOffset;
+		mesh.Lods[0].TriangleCount = mesh.TriangleCount;
+		mesh.Lods[0].Error = 0.0f;
+
+		std::vector<uint32_t> lodIndices(model.Indices.begin() + mesh.IndexOffset, model.Indices.begin() + mesh.IndexOffset + mesh.TriangleCount * 3);
+		float lodError = 0.0f;
+
+		while (mesh.LodCount < MAX_MESH_LODS)
+		{
+			const size_t previousIndexCount = lodIndices.size();
+			const size_t targetIndexCount = (previousIndexCount / 6) * 3;
+
+			// each LOD is simplified from the previous one, so its error relative to the full resolution is bounded by the sum
+			float simplifyError = 0.0f;
+			lodIndices = Simplify(lodIndices.data(), lodIndices.size(), model.Vertices.data(), model.Vertices.size(), targetIndexCount, std::numeric_limits<float>::max(), &simplifyError);
+			if (lodIndices.empty() || lodIndices.size() > previousIndexCount * MIN_LOD_REDUCTION)
+				break;
+
+			lodError += simplifyError;
+
+			MeshOptimizer::OptimizeVertexCache(lodIndices.data(), lodIndices.size(), model.Vertices.size(), VERTEX_CACHE_SIZE, nullptr);
+
+			MeshLod& lod = mesh.Lods[mesh.LodCount++];
+			lod.IndexOffset = static_cast<int>(model.Indices.size());
+			lod.TriangleCount = static_cast<int>(lodIndices.size() / 3);
+			lod.Error = lodError;
+
+			model.Indices.insert(model.Indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+	}
+
+	for (const Mesh& mesh : model.Meshs)
+	{
+		const MeshLod& lastLod = mesh.Lods[mesh.LodCount - 1];
+		W::Logger::PrintFormat("MeshSimplifier - %s: %d LODs, %d -> %d triangles, error %f\n",
+			model.Name.c_str(), mesh.LodCount, mesh.TriangleCount, lastLod.TriangleCount, lastLod.Error);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Vertex;
+struct Model;
+
+namespace MeshSimplifier
+{
+	// Quadric error edge collapse (Garland and Heckbert 1997) onto existing vertices, so the result keeps indexing the same
+	// vertex buffer. Collapses stop at targetIndexCount or when the next one would exceed targetError (model space distance).
+	// Seam, border and non-manifold vertices are locked to keep attribute seams, material boundaries and open edges intact.
+	std::vector<uint32_t> Simplify(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError);
+
+	// Appends a chain of LODs, each about half the triangles of the previous one, behind the indices of every Mesh
+	void BuildLods(Model& model);
+} // namespace MeshSimplifier
@@ -0,0 +1,237 @@
+#include "Meshlets.h"
+#include "BoundingVolumes.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const uint8_t INVALID_LOCAL_INDEX = 0xFF;
+
+// Normal cones wider than this are not worth testing, the cluster is nearly never backfacing as a whole
+static const float MIN_CONE_DOT = 0.1f;
+
+//////////////////////////////////////////////////////////////////////////
+//                            Meshlet Bounds                            //
+//////////////////////////////////////////////////////////////////////////
+static void ComputeMeshletBounds(const Model& model, Meshlet& meshlet)
+{
+	const uint32_t* meshletVertices = model.MeshletVertices.data() + meshlet.VertexOffset;
+	const uint8_t* meshletTriangles = model.MeshletTriangles.data() + meshlet.TriangleOffset;
+
+	// Bounding sphere - centered on the bounding box
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+	{
+		const glm::vec3& position = model.Vertices[meshletVertices[i]].Position;
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+
+	const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+	{
+		radius = std::max(radius, glm::length(model.Vertices[meshletVertices[i]].Position - center));
+	}
+
+	meshlet.BoundingSphere = glm::vec4(center, radius);
+
+	// Normal cone - average of the face normals, the widest deviation from it gives the angle
+	glm::vec3 triangleNormals[Meshlets::MAX_TRIANGLES];
+	bool triangleValid[Meshlets::MAX_TRIANGLES];
+	glm::vec3 coneAxis(0.0f);
+	for (uint32_t triangle = 0; triangle < meshlet.TriangleCount; ++triangle)
+	{
+		const glm::vec3& p0 = model.Vertices[meshletVertices[meshletTriangles[triangle * 3 + 0]]].Position;
+		const glm::vec3& p1 = model.Vertices[meshletVertices[meshletTriangles[triangle * 3 + 1]]].Position;
+		const glm::vec3& p2 = model.Vertices[meshletVertices[meshletTriangles[triangle * 3 + 2]]].Position;
+
+		const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+
+		// degenerate triangles are never rasterized, they do not constrain the cone
+		triangleValid[triangle] = (length > 0.0f);
+		triangleNormals[triangle] = triangleValid[triangle] ? normal / length : glm::vec3(0.0f);
+		coneAxis += triangleNormals[triangle];
+	}
+
+	meshlet.ConeAxisCutoff = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	const float axisLength = glm::length(coneAxis);
+	if (axisLength <= 0.0f)
+		return;
+
+	coneAxis /= axisLength;
+
+	float minDot = 1.0f;
+	for (uint32_t triangle = 0; triangle < meshlet.TriangleCount; ++triangle)
+	{
+		if (triangleValid[triangle])
+		{
+			minDot = std::min(minDot, glm::dot(triangleNormals[triangle], coneAxis));
+		}
+	}
+
+	if (minDot < MIN_CONE_DOT)
+	{
+		meshlet.ConeAxisCutoff = glm::vec4(coneAxis, 1.0f);
+		return;
+	}
+
+	meshlet.ConeAxisCutoff = glm::vec4(coneAxis, std::sqrt(1.0f - minDot * minDot));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Meshlet Builder                           //
+//////////////////////////////////////////////////////////////////////////
+void Meshlets::Build(Model& model)
+{
+	model.Meshlets.clear();
+	model.MeshletVertices.clear();
+	model.MeshletTriangles.clear();
+
+	std::vector<uint8_t> localIndices(model.Vertices.size(), INVALID_LOCAL_INDEX);
+
+	Meshlet meshlet = {};
+
+	auto flushMeshlet = [&model, &meshlet, &localIndices]()
+	{
+		if (meshlet.TriangleCount == 0)
+			return;
+
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			localIndices[model.MeshletVertices[meshlet.VertexOffset + i]] = INVALID_LOCAL_INDEX;
+		}
+
+		ComputeMeshletBounds(model, meshlet);
+		model.Meshlets.push_back(meshlet);
+
+		meshlet = {};
+		meshlet.VertexOffset = static_cast<uint32_t>(model.MeshletVertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(model.MeshletTriangles.size());
+	};
+
+	for (Mesh& mesh : model.Meshs)
+	{
+		// meshlets never cross a Mesh range so each one keeps a single material
+		mesh.MeshletOffset = static_cast<int>(model.Meshlets.size());
+
+		const uint32_t* meshIndices = model.Indices.data() + mesh.IndexOffset;
+		for (int triangle = 0; triangle < mesh.TriangleCount; ++triangle)
+		{
+			const uint32_t a = meshIndices[triangle * 3 + 0];
+			const uint32_t b = meshIndices[triangle * 3 + 1];
+			const uint32_t c = meshIndices[triangle * 3 + 2];
+
+			const uint32_t newVertexCount =
+				(localIndices[a] == INVALID_LOCAL_INDEX ? 1 : 0) +
+				(localIndices[b] == INVALID_LOCAL_INDEX && b != a ? 1 : 0) +
+				(localIndices[c] == INVALID_LOCAL_INDEX && c != a && c != b ? 1 : 0);
+
+			if (meshlet.VertexCount + newVertexCount > MAX_VERTICES || meshlet.TriangleCount + 1 > MAX_TRIANGLES)
+			{
+				flushMeshlet();
+			}
+
+			for (uint32_t vertex : { a, b, c })
+			{
+				if (localIndices[vertex] == INVALID_LOCAL_INDEX)
+				{
+					localIndices[vertex] = static_cast<uint8_t>(meshlet.VertexCount++);
+					model.MeshletVertices.push_back(vertex);
+				}
+
+				model.MeshletTriangles.push_back(localIndices[vertex]);
+			}
+
+			meshlet.TriangleCount += 1;
+		}
+
+		flushMeshlet();
+
+		mesh.MeshletCount = static_cast<int>(model.Meshlets.size()) - mesh.MeshletOffset;
+	}
+
+	size_t triangleCount = 0;
+	for (const Mesh& mesh : model.Meshs)
+	{
+		triangleCount += mesh.TriangleCount;
+	}
+
+	W::Logger::PrintFormat("Meshlets - %s: %zu meshlets, %.1f triangles %.1f vertices per meshlet\n",
+		model.Name.c_str(),
+		model.Meshlets.size(),
+		model.Meshlets.empty() ? 0.0f : static_cast<float>(triangleCount) / static_cast<float>(model.Meshlets.size()),
+		model.Meshlets.empty() ? 0.0f : static_cast<float>(model.MeshletVertices.size()) / static_cast<float>(model.Meshlets.size()));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Meshlet Culling                           //
+//////////////////////////////////////////////////////////////////////////
+Meshlets::CullStats& Meshlets::CullStats::operator+=(const CullStats& other)
+{
+	MeshletCount += other.MeshletCount;
+	FrustumCulledCount += other.FrustumCulledCount;
+	BackfaceCulledCount += other.BackfaceCulledCount;
+	TriangleCount += other.TriangleCount;
+	VisibleTriangleCount += other.VisibleTriangleCount;
+	return *this;
+}
+
+Meshlets::CullStats Meshlets::Cull(const Model& model, const glm::mat4& worldTransform, const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+	return Cull(model.Meshlets.data(), model.Meshlets.size(), worldTransform, viewProjection, cameraPosition);
+}
+
+Meshlets::CullStats Meshlets::Cull(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& worldTransform, const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+	CullStats stats;
+
+	// Everything is tested in model space, the planes of the model view projection matrix are the frustum planes in model space
+	const glm::mat4 modelViewProjection = viewProjection * worldTransform;
+	const glm::vec3 modelCameraPosition = glm::vec3(glm::inverse(worldTransform) * glm::vec4(cameraPosition, 1.0f));
+
+	glm::vec4 frustumPlanes[6];
+	BoundingVolumes::FrustumPlanes(modelViewProjection, frustumPlanes);
+
+	for (size_t meshletIndex = 0; meshletIndex < meshletCount; ++meshletIndex)
+	{
+		const Meshlet& meshlet = meshlets[meshletIndex];
+
+		stats.MeshletCount += 1;
+		stats.TriangleCount += meshlet.TriangleCount;
+
+		const glm::vec3 center(meshlet.BoundingSphere);
+		const float radius = meshlet.BoundingSphere.w;
+
+		bool frustumCulled = false;
+		for (const glm::vec4& plane : frustumPlanes)
+		{
+			frustumCulled = frustumCulled || (glm::dot(glm::vec3(plane), center) + plane.w < -radius);
+		}
+
+		if (frustumCulled)
+		{
+			stats.FrustumCulledCount += 1;
+			continue;
+		}
+
+		// the whole cluster faces away when the view direction is inside the normal cone, widened by the sphere
+		const glm::vec3 cameraToCenter = center - modelCameraPosition;
+		if (glm::dot(cameraToCenter, glm::vec3(meshlet.ConeAxisCutoff)) >= meshlet.ConeAxisCutoff.w * glm::length(cameraToCenter) + radius)
+		{
+			stats.BackfaceCulledCount += 1;
+			continue;
+		}
+
+		stats.VisibleTriangleCount += meshlet.TriangleCount;
+	}
+
+	return stats;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct Meshlet;
+struct Model;
+
+namespace Meshlets
+{
+	const uint32_t MAX_VERTICES = 64;
+	const uint32_t MAX_TRIANGLES = 124;
+
+	struct CullStats
+	{
+		uint32_t MeshletCount = 0;
+		uint32_t FrustumCulledCount = 0;
+		uint32_t BackfaceCulledCount = 0;
+		uint64_t TriangleCount = 0;
+		uint64_t VisibleTriangleCount = 0;
+
+		CullStats& operator+=(const CullStats& other);
+	};
+
+	// Splits every Mesh range of the model into meshlets, the index order of the ranges is kept so
+	// run it after MeshOptimizer to get spatially coherent clusters
+	void Build(Model& model);
+
+	// CPU reference of cluster culling - tests the meshlets of the model against the view frustum and their normal cone
+	CullStats Cull(const Model& model, const glm::mat4& worldTransform, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+	// Same over any meshlets, bounds and cones in the space of worldTransform
+	CullStats Cull(const Meshlet* meshlets, size_t meshletCount, const glm::mat4& worldTransform, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+} // namespace Meshlets
@@ -0,0 +1,271 @@
+#include "MipGenerator.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Threading/ThreadPool.hpp>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// Kaiser window, the radius is in texels of the destination level
+static const float KAISER_WIDTH = 3.0f;
+static const float KAISER_ALPHA = 4.0f;
+
+static const int LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+//////////////////////////////////////////////////////////////////////////
+//                                Gamma                                 //
+//////////////////////////////////////////////////////////////////////////
+static float SRGBToLinear(float value)
+{
+	return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value)
+{
+	return (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// 8 bit sRGB to linear is exact, linear to 8 bit sRGB is looked up at 12 bit precision
+struct GammaTables
+{
+	float ToLinear[256];
+	uint8_t ToSRGB[LINEAR_TO_SRGB_TABLE_SIZE];
+
+	GammaTables()
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			ToLinear[i] = SRGBToLinear(i / 255.0f);
+		}
+
+		for (int i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; ++i)
+		{
+			ToSRGB[i] = static_cast<uint8_t>(LinearToSRGB(i / float(LINEAR_TO_SRGB_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const GammaTables& GetGammaTables()
+{
+	static const GammaTables tables;
+	return tables;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                Filter                                //
+//////////////////////////////////////////////////////////////////////////
+// Source texels weighted into each destination texel along one axis, TapCount per destination texel.
+// The indices are clamped to the edge and the weights sum to one.
+struct FilterTaps
+{
+	int TapCount = 0;
+	std::vector<int> Indices;
+	std::vector<float> Weights;
+};
+
+// Modified Bessel function of the first kind, order 0
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	const float halfSquared = x * x * 0.25f;
+	for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+	{
+		term *= halfSquared / float(k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float EvaluateKaiser(float t)
+{
+	if (std::abs(t) >= KAISER_WIDTH)
+		return 0.0f;
+
+	const float pi = 3.14159265358979f;
+	const float sinc = (t == 0.0f) ? 1.0f : std::sin(pi * t) / (pi * t);
+	const float ratio = t / KAISER_WIDTH;
+	return sinc * BesselI0(KAISER_ALPHA * std::sqrt(1.0f - ratio * ratio)) / BesselI0(KAISER_ALPHA);
+}
+
+static FilterTaps BuildFilterTaps(uint32_t sourceSize, uint32_t destinationSize, MipFilter filter)
+{
+	// source texels per destination texel, a little over 2 for odd sizes and 1 for an axis that is already 1
+	const float scale = float(sourceSize) / float(destinationSize);
+	const float support = ((filter == MipFilter::Box) ? 0.5f : KAISER_WIDTH) * scale;
+
+	FilterTaps taps;
+	taps.TapCount = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+	taps.Indices.resize(static_cast<size_t>(destinationSize) * taps.TapCount);
+	taps.Weights.resize(static_cast<size_t>(destinationSize) * taps.TapCount);
+
+	for (uint32_t destination = 0; destination < destinationSize; ++destination)
+	{
+		// source texel s covers [s, s + 1]
+		const float center = (destination + 0.5f) * scale;
+		const int first = static_cast<int>(std::floor(center - support));
+
+		int* indices = &taps.Indices[static_cast<size_t>(destination) * taps.TapCount];
+		float* weights = &taps.Weights[static_cast<size_t>(destination) * taps.TapCount];
+
+		float weightSum = 0.0f;
+		for (int tap = 0; tap < taps.TapCount; ++tap)
+		{
+			const int source = first + tap;
+
+			float weight;
+			if (filter == MipFilter::Box)
+			{
+				// area of the source texel inside the footprint
+				weight = std::max(0.0f, std::min(source + 1.0f, center + support) - std::max(float(source), center - support));
+			}
+			else
+			{
+				weight = EvaluateKaiser((source + 0.5f - center) / scale);
+			}
+
+			indices[tap] = std::min(std::max(source, 0), static_cast<int>(sourceSize) - 1);
+			weights[tap] = weight;
+			weightSum += weight;
+		}
+
+		Debug_Assert(weightSum > 0.0f);
+		for (int tap = 0; tap < taps.TapCount; ++tap)
+		{
+			weights[tap] /= weightSum;
+		}
+	}
+
+	return taps;
+}
+
+static void ForEachRow(uint32_t rowCount, const std::function<void(size_t)>& function, W::ThreadPool* threadPool)
+{
+	if (threadPool != nullptr)
+	{
+		threadPool->ParallelFor(rowCount, function);
+	}
+	else
+	{
+		for (uint32_t row = 0; row < rowCount; ++row)
+			function(row);
+	}
+}
+
+// Separable, the rows are filtered into horizontal then its columns into the output. One texel is one
+// __m128 of linear RGBA so every tap is a single multiply-add over the four channels.
+static void DownsampleLevel(const float* source, uint32_t sourceWidth, uint32_t sourceHeight, float* horizontal, float* output, uint32_t width, uint32_t height, MipFilter filter, W::ThreadPool* threadPool)
+{
+	const FilterTaps tapsX = BuildFilterTaps(sourceWidth, width, filter);
+	const FilterTaps tapsY = BuildFilterTaps(sourceHeight, height, filter);
+
+	ForEachRow(sourceHeight, [&](size_t y)
+	{
+		const float* sourceRow = source + y * sourceWidth * 4;
+		float* row = horizontal + y * width * 4;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const int* indices = &tapsX.Indices[static_cast<size_t>(x) * tapsX.TapCount];
+			const float* weights = &tapsX.Weights[static_cast<size_t>(x) * tapsX.TapCount];
+
+			__m128 sum = _mm_setzero_ps();
+			for (int tap = 0; tap < tapsX.TapCount; ++tap)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(sourceRow + indices[tap] * 4)));
+			}
+			_mm_storeu_ps(row + x * 4, sum);
+		}
+	}, threadPool);
+
+	ForEachRow(height, [&](size_t y)
+	{
+		const int* indices = &tapsY.Indices[y * tapsY.TapCount];
+		const float* weights = &tapsY.Weights[y * tapsY.TapCount];
+
+		// the negative lobes of the Kaiser filter can ring past the range
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		float* row = output + y * width * 4;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (int tap = 0; tap < tapsY.TapCount; ++tap)
+			{
+				const float* texel = horizontal + (static_cast<size_t>(indices[tap]) * width + x) * 4;
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[tap]), _mm_loadu_ps(texel)));
+			}
+			_mm_storeu_ps(row + x * 4, _mm_min_ps(_mm_max_ps(sum, zero), one));
+		}
+	}, threadPool);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                             MipGenerator                             //
+//////////////////////////////////////////////////////////////////////////
+uint32_t MipGenerator::GetMipCount(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+std::vector<MipImage> MipGenerator::Generate(const uint8_t* pixels, uint32_t width, uint32_t height, MipFilter filter, W::ThreadPool* threadPool)
+{
+	const GammaTables& gammaTables = GetGammaTables();
+	const uint32_t mipCount = GetMipCount(width, height);
+
+	std::vector<MipImage> mips(mipCount);
+	mips[0].Width = width;
+	mips[0].Height = height;
+	mips[0].Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+
+	const size_t texelCount = static_cast<size_t>(width) * height;
+	std::vector<float> level(texelCount * 4);
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		level[i * 4 + 0] = gammaTables.ToLinear[pixels[i * 4 + 0]];
+		level[i * 4 + 1] = gammaTables.ToLinear[pixels[i * 4 + 1]];
+		level[i * 4 + 2] = gammaTables.ToLinear[pixels[i * 4 + 2]];
+		level[i * 4 + 3] = pixels[i * 4 + 3] / 255.0f;
+	}
+
+	std::vector<float> horizontal;
+	std::vector<float> nextLevel;
+	for (uint32_t mipLevel = 1; mipLevel < mipCount; ++mipLevel)
+	{
+		const MipImage& previous = mips[mipLevel - 1];
+		MipImage& mip = mips[mipLevel];
+		mip.Width = std::max(previous.Width >> 1, 1u);
+		mip.Height = std::max(previous.Height >> 1, 1u);
+
+		horizontal.resize(static_cast<size_t>(mip.Width) * previous.Height * 4);
+		nextLevel.resize(static_cast<size_t>(mip.Width) * mip.Height * 4);
+		DownsampleLevel(level.data(), previous.Width, previous.Height, horizontal.data(), nextLevel.data(), mip.Width, mip.Height, filter, threadPool);
+		level.swap(nextLevel);
+
+		const size_t mipTexelCount = static_cast<size_t>(mip.Width) * mip.Height;
+		mip.Pixels.resize(mipTexelCount * 4);
+		for (size_t i = 0; i < mipTexelCount; ++i)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				mip.Pixels[i * 4 + c] = gammaTables.ToSRGB[static_cast<int>(level[i * 4 + c] * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+			}
+			mip.Pixels[i * 4 + 3] = static_cast<uint8_t>(level[i * 4 + 3] * 255.0f + 0.5f);
+		}
+	}
+
+	return mips;
+}
+
+const char* MipGenerator::GetFilterName(MipFilter filter)
+{
+	switch (filter)
+	{
+	case MipFilter::Box: return "box";
+	case MipFilter::Kaiser: return "Kaiser";
+	default: return "unknown";
+	}
+}
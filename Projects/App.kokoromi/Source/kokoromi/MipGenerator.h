@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+namespace W
+{
+	class ThreadPool;
+}
+
+enum class MipFilter : uint32_t
+{
+	Box,	// area average, the same as the GPU blit chain
+	Kaiser,	// Kaiser windowed sinc, sharper minification with less aliasing
+};
+
+// RGBA8 pixels of one mip level
+struct MipImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+};
+
+namespace MipGenerator
+{
+	// Levels of a full chain down to 1x1
+	uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+	// Full mip chain of an sRGB RGBA8 image, level 0 is a copy of the source. Color is filtered in linear space
+	// and alpha as is, the chain stays in float between the levels so the rounding does not add up.
+	// The rows of each level are spread over threadPool when one is given.
+	std::vector<MipImage> Generate(const uint8_t* pixels, uint32_t width, uint32_t height, MipFilter filter, W::ThreadPool* threadPool);
+
+	const char* GetFilterName(MipFilter filter);
+} // namespace MipGenerator
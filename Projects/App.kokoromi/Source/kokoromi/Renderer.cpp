@@ -12,6 +12,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <vector>
 #include <cstring>
@@ -32,7 +33,11 @@
 #include "Renderer.h"
 
 #include <kokoromi/Application.h>
+#include <kokoromi/BoundingVolumes.h>
+#include <kokoromi/Meshlets.h>
 #include <kokoromi/Scene.h>
+#include <kokoromi/TextureCompression.h>
+#include <kokoromi/TextureStreaming.h>
 
 #include <Framework/Debug/Debug.hpp>
 #include <Framework/Graphics/Backend/Vk.Graphics.hpp>
@@ -71,6 +76,9 @@ static std::vector<char> ReadFile(const std::string& filePath)
 //////////////////////////////////////////////////////////////////////////
 static VkClearColorValue s_BackgroundColor = { 0.0f, 0.0f, 0.0f, 1.0f };
 
+static const float CAMERA_NEAR_PLANE = 0.01f;
+static const float CAMERA_FAR_PLANE = 1000.0f;
+
 static float s_AmbientLightColor[3] = { 0.13f, 0.17f, 0.19f };
 static float s_AmbientLightIntensity = 0.3f;
 
@@ -84,6 +92,173 @@ static float s_MaterialColor[3] = { 1.0f, 1.0f, 1.0f };
 static float s_MaterialSpecularColor[3] = { 0.3f, 0.3f, 0.3f };
 static float s_MaterialRoughness = 0.5f;
 
+//////////////////////////////////////////////////////////////////////////
+//                               Meshlets                               //
+//////////////////////////////////////////////////////////////////////////
+// CPU reference of the cluster culling, tests every meshlet of the scene so it only runs while the statistics are shown
+static bool s_MeshletStatistics = false;
+
+//////////////////////////////////////////////////////////////////////////
+//                            Level of Detail                           //
+//////////////////////////////////////////////////////////////////////////
+static float s_LodErrorThreshold = 1.0f; // pixels
+static int s_ForceLod = -1;
+
+static_assert(INSTANCE_MAX_LODS == MAX_MESH_LODS, "InstanceData holds every level of a Mesh");
+static_assert(offsetof(InstanceData, Lods) == 132 && sizeof(InstanceData) == 224, "InstanceData has to match the std430 layout of the shaders");
+static_assert(sizeof(CullPushConstant) == 128, "CullPushConstant has to fit the smallest maxPushConstantsSize");
+
+// Model space units to pixels at the nearest point of the sphere moved by worldTransform, pixelScale is
+// cot(fov / 2) * half the viewport height. TestDraw of cull.comp does the same on the GPU.
+static float GetPixelsPerUnit(const glm::mat4& worldTransform, const glm::vec4& sphere, const glm::vec3& cameraPosition, float pixelScale)
+{
+	const float worldScale = std::max(glm::length(glm::vec3(worldTransform[0])), std::max(glm::length(glm::vec3(worldTransform[1])), glm::length(glm::vec3(worldTransform[2]))));
+	const glm::vec3 center = glm::vec3(worldTransform * glm::vec4(glm::vec3(sphere), 1.0f));
+	const float distance = std::max(glm::length(center - cameraPosition) - sphere.w * worldScale, 0.01f);
+	return worldScale * pixelScale / distance;
+}
+
+// Picks the coarsest LOD whose geometric error projects to less than the threshold on screen, SelectLod of cull.comp
+// is the same for the indirect draws
+static int SelectLod(const Mesh& mesh, float pixelsPerUnit)
+{
+	if (s_ForceLod >= 0)
+		return std::min(s_ForceLod, mesh.LodCount - 1);
+
+	int lod = 0;
+	while (lod + 1 < mesh.LodCount && mesh.Lods[lod + 1].Error * pixelsPerUnit <= s_LodErrorThreshold)
+	{
+		lod += 1;
+	}
+
+	return lod;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                               Draw List                              //
+//////////////////////////////////////////////////////////////////////////
+// Sorted - the draws are recorded grouped by pipeline, material and index type, front to back inside a group, and a
+// bind is only recorded when the state changes. Otherwise in scene order, which rebinds about every draw. The list is
+// only rebuilt when the scene changes, so front to back is from the camera of the last rebuild.
+static bool s_SortDrawList = true;
+
+// Indirect - a compute pass ahead of the render pass picks the level of detail of every draw and writes its draw
+// arguments into a buffer, every state group is one vkCmdDrawIndexedIndirect, so neither the CPU work nor the
+// recording grows with the number of draws. Otherwise one vkCmdDrawIndexed per draw, its level of detail picked on the
+// CPU. Both fetch the instance data at gl_InstanceIndex.
+static bool s_DrawIndirect = true;
+
+// GPU culling - the compute pass also tests the bounding sphere of every draw against the view frustum. With
+// vkCmdDrawIndexedIndirectCount the visible ones are packed at the start of their group in list order, otherwise the
+// culled ones are left in place without instance. Needs the indirect draws.
+static bool s_GpuCulling = true;
+static const uint32_t CULL_WORKGROUP_SIZE = 256; // local_size_x of cull.comp
+
+// Dispatches of cull.comp, see RecordCullPass
+static const uint32_t CULL_PASS_TEST = 0;
+static const uint32_t CULL_PASS_SCAN = 1;
+static const uint32_t CULL_PASS_COMPACT = 2;
+static const uint32_t CULL_PASS_IN_PLACE = 3;
+
+//////////////////////////////////////////////////////////////////////////
+//                             Scene Loading                            //
+//////////////////////////////////////////////////////////////////////////
+static const char* SCENE_FILE_PATH = "Data/Scenes/StanfordDragon.fbx";
+//static const char* SCENE_FILE_PATH = "Data/Scenes/StudioLighting.fbx";
+
+// Progressive - the scene loads on a background thread and its textures and models are created over the frames as
+// they become ready, the materials sample a placeholder until their texture is. Otherwise Startup blocks on all of it.
+static const bool PROGRESSIVE_SCENE_LOADING = true;
+static const float SCENE_LOADING_FRAME_BUDGET = 4.0f; // ms of resource creation per frame
+
+// The vertex, index and texture data go through the staging ring, submitted ahead of the next frame
+static const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+static const VkDeviceSize STAGING_ALIGNMENT = 16; // block size of the BC formats
+
+// The models are sub-allocated from one vertex and one index buffer sized for the scene when it is swapped in, with
+// room for the models created after it
+static const float GEOMETRY_POOL_HEADROOM = 0.25f;
+static const VkDeviceSize GEOMETRY_POOL_MIN_SIZE = 4 * 1024 * 1024;
+
+// The staging ring copies on a transfer only queue family when the device has one and supports timeline semaphores,
+// the frames pick up what is done without waiting. Otherwise the copies go ahead of the frames on the graphics queue.
+static const bool DEDICATED_TRANSFER_QUEUE = true;
+
+// Stages of a frame reading uploaded resources, where it waits for the transfer queue and acquires them
+static const VkPipelineStageFlags UPLOAD_ACQUIRE_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+//////////////////////////////////////////////////////////////////////////
+//                           Texture Streaming                          //
+//////////////////////////////////////////////////////////////////////////
+static int s_TextureBudgetMB = 256;
+static const size_t MAX_TEXTURE_UPLOADS_IN_FLIGHT = 4;
+
+// Levels of a texture copied into a staging buffer on the scene workers
+struct TextureUpload
+{
+	Texture* UploadTexture = nullptr;
+	uint32_t FirstMip = 0;
+	std::vector<TextureMip> Layout;
+	VkBuffer StagingBuffer = VK_NULL_HANDLE;
+	DeviceAllocation StagingBufferMemory;
+	std::atomic<bool> Filled{ false };
+};
+
+// Image being copied by a staging ring batch, it replaces the image of the texture once the batch is done
+struct PendingTextureImage
+{
+	Texture* UploadTexture = nullptr;
+	uint32_t FirstMip = 0;
+	uint32_t LevelCount = 0;
+	uint64_t UploadValue = 0;
+	VkImage Image = VK_NULL_HANDLE;
+	DeviceAllocation ImageMemory;
+	VkImageView ImageView = VK_NULL_HANDLE;
+
+	// streamed levels come from a staging buffer of their own, released with the image it replaces
+	VkBuffer StagingBuffer = VK_NULL_HANDLE;
+	DeviceAllocation StagingBufferMemory;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                         Queue Ownership                              //
+//////////////////////////////////////////////////////////////////////////
+// Resources copied on the transfer queue are released to the graphics queue family by the batch and acquired by the
+// frame waiting on it. Buffers only transfer the range copied, the rest of the scene geometry buffers stays with the
+// graphics queue. Images go from TRANSFER_DST to SHADER_READ_ONLY with it.
+static VkBufferMemoryBarrier MakeBufferOwnershipBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, bool acquire, uint32_t transferFamily, uint32_t graphicsFamily)
+{
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = acquire ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = acquire ? (VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT) : 0;
+	barrier.srcQueueFamilyIndex = transferFamily;
+	barrier.dstQueueFamilyIndex = graphicsFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	return barrier;
+}
+
+static VkImageMemoryBarrier MakeImageOwnershipBarrier(VkImage image, uint32_t mipLevels, bool acquire, uint32_t transferFamily, uint32_t graphicsFamily)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = acquire ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = acquire ? VK_ACCESS_SHADER_READ_BIT : 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcQueueFamilyIndex = transferFamily;
+	barrier.dstQueueFamilyIndex = graphicsFamily;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	return barrier;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //                         Vulkan Debug Layer                           //
 //////////////////////////////////////////////////////////////////////////
@@ -104,6 +279,8 @@ Renderer::~Renderer() = default;
 
 void Renderer::Startup()
 {
+	mStartupTime = std::chrono::steady_clock::now();
+
 	InitRenderDoc();
 	InitVulkan();
 	InitImGui();
@@ -115,21 +292,60 @@ void Renderer::Shutdown()
 {
 	vkDeviceWaitIdle(mDevice);
 
+	// a load still running has nothing on the GPU yet, it is dropped with mLoadedScene
+	if (mSceneLoadThread.joinable())
+	{
+		mSceneLoadThread.join();
+	}
+
 	ImGui_ImplVulkan_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
 	CleanupSwapChain();
 
+	mStagingRing.Shutdown();
+
+	for (std::unique_ptr<PendingTextureImage>& pending : mPendingTextureImages)
+	{
+		vkDestroyImageView(mDevice, pending->ImageView, nullptr);
+		vkDestroyImage(mDevice, pending->Image, nullptr);
+		mDeviceMemory.Free(pending->ImageMemory);
+		vkDestroyBuffer(mDevice, pending->StagingBuffer, nullptr);
+		mDeviceMemory.Free(pending->StagingBufferMemory);
+	}
+	mPendingTextureImages.clear();
+
+	// the workers may still be filling staging buffers
+	if (mScene->Workers)
+	{
+		mScene->Workers->WaitIdle();
+	}
+	for (std::unique_ptr<TextureUpload>& upload : mTextureUploads)
+	{
+		vkDestroyBuffer(mDevice, upload->StagingBuffer, nullptr);
+		mDeviceMemory.Free(upload->StagingBufferMemory);
+	}
+	mTextureUploads.clear();
+
+	DestroyRetiredTextureImages(UINT64_MAX);
+
 	for (std::unique_ptr<Texture>& texture : mScene->Textures)
 	{
 		vkDestroySampler(mDevice, texture->TextureSampler, nullptr);
 		vkDestroyImageView(mDevice, texture->TextureImageView, nullptr);
 
 		vkDestroyImage(mDevice, texture->TextureImage, nullptr);
-		vkFreeMemory(mDevice, texture->TextureImageMemory, nullptr);
+		mDeviceMemory.Free(texture->TextureImageMemory);
+
+		texture->DestroyPixelBuffer();
 	}
 
+	vkDestroySampler(mDevice, mPlaceholderTexture->TextureSampler, nullptr);
+	vkDestroyImageView(mDevice, mPlaceholderTexture->TextureImageView, nullptr);
+	vkDestroyImage(mDevice, mPlaceholderTexture->TextureImage, nullptr);
+	mDeviceMemory.Free(mPlaceholderTexture->TextureImageMemory);
+
 	//for (std::unique_ptr<Material>& material : mScene->Materials)
 	//{
 	//	vkFreeDescriptorSets(mDevice, mDescriptorPool, 1, &material->DescriptorSets);
@@ -137,18 +353,22 @@ void Renderer::Shutdown()
 
 	for (std::unique_ptr<Model>& model : mScene->Models)
 	{
-		vkDestroyBuffer(mDevice, model->VertexBuffer, nullptr);
-		vkFreeMemory(mDevice, model->VertexBufferMemory, nullptr);
-		vkDestroyBuffer(mDevice, model->IndexBuffer, nullptr);
-		vkFreeMemory(mDevice, model->IndexBufferMemory, nullptr);
+		mGeometryPool.Free(model->Geometry, mFrameCount);
 	}
+	mGeometryPool.Shutdown();
 
 	vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+	vkDestroyDescriptorPool(mDevice, mMaterialDescriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
-	vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout2, nullptr);
+	vkDestroyDescriptorSetLayout(mDevice, mInstanceSetLayout, nullptr);
+
+	vkDestroyPipeline(mDevice, mCullPipeline, nullptr);
+	vkDestroyPipelineLayout(mDevice, mCullPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(mDevice, mCullSetLayout, nullptr);
+	vkDestroyQueryPool(mDevice, mCullQueryPool, nullptr);
 
 	vkDestroyBuffer(mDevice, mUniformBuffers, nullptr);
-	vkFreeMemory(mDevice, mUniformBuffersMemory, nullptr);
+	mDeviceMemory.Free(mUniformBuffersMemory);
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
@@ -158,7 +378,11 @@ void Renderer::Shutdown()
 		vkDestroyFence(mDevice, mFrameData[i].Fence, nullptr);
 	}
 
+	DestroyDrawBuffers();
+
 	vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+
+	mDeviceMemory.Shutdown();
 	vkDestroyDevice(mDevice, nullptr);
 
 	if (W::VK::s_enableValidationLayers)
@@ -172,6 +396,12 @@ void Renderer::Shutdown()
 
 void Renderer::FrameUpdate(float deltaTime)
 {
+	UpdateSceneLoading(false);
+
+	// Only the subtrees that moved since the last frame are recomputed, the draws of their models are patched by the
+	// next FrameRender
+	mTransformsUpdated |= mScene->UpdateTransforms();
+
 	// Start the Dear ImGui frame
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplWin32_NewFrame();
@@ -190,6 +420,14 @@ void Renderer::FrameUpdate(float deltaTime)
 		ImGui::PushItemWidth(150.0f);
 
 		ImGui::Text("deltaTime: %.5f", deltaTime);
+		if (mSceneFullyLoaded)
+		{
+			ImGui::Text("Scene: first frame %.1f ms, fully loaded %.1f ms", mTimeToFirstFrame, mTimeToFullyLoaded);
+		}
+		else
+		{
+			ImGui::Text("Scene: first frame %.1f ms, loading...", mTimeToFirstFrame);
+		}
 
 		ImGui::Checkbox("Demo Window", &show_demo_window); // Edit bools storing our window open/close state
 		ImGui::ColorEdit3("Background Color", s_BackgroundColor.float32);
@@ -210,6 +448,80 @@ void Renderer::FrameUpdate(float deltaTime)
 		ImGui::ColorEdit3("Material Specular Color", s_MaterialSpecularColor);
 		ImGui::DragFloat("Material Roughness", &s_MaterialRoughness, 0.01f, 0.0f, 1.0f);
 
+		ImGui::Separator(); // -----------------------------------------------
+
+		ImGui::Checkbox("Meshlet Statistics", &s_MeshletStatistics);
+		if (s_MeshletStatistics)
+		{
+			// CPU reference of the cluster culling, against the camera of the last frame
+			Meshlets::CullStats meshletStats;
+			for (const std::unique_ptr<Model>& model : mScene->Models)
+			{
+				meshletStats += Meshlets::Cull(*model, mScene->GetWorldTransform(*model), mViewProjection, mCameraPosition);
+			}
+
+			ImGui::Text("Meshlets: %u / %u visible", meshletStats.MeshletCount - meshletStats.FrustumCulledCount - meshletStats.BackfaceCulledCount, meshletStats.MeshletCount);
+			ImGui::Text("  Frustum Culled: %u", meshletStats.FrustumCulledCount);
+			ImGui::Text("  Backface Culled: %u", meshletStats.BackfaceCulledCount);
+			ImGui::Text("Meshlet Triangles: %llu / %llu visible", meshletStats.VisibleTriangleCount, meshletStats.TriangleCount);
+		}
+
+		ImGui::Separator(); // -----------------------------------------------
+
+		ImGui::DragFloat("LOD Error (pixels)", &s_LodErrorThreshold, 0.05f, 0.0f, 64.0f);
+		ImGui::SliderInt("Force LOD", &s_ForceLod, -1, MAX_MESH_LODS - 1);
+		ImGui::Text("Triangles Drawn: %llu / %llu", mTrianglesDrawn, mTrianglesFullDetail);
+
+		ImGui::Separator(); // -----------------------------------------------
+
+		if (ImGui::Checkbox("Sort Draw List", &s_SortDrawList))
+		{
+			mDrawListDirty = true;
+		}
+		if (mDrawIndirectSupported)
+		{
+			ImGui::Checkbox("Draw Indirect", &s_DrawIndirect);
+			ImGui::Checkbox("GPU Culling", &s_GpuCulling);
+		}
+		ImGui::Text("Draws: %u in %u calls, sorted in %.3f ms, %u rebuilds", mDrawStatistics.DrawCount, mDrawStatistics.DrawCalls, mDrawStatistics.SortTime, mDrawStatistics.ListRebuilds);
+		if (s_DrawIndirect && mDrawIndirectSupported)
+		{
+			ImGui::Text("GPU Culling: %u / %u visible in %.3f ms", mCullStatistics.VisibleCount, mCullStatistics.TestedCount, mCullStatistics.GpuTime);
+		}
+		ImGui::Text("Binds: %u pipeline, %u descriptor set, %u index buffer", mDrawStatistics.PipelineBinds, mDrawStatistics.DescriptorSetBinds, mDrawStatistics.IndexBufferBinds);
+
+		ImGui::Separator(); // -----------------------------------------------
+
+		ImGui::DragInt("Texture Budget (MB)", &s_TextureBudgetMB, 1.0f, 1, 16384);
+		ImGui::Text("Texture Memory: %.1f / %d MB", mTextureBytesResident / (1024.0f * 1024.0f), s_TextureBudgetMB);
+		ImGui::Text("Texture Streamed: %.1f MB, %u evictions", mTextureBytesStreamed / (1024.0f * 1024.0f), mTextureEvictions);
+		ImGui::Text("Texture Requests: %u queued, %zu in flight", mTextureRequestsQueued, mTextureUploads.size());
+
+		ImGui::Separator(); // -----------------------------------------------
+
+		const StagingRing::Statistics stagingStatistics = mStagingRing.GetStatistics();
+		ImGui::Text("Upload Queue: %s, family %u", stagingStatistics.DedicatedQueue ? "transfer" : "graphics", mStagingRing.GetQueueFamily());
+		ImGui::Text("Staging Ring: %.1f / %.1f MB, %.1f MB staged", stagingStatistics.UsedSize / (1024.0f * 1024.0f), stagingStatistics.Size / (1024.0f * 1024.0f), stagingStatistics.BytesStaged / (1024.0f * 1024.0f));
+		ImGui::Text("Staging Batches: %u submitted, %u in flight, %u stalls", stagingStatistics.BatchesSubmitted, stagingStatistics.BatchesInFlight, stagingStatistics.Stalls);
+
+		const GeometryPool::Statistics geometryStatistics = mGeometryPool.GetStatistics();
+		ImGui::Text("Geometry Pool: %.1f / %.1f MB vertices, %.1f / %.1f MB indices", geometryStatistics.VertexUsedSize / (1024.0f * 1024.0f), geometryStatistics.VertexSize / (1024.0f * 1024.0f),
+			geometryStatistics.IndexUsedSize / (1024.0f * 1024.0f), geometryStatistics.IndexSize / (1024.0f * 1024.0f));
+		ImGui::Text("Geometry Ranges: %u, %u retired", geometryStatistics.RangeCount, geometryStatistics.RetiredRangeCount);
+
+		std::vector<DeviceMemoryAllocator::HeapStatistics> heapStatistics;
+		mDeviceMemory.GetHeapStatistics(heapStatistics);
+		ImGui::Text("Device Memory: %u blocks", mDeviceMemory.GetDeviceAllocationCount());
+		for (size_t heapIndex = 0; heapIndex < heapStatistics.size(); ++heapIndex)
+		{
+			const DeviceMemoryAllocator::HeapStatistics& heap = heapStatistics[heapIndex];
+			if (heap.BlockCount == 0)
+				continue;
+
+			ImGui::Text("Heap %zu (%s): %.1f / %.1f MB in %u blocks, %u allocations, %.0f%% fragmented", heapIndex, heap.DeviceLocal ? "device" : "host",
+				heap.UsedSize / (1024.0f * 1024.0f), heap.BlockSize / (1024.0f * 1024.0f), heap.BlockCount, heap.AllocationCount, heap.GetFragmentation() * 100.0f);
+		}
+
 		ImGui::PopItemWidth();
 	}
 	ImGui::End();
@@ -226,6 +538,17 @@ void Renderer::FrameRender()
 	vkWaitForFences(mDevice, 1, &frameData.Fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 	vkResetFences(mDevice, 1, &frameData.Fence);
 
+	ReadCullStatistics(frameData);
+	mStagingRing.Update();
+
+	// every frame up to the last one of this slot is done
+	++mFrameCount;
+	if (mFrameCount > MAX_FRAMES_IN_FLIGHT)
+	{
+		DestroyRetiredTextureImages(mFrameCount - MAX_FRAMES_IN_FLIGHT);
+		mGeometryPool.Update(mFrameCount - MAX_FRAMES_IN_FLIGHT);
+	}
+
 	VkResult result = vkAcquireNextImageKHR(mDevice, mSwapChain, std::numeric_limits<uint64_t>::max(), frameData.ImageAcquiredSemaphore, VK_NULL_HANDLE, &imageIndex);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 	{
@@ -244,6 +567,32 @@ void Renderer::FrameRender()
 	}
 
 	UpdateUniformBuffer(frameData.CommandBuffer);
+	UpdateTextureStreaming();
+
+	// the resources created since the last frame are uploaded ahead of it, the ones done are handed to this frame
+	mStagingRing.Flush();
+	const uint64_t uploadWaitValue = AcquireUploads(frameData.CommandBuffer);
+
+	const bool drawIndirect = s_DrawIndirect && mDrawIndirectSupported;
+	const bool compacted = drawIndirect && s_GpuCulling && mDrawIndirectCountSupported;
+
+	// the instance rows of a rebuilt list or of the transforms that moved, then the cull pass, ahead of the render
+	// pass since neither the copies nor the compute dispatches can be recorded inside it
+	if (mDrawListDirty)
+	{
+		BuildDrawList(frameData);
+	}
+	else if (mTransformsUpdated)
+	{
+		PatchDrawTransforms(frameData);
+	}
+	mTransformsUpdated = false;
+
+	RecordInstanceCopies(frameData);
+	if (drawIndirect)
+	{
+		RecordCullPass(frameData, compacted, s_GpuCulling);
+	}
 
 	{
 		VkRenderPassBeginInfo info = {};
@@ -262,58 +611,610 @@ void Renderer::FrameRender()
 		vkCmdBeginRenderPass(frameData.CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
 	}
 
-	if (!mScene->Models.empty())
+	RecordDrawList(frameData, drawIndirect, compacted);
+
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frameData.CommandBuffer);
+
+	// Submit command buffer
+	vkCmdEndRenderPass(frameData.CommandBuffer);
+	VK_CHECK(vkEndCommandBuffer(frameData.CommandBuffer));
+
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, UPLOAD_ACQUIRE_STAGES };
+
 	{
-		vkCmdBindPipeline(frameData.CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+		// only for the uploads acquired by this frame, their batches are done so it never holds the frame back
+		VkSemaphore waitSemaphores[] = { frameData.ImageAcquiredSemaphore, mStagingRing.GetTimelineSemaphore() };
+		const uint64_t waitValues[] = { 0, uploadWaitValue };
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = 2;
+		timelineInfo.pWaitSemaphoreValues = waitValues;
+
+		VkSubmitInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		info.pNext = (uploadWaitValue != 0) ? &timelineInfo : nullptr;
+		info.waitSemaphoreCount = (uploadWaitValue != 0) ? 2 : 1;
+		info.pWaitSemaphores = waitSemaphores;
+		info.pWaitDstStageMask = waitStages;
+		info.commandBufferCount = 1;
+		info.pCommandBuffers = &frameData.CommandBuffer;
+		info.signalSemaphoreCount = 1;
+		info.pSignalSemaphores = &frameData.RenderCompleteSemaphore;
+
+		VK_CHECK(vkQueueSubmit(mGraphicsQueue, 1, &info, frameData.Fence));
 	}
+}
 
-	for (std::unique_ptr<Model>& model : mScene->Models)
+// Instance buffer of the scene and the buffers every frame draws and culls with, sized when the scene is swapped in.
+// A mesh is at most one draw, so drawCapacity is the mesh count of the scene, and there are never more state groups
+// than draws. The rank buffer holds one per draw and one per workgroup. The cull buffers are only created with the
+// cull pipeline.
+void Renderer::CreateDrawBuffers(uint32_t drawCapacity, uint32_t materialCapacity)
+{
+	DestroyDrawBuffers();
+
+	if (drawCapacity == 0)
+		return;
+
+	mDrawCapacity = drawCapacity;
+	mMaterialCapacity = std::max(materialCapacity, 1u);
+
+	const VkDeviceSize instanceSize = drawCapacity * sizeof(InstanceData);
+	CreateBuffer(instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mInstanceBuffer, mInstanceBufferMemory);
+
+	if (mInstanceDescriptorSet == VK_NULL_HANDLE)
+	{
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = mDescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &mInstanceSetLayout;
+		VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocInfo, &mInstanceDescriptorSet));
+	}
+
+	{
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = mInstanceBuffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = VK_WHOLE_SIZE;
+
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = mInstanceDescriptorSet;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(mDevice, 1, &descriptorWrite, 0, nullptr);
+	}
+
+	const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const VkDeviceSize indirectSize = drawCapacity * sizeof(VkDrawIndexedIndirectCommand);
+	const VkDeviceSize counterSize = sizeof(CullCounters) + drawCapacity * sizeof(uint32_t);
+	const VkDeviceSize rankSize = (drawCapacity + (drawCapacity + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE) * sizeof(uint32_t);
+	const VkDeviceSize requestSize = mMaterialCapacity * sizeof(uint32_t);
+
+	for (FrameData& frameData : mFrameData)
+	{
+		CreateBuffer(instanceSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostVisible, frameData.InstanceUploadBuffer, frameData.InstanceUploadBufferMemory);
+
+		if (mCullPipeline == VK_NULL_HANDLE)
+			continue;
+
+		CreateBuffer(indirectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frameData.IndirectBuffer, frameData.IndirectBufferMemory);
+		CreateBuffer(counterSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frameData.CullCounterBuffer, frameData.CullCounterBufferMemory);
+		CreateBuffer(rankSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frameData.CullRankBuffer, frameData.CullRankBufferMemory);
+		CreateBuffer(requestSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frameData.TextureRequestBuffer, frameData.TextureRequestBufferMemory);
+		CreateBuffer(sizeof(CullCounters) + requestSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible, frameData.CullReadbackBuffer, frameData.CullReadbackBufferMemory);
+
+		if (frameData.CullDescriptorSet == VK_NULL_HANDLE)
+		{
+			VkDescriptorSetAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			allocInfo.descriptorPool = mDescriptorPool;
+			allocInfo.descriptorSetCount = 1;
+			allocInfo.pSetLayouts = &mCullSetLayout;
+			VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocInfo, &frameData.CullDescriptorSet));
+		}
+
+		const VkBuffer buffers[] = { mInstanceBuffer, frameData.IndirectBuffer, frameData.CullCounterBuffer, frameData.CullRankBuffer, frameData.TextureRequestBuffer };
+
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos = {};
+		std::array<VkWriteDescriptorSet, 5> descriptorWrites = {};
+		for (uint32_t binding = 0; binding < descriptorWrites.size(); ++binding)
+		{
+			bufferInfos[binding].buffer = buffers[binding];
+			bufferInfos[binding].offset = 0;
+			bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+			descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[binding].dstSet = frameData.CullDescriptorSet;
+			descriptorWrites[binding].dstBinding = binding;
+			descriptorWrites[binding].dstArrayElement = 0;
+			descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[binding].descriptorCount = 1;
+			descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+		}
+		vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+// The descriptor sets stay allocated and are rewritten by the next CreateDrawBuffers. No frame in flight may still use
+// the buffers.
+void Renderer::DestroyDrawBuffers()
+{
+	vkDestroyBuffer(mDevice, mInstanceBuffer, nullptr);
+	mDeviceMemory.Free(mInstanceBufferMemory);
+	mInstanceBuffer = VK_NULL_HANDLE;
+
+	for (FrameData& frameData : mFrameData)
+	{
+		VkBuffer* buffers[] = { &frameData.InstanceUploadBuffer, &frameData.IndirectBuffer, &frameData.CullCounterBuffer, &frameData.CullRankBuffer,
+			&frameData.TextureRequestBuffer, &frameData.CullReadbackBuffer };
+		DeviceAllocation* allocations[] = { &frameData.InstanceUploadBufferMemory, &frameData.IndirectBufferMemory, &frameData.CullCounterBufferMemory,
+			&frameData.CullRankBufferMemory, &frameData.TextureRequestBufferMemory, &frameData.CullReadbackBufferMemory };
+
+		for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); ++i)
+		{
+			vkDestroyBuffer(mDevice, *buffers[i], nullptr);
+			mDeviceMemory.Free(*allocations[i]);
+			*buffers[i] = VK_NULL_HANDLE;
+		}
+
+		frameData.CullPending = false;
+	}
+
+	mDrawCapacity = 0;
+	mMaterialCapacity = 0;
+}
+
+// Level lod of the mesh, the full resolution range when it was cooked without levels
+static MeshLod GetMeshLod(const Mesh& mesh, int lod)
+{
+	if (mesh.LodCount == 0)
+		return { mesh.IndexOffset, mesh.TriangleCount, 0.0f };
+
+	return mesh.Lods[lod];
+}
+
+// Draws of every mesh of the models that are ready, sorted into state groups unless s_SortDrawList is off, and their
+// instance rows staged in the upload buffer of the frame for RecordInstanceCopies. Only runs when the scene changed,
+// the camera moving keeps the order of the last rebuild and the levels of detail are picked when drawing.
+void Renderer::BuildDrawList(FrameData& frameData)
+{
+	mDrawListDirty = false;
+
+	mDrawList.Clear();
+	mDrawGroups.clear();
+	mInstanceCopies.clear();
+	mTrianglesFullDetail = 0;
+
+	mModelDrawOffsets.assign(mScene->Models.size() + 1, 0);
+
+	for (size_t modelIndex = 0; modelIndex < mScene->Models.size(); ++modelIndex)
 	{
-		VkBuffer vertexBuffers[] = { model->VertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
+		const Model* model = mScene->Models[modelIndex].get();
+
+		// still loading, AcquireUploads flags the list once it is done
+		if (model->Geometry.IsValid() == false || model->UploadPending)
+			continue;
 
-		vkCmdBindVertexBuffers(frameData.CommandBuffer, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(frameData.CommandBuffer, model->IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		// the pipeline depends on the vertex layout the model was cooked with, the index binding on its index type
+		const uint32_t pipeline = (model->Format == VertexFormat::Packed) ? 1 : 0;
+		const uint32_t geometry = (model->IndexStride == sizeof(uint16_t)) ? 1 : 0;
 
-		UniformPushConstant uniformPushConstant = {};
-		uniformPushConstant.Model = model->WorldTransform;
-		vkCmdPushConstants(frameData.CommandBuffer, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UniformPushConstant), &uniformPushConstant);
+		const glm::mat4& worldTransform = mScene->GetWorldTransform(*model);
 
 		for (const Mesh& mesh : model->Meshs)
 		{
-			Material* material = mScene->Materials[mesh.MaterialIndex].get();
-			if (material->DescriptorSets == VK_NULL_HANDLE)
+			const Material* material = mScene->Materials[mesh.MaterialIndex].get();
+			if (material->DescriptorSets.empty())
 				continue;
 
-			// set the material for the mesh
-			vkCmdBindDescriptorSets(frameData.CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &material->DescriptorSets, 0, nullptr);
+			const glm::vec3 sphereCenter = glm::vec3(worldTransform * glm::vec4(glm::vec3(mesh.LocalBounds.Sphere), 1.0f));
 
-			// draw the mesh's index buffer
-			vkCmdDrawIndexed(frameData.CommandBuffer, static_cast<uint32_t>(mesh.TriangleCount * 3), 1, static_cast<uint32_t>(mesh.IndexOffset), 0, 0);
+			DrawCommand command;
+			command.DrawModel = model;
+			command.DrawMesh = &mesh;
+			command.DrawMaterial = material;
+			command.ModelIndex = static_cast<uint32_t>(modelIndex);
+			mDrawList.Add(pipeline, static_cast<uint32_t>(mesh.MaterialIndex), geometry, glm::length(sphereCenter - mCameraPosition) / CAMERA_FAR_PLANE, command);
+
+			mModelDrawOffsets[modelIndex + 1] += 1;
+			mTrianglesFullDetail += mesh.TriangleCount;
 		}
 	}
 
-	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frameData.CommandBuffer);
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point sortStartTime = ChronoClock::now();
 
-	// Submit command buffer
-	vkCmdEndRenderPass(frameData.CommandBuffer);
-	VK_CHECK(vkEndCommandBuffer(frameData.CommandBuffer));
+	if (s_SortDrawList)
+	{
+		mDrawList.Sort();
+	}
+
+	const float sortTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - sortStartTime).count();
 
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	const uint32_t drawCount = static_cast<uint32_t>(mDrawList.GetDrawCount());
+	Debug_AssertMsg(drawCount <= mDrawCapacity, "draw list is larger than the scene! %u draws, %u meshes", drawCount, mDrawCapacity);
 
+	// the rows of every model in the order of the list, for PatchDrawTransforms
+	for (size_t modelIndex = 1; modelIndex < mModelDrawOffsets.size(); ++modelIndex)
 	{
-		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		VkSubmitInfo info = {};
-		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		info.waitSemaphoreCount = 1;
-		info.pWaitSemaphores = &frameData.ImageAcquiredSemaphore;
-		info.pWaitDstStageMask = waitStages;
-		info.commandBufferCount = 1;
-		info.pCommandBuffers = &frameData.CommandBuffer;
-		info.signalSemaphoreCount = 1;
-		info.pSignalSemaphores = &frameData.RenderCompleteSemaphore;
+		mModelDrawOffsets[modelIndex] += mModelDrawOffsets[modelIndex - 1];
+	}
+	std::vector<uint32_t> modelDrawCursors(mModelDrawOffsets.begin(), mModelDrawOffsets.end() - 1);
+	mModelDraws.resize(drawCount);
 
-		VK_CHECK(vkQueueSubmit(mGraphicsQueue, 1, &info, frameData.Fence));
+	InstanceData* instances = static_cast<InstanceData*>(frameData.InstanceUploadBufferMemory.MappedData);
+
+	for (uint32_t drawIndex = 0; drawIndex < drawCount; ++drawIndex)
+	{
+		const uint64_t key = mDrawList.GetKey(drawIndex);
+		const DrawCommand& command = mDrawList.GetDraw(drawIndex);
+		const Model& model = *command.DrawModel;
+		const Mesh& mesh = *command.DrawMesh;
+
+		// a group ends at a state change or when it is as large as one indirect call can draw
+		if (mDrawGroups.empty() || mDrawGroups.back().DrawCount == mMaxDrawIndirectCount ||
+			DrawList::GetState(mDrawList.GetKey(mDrawGroups.back().FirstDraw)) != DrawList::GetState(key))
+		{
+			mDrawGroups.push_back({ drawIndex, 0 });
+		}
+
+		DrawGroup& group = mDrawGroups.back();
+		group.DrawCount += 1;
+
+		InstanceData& instance = instances[drawIndex];
+		instance.Model = mScene->GetWorldTransform(model);
+		instance.PositionScale = model.PositionScale;
+		instance.PositionOffset = model.PositionOffset;
+		instance.BoundingSphere = mesh.LocalBounds.Sphere;
+		instance.MaterialIndex = DrawList::GetMaterial(key);
+		instance.VertexOffset = model.Geometry.VertexOffset;
+		instance.LodCount = static_cast<uint32_t>(std::max(mesh.LodCount, 1));
+		instance.DrawGroup = static_cast<uint32_t>(mDrawGroups.size() - 1);
+		instance.DrawGroupStart = group.FirstDraw;
+
+		for (uint32_t lodIndex = 0; lodIndex < instance.LodCount; ++lodIndex)
+		{
+			const MeshLod lod = GetMeshLod(mesh, static_cast<int>(lodIndex));
+
+			InstanceLod& instanceLod = instance.Lods[lodIndex];
+			instanceLod.FirstIndex = model.Geometry.FirstIndex + static_cast<uint32_t>(lod.IndexOffset);
+			instanceLod.IndexCount = static_cast<uint32_t>(lod.TriangleCount * 3);
+			instanceLod.Error = lod.Error;
+			instanceLod.Padding = 0;
+		}
+
+		mModelDraws[modelDrawCursors[command.ModelIndex]++] = drawIndex;
+	}
+
+	if (drawCount > 0)
+	{
+		VkBufferCopy region = {};
+		region.size = drawCount * sizeof(InstanceData);
+		mInstanceCopies.push_back(region);
+	}
+
+	mDrawStatistics.DrawCount = drawCount;
+	mDrawStatistics.SortTime = sortTime;
+	mDrawStatistics.ListRebuilds += 1;
+}
+
+// Model of the draws whose transform moved in the last Scene::UpdateTransforms, staged in the upload buffer of the
+// frame with a copy region per draw. The rest of the instance rows stays as the rebuild wrote it.
+void Renderer::PatchDrawTransforms(FrameData& frameData)
+{
+	InstanceData* instances = static_cast<InstanceData*>(frameData.InstanceUploadBufferMemory.MappedData);
+
+	for (size_t modelIndex = 0; modelIndex + 1 < mModelDrawOffsets.size(); ++modelIndex)
+	{
+		const Model& model = *mScene->Models[modelIndex];
+		if (mScene->Transforms.IsUpdated(model.TransformIndex) == false)
+			continue;
+
+		const glm::mat4& worldTransform = mScene->GetWorldTransform(model);
+		for (uint32_t i = mModelDrawOffsets[modelIndex]; i < mModelDrawOffsets[modelIndex + 1]; ++i)
+		{
+			const uint32_t drawIndex = mModelDraws[i];
+			instances[drawIndex].Model = worldTransform;
+
+			VkBufferCopy region = {};
+			region.srcOffset = drawIndex * sizeof(InstanceData) + offsetof(InstanceData, Model);
+			region.dstOffset = region.srcOffset;
+			region.size = sizeof(glm::mat4);
+			mInstanceCopies.push_back(region);
+		}
+	}
+}
+
+// Copies the staged instance rows into mInstanceBuffer. The draws and cull passes of the frames before may still read
+// it, the copies wait for them and the ones of this frame wait for the copies.
+void Renderer::RecordInstanceCopies(FrameData& frameData)
+{
+	if (mInstanceCopies.empty())
+		return;
+
+	VkCommandBuffer commandBuffer = frameData.CommandBuffer;
+	const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, readStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkCmdCopyBuffer(commandBuffer, frameData.InstanceUploadBuffer, mInstanceBuffer, static_cast<uint32_t>(mInstanceCopies.size()), mInstanceCopies.data());
+
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	mInstanceCopies.clear();
+}
+
+// Clears the counters and the texture requests, then runs cull.comp over the draw list: every draw is moved by its
+// model matrix, tested against the frustum of UpdateUniformBuffer when frustumCulling is on and gets the level of
+// detail of its size on screen. Compacted, the draws are tested and ranked inside their workgroup, the workgroup totals
+// are scanned, then the visible draws are written at their rank. No atomics decide where a draw lands, so the visible
+// ones keep the order of the sorted list. Otherwise one dispatch writes every draw at its own slot, the culled ones
+// without instance. The commands and counts are made visible to the indirect draws of the render pass and the totals
+// and texture requests are copied for ReadCullStatistics.
+void Renderer::RecordCullPass(FrameData& frameData, bool compact, bool frustumCulling)
+{
+	const uint32_t drawCount = static_cast<uint32_t>(mDrawList.GetDrawCount());
+	if (drawCount == 0)
+		return;
+
+	VkCommandBuffer commandBuffer = frameData.CommandBuffer;
+	const uint32_t firstQuery = mCurrentFrame * 2;
+
+	if (mCullQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, mCullQueryPool, firstQuery, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mCullQueryPool, firstQuery);
+	}
+
+	// the draw counts are written by the compaction, only the totals and the screen sizes are accumulated
+	vkCmdFillBuffer(commandBuffer, frameData.CullCounterBuffer, 0, sizeof(CullCounters), 0);
+	vkCmdFillBuffer(commandBuffer, frameData.TextureRequestBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	CullPushConstant cull = {};
+	if (frustumCulling)
+	{
+		BoundingVolumes::FrustumPlanes(mViewProjection, cull.FrustumPlanes);
+	}
+	else
+	{
+		// every sphere is in front of every plane
+		for (glm::vec4& plane : cull.FrustumPlanes)
+		{
+			plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+	cull.CameraPositionPixelScale = glm::vec4(mCameraPosition, mProjectionScale * 0.5f * static_cast<float>(mSwapChainExtent.height));
+	cull.DrawCount = drawCount;
+	cull.ForceLod = s_ForceLod;
+	cull.LodErrorThreshold = s_LodErrorThreshold;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mCullPipelineLayout, 0, 1, &frameData.CullDescriptorSet, 0, nullptr);
+
+	const uint32_t workgroupCount = (drawCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE;
+	const uint32_t compactPasses[] = { CULL_PASS_TEST, CULL_PASS_SCAN, CULL_PASS_COMPACT };
+	const uint32_t inPlacePasses[] = { CULL_PASS_IN_PLACE };
+	const uint32_t* passes = compact ? compactPasses : inPlacePasses;
+	const uint32_t passCount = compact ? 3 : 1;
+
+	for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex)
+	{
+		// each dispatch reads the ranks of the one before
+		if (passIndex > 0)
+		{
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		cull.Pass = passes[passIndex];
+		vkCmdPushConstants(commandBuffer, mCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstant), &cull);
+		vkCmdDispatch(commandBuffer, (cull.Pass == CULL_PASS_SCAN) ? 1 : workgroupCount, 1, 1);
+	}
+
+	if (mCullQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, mCullQueryPool, firstQuery + 1);
+	}
+
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	VkBufferCopy countersRegion = {};
+	countersRegion.size = sizeof(CullCounters);
+	vkCmdCopyBuffer(commandBuffer, frameData.CullCounterBuffer, frameData.CullReadbackBuffer, 1, &countersRegion);
+
+	VkBufferCopy requestsRegion = {};
+	requestsRegion.dstOffset = sizeof(CullCounters);
+	requestsRegion.size = mMaterialCapacity * sizeof(uint32_t);
+	vkCmdCopyBuffer(commandBuffer, frameData.TextureRequestBuffer, frameData.CullReadbackBuffer, 1, &requestsRegion);
+
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	frameData.CullPending = true;
+}
+
+// Totals and texture requests of the last cull pass of the frame, its fence was waited for so they are written
+void Renderer::ReadCullStatistics(FrameData& frameData)
+{
+	if (frameData.CullPending == false)
+		return;
+
+	frameData.CullPending = false;
+
+	const CullCounters* counters = static_cast<const CullCounters*>(frameData.CullReadbackBufferMemory.MappedData);
+	mCullStatistics.TestedCount = counters->TestedCount;
+	mCullStatistics.VisibleCount = counters->VisibleCount;
+	mCullStatistics.GpuTime = 0.0f;
+	mTrianglesDrawn = counters->TriangleCount;
+
+	// the texture level that matches the largest size on screen of the visible draws of the material, streamed in by
+	// the next frames
+	const uint32_t* screenSizes = reinterpret_cast<const uint32_t*>(counters + 1);
+	for (size_t materialIndex = 0; materialIndex < mScene->Materials.size() && materialIndex < mMaterialCapacity; ++materialIndex)
+	{
+		Texture* texture = mScene->Materials[materialIndex]->DiffuseTexture;
+		if (texture == nullptr || screenSizes[materialIndex] == 0)
+			continue;
+
+		float screenSize = 0.0f;
+		memcpy(&screenSize, &screenSizes[materialIndex], sizeof(float));
+		TextureStreaming::RequestMip(*texture, screenSize);
+	}
+
+	if (mCullQueryPool != VK_NULL_HANDLE)
+	{
+		uint64_t timestamps[2] = {};
+		if (vkGetQueryPoolResults(mDevice, mCullQueryPool, mCurrentFrame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			mCullStatistics.GpuTime = static_cast<float>(timestamps[1] - timestamps[0]) * mTimestampPeriod / 1000000.0f;
+		}
+	}
+}
+
+// Records the draw list a state group at a time, a bind is only recorded when the group needs another state than the
+// one before it. The pipelines share mPipelineLayout, so the descriptor sets stay bound across a pipeline change.
+// Indirect, a group is one vkCmdDrawIndexedIndirect of the commands of the cull pass, or one
+// vkCmdDrawIndexedIndirectCount of its visible draws when they were compacted. Direct, each draw picks its level of
+// detail and texture level here.
+void Renderer::RecordDrawList(FrameData& frameData, bool drawIndirect, bool compacted)
+{
+	mDrawStatistics.PipelineBinds = 0;
+	mDrawStatistics.DescriptorSetBinds = 0;
+	mDrawStatistics.IndexBufferBinds = 0;
+	mDrawStatistics.DrawCalls = 0;
+
+	// the cull pass counts them otherwise
+	if (drawIndirect == false)
+	{
+		mTrianglesDrawn = 0;
+	}
+
+	if (mDrawGroups.empty())
+		return;
+
+	VkCommandBuffer commandBuffer = frameData.CommandBuffer;
+
+	// every model draws from its range of the scene geometry buffers, bound once for all of them
+	VkBuffer vertexBuffers[] = { mGeometryPool.GetVertexBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 1, 1, &mInstanceDescriptorSet, 0, nullptr);
+
+	const float pixelScale = mProjectionScale * 0.5f * static_cast<float>(mSwapChainExtent.height);
+
+	uint32_t boundPipeline = UINT32_MAX;
+	uint32_t boundMaterial = UINT32_MAX;
+	uint32_t boundGeometry = UINT32_MAX;
+
+	for (size_t groupIndex = 0; groupIndex < mDrawGroups.size(); ++groupIndex)
+	{
+		const DrawGroup& group = mDrawGroups[groupIndex];
+		const uint64_t key = mDrawList.GetKey(group.FirstDraw);
+		const DrawCommand& command = mDrawList.GetDraw(group.FirstDraw);
+
+		const uint32_t pipeline = DrawList::GetPipeline(key);
+		if (pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, (pipeline == 1) ? mPackedGraphicsPipeline : mGraphicsPipeline);
+			boundPipeline = pipeline;
+			++mDrawStatistics.PipelineBinds;
+		}
+
+		const uint32_t geometry = DrawList::GetGeometry(key);
+		if (geometry != boundGeometry)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, mGeometryPool.GetIndexBuffer(), 0, (geometry == 1) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+			boundGeometry = geometry;
+			++mDrawStatistics.IndexBufferBinds;
+		}
+
+		const uint32_t material = DrawList::GetMaterial(key);
+		if (material != boundMaterial)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &command.DrawMaterial->DescriptorSets[mCurrentFrame], 0, nullptr);
+			boundMaterial = material;
+			++mDrawStatistics.DescriptorSetBinds;
+		}
+
+		const VkDeviceSize offset = group.FirstDraw * sizeof(VkDrawIndexedIndirectCommand);
+		if (compacted)
+		{
+			// the cull pass packed the visible draws of the group at its start and counted them
+			const VkDeviceSize countOffset = sizeof(CullCounters) + groupIndex * sizeof(uint32_t);
+			vkCmdDrawIndexedIndirectCount(commandBuffer, frameData.IndirectBuffer, offset, frameData.CullCounterBuffer, countOffset, group.DrawCount, sizeof(VkDrawIndexedIndirectCommand));
+			++mDrawStatistics.DrawCalls;
+		}
+		else if (drawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, frameData.IndirectBuffer, offset, group.DrawCount, sizeof(VkDrawIndexedIndirectCommand));
+			++mDrawStatistics.DrawCalls;
+		}
+		else
+		{
+			for (uint32_t drawIndex = group.FirstDraw; drawIndex < group.FirstDraw + group.DrawCount; ++drawIndex)
+			{
+				const DrawCommand& draw = mDrawList.GetDraw(drawIndex);
+				const Mesh& mesh = *draw.DrawMesh;
+
+				const float pixelsPerUnit = GetPixelsPerUnit(mScene->GetWorldTransform(*draw.DrawModel), mesh.LocalBounds.Sphere, mCameraPosition, pixelScale);
+				const MeshLod lod = GetMeshLod(mesh, SelectLod(mesh, pixelsPerUnit));
+
+				// the texture level that matches the size of the mesh on screen, streamed in by the next frames
+				if (draw.DrawMaterial->DiffuseTexture != nullptr)
+				{
+					TextureStreaming::RequestMip(*draw.DrawMaterial->DiffuseTexture, 2.0f * mesh.LocalBounds.Sphere.w * pixelsPerUnit);
+				}
+
+				const uint32_t firstIndex = draw.DrawModel->Geometry.FirstIndex + static_cast<uint32_t>(lod.IndexOffset);
+				vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(lod.TriangleCount * 3), 1, firstIndex, draw.DrawModel->Geometry.VertexOffset, drawIndex);
+				++mDrawStatistics.DrawCalls;
+
+				mTrianglesDrawn += lod.TriangleCount;
+			}
+		}
 	}
 }
 
@@ -343,6 +1244,12 @@ void Renderer::FramePresent()
 	{
 		Debug_AssertMsg(result == VK_SUCCESS, "failed to present swap chain image!");
 	}
+
+	if (mTimeToFirstFrame == 0.0f)
+	{
+		mTimeToFirstFrame = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mStartupTime).count();
+		W::Logger::PrintFormat("Renderer - first frame presented after %.2f ms\n", mTimeToFirstFrame);
+	}
 }
 
 void Renderer::InitRenderDoc()
@@ -379,7 +1286,7 @@ void Renderer::InitImGui()
 	init_info.Instance = mInstance;
 	init_info.PhysicalDevice = mPhysicalDevice;
 	init_info.Device = mDevice;
-	init_info.QueueFamily = FindQueueFamilies(mPhysicalDevice).GraphicsFamily;
+	init_info.QueueFamily = mGraphicsFamily;
 	init_info.Queue = mGraphicsQueue;
 	init_info.PipelineCache = VK_NULL_HANDLE;
 	init_info.DescriptorPool = mDescriptorPool;
@@ -428,12 +1335,24 @@ void Renderer::InitVulkan()
 	W::VK::CreateWindowSurface(Application::Current().MainWindow(), mInstance, &mSurface);
 
 	CreateLogicalDevice();
+	mDeviceMemory.Startup(mPhysicalDevice, mDevice);
+
 	CreateSwapChain();
 	CreateImageViews();
 	CreateRenderPass();
 	CreateDescriptorSetLayout();
 	CreateGraphicsPipeline();
+	CreateCullPipeline();
 	CreateCommandPool();
+	if (mTransferFamily >= 0)
+	{
+		mStagingRing.Startup(mDevice, mTransferFamily, mTransferQueue, true, mDeviceMemory, STAGING_RING_SIZE);
+	}
+	else
+	{
+		mStagingRing.Startup(mDevice, mGraphicsFamily, mGraphicsQueue, false, mDeviceMemory, STAGING_RING_SIZE);
+	}
+
 	CreateDepthResources();
 	CreateFramebuffers();
 	CreateUniformBuffers();
@@ -448,7 +1367,7 @@ void Renderer::CleanupSwapChain()
 {
 	vkDestroyImageView(mDevice, mDepthImageView, nullptr);
 	vkDestroyImage(mDevice, mDepthImage, nullptr);
-	vkFreeMemory(mDevice, mDepthImageMemory, nullptr);
+	mDeviceMemory.Free(mDepthImageMemory);
 
 	for (auto framebuffer : mSwapChainFramebuffers)
 	{
@@ -456,6 +1375,7 @@ void Renderer::CleanupSwapChain()
 	}
 
 	vkDestroyPipeline(mDevice, mGraphicsPipeline, nullptr);
+	vkDestroyPipeline(mDevice, mPackedGraphicsPipeline, nullptr);
 	vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
 	vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
 
@@ -485,8 +1405,31 @@ void Renderer::CreateLogicalDevice()
 {
 	QueueFamilyIndices indices = FindQueueFamilies(mPhysicalDevice);
 
+	// the hand off from the transfer queue is tracked with a timeline semaphore, the culled draws are counted by the GPU
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mPhysicalDevice, &deviceProperties);
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(mPhysicalDevice, &features2);
+	}
+
+	if (DEDICATED_TRANSFER_QUEUE && indices.TransferFamily >= 0 && vulkan12Features.timelineSemaphore == VK_TRUE)
+	{
+		mTransferFamily = indices.TransferFamily;
+	}
+
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<int> uniqueQueueFamilies = { indices.GraphicsFamily, indices.PresentFamily };
+	if (mTransferFamily >= 0)
+	{
+		uniqueQueueFamilies.insert(mTransferFamily);
+	}
 
 	float queuePriority = 1.0f;
 	for (int queueFamily : uniqueQueueFamilies)
@@ -499,8 +1442,30 @@ void Renderer::CreateLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+
+	// cooked BCn textures are expanded on the CPU when the device cannot sample them
+	mTextureCompressionBC = (supportedFeatures.textureCompressionBC == VK_TRUE);
+
+	// the indirect draws of a state group are one call, each with the instance data at its firstInstance
+	mDrawIndirectSupported = (supportedFeatures.multiDrawIndirect == VK_TRUE) && (supportedFeatures.drawIndirectFirstInstance == VK_TRUE);
+	mMaxDrawIndirectCount = deviceProperties.limits.maxDrawIndirectCount;
+
+	// the cull pass leaves the draw count of each group in a buffer, the indirect calls read it from there
+	mDrawIndirectCountSupported = mDrawIndirectSupported && (vulkan12Features.drawIndirectCount == VK_TRUE);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &queueFamilyCount, queueFamilies.data());
+	mTimestampPeriod = (queueFamilies[indices.GraphicsFamily].timestampValidBits > 0) ? deviceProperties.limits.timestampPeriod : 0.0f;
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	deviceFeatures.multiDrawIndirect = mDrawIndirectSupported ? VK_TRUE : VK_FALSE;
+	deviceFeatures.drawIndirectFirstInstance = mDrawIndirectSupported ? VK_TRUE : VK_FALSE;
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -510,6 +1475,15 @@ void Renderer::CreateLogicalDevice()
 
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
+	VkPhysicalDeviceVulkan12Features enabledVulkan12Features = {};
+	enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	enabledVulkan12Features.timelineSemaphore = (mTransferFamily >= 0) ? VK_TRUE : VK_FALSE;
+	enabledVulkan12Features.drawIndirectCount = mDrawIndirectCountSupported ? VK_TRUE : VK_FALSE;
+	if (mTransferFamily >= 0 || mDrawIndirectCountSupported)
+	{
+		createInfo.pNext = &enabledVulkan12Features;
+	}
+
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -521,8 +1495,19 @@ void Renderer::CreateLogicalDevice()
 
 	VK_CHECK(vkCreateDevice(mPhysicalDevice, &createInfo, nullptr, &mDevice));
 
+	mGraphicsFamily = indices.GraphicsFamily;
 	vkGetDeviceQueue(mDevice, indices.GraphicsFamily, 0, &mGraphicsQueue);
 	vkGetDeviceQueue(mDevice, indices.PresentFamily, 0, &mPresentQueue);
+
+	if (mTransferFamily >= 0)
+	{
+		vkGetDeviceQueue(mDevice, mTransferFamily, 0, &mTransferQueue);
+		W::Logger::PrintFormat("Renderer - uploads on the transfer queue family %d\n", mTransferFamily);
+	}
+	else
+	{
+		W::Logger::PrintFormat("Renderer - no dedicated transfer queue, uploads on the graphics queue\n");
+	}
 }
 
 void Renderer::CreateSwapChain()
@@ -673,42 +1658,61 @@ void Renderer::CreateDescriptorSetLayout()
 
 	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout));
 
-	VkDescriptorSetLayoutCreateInfo layoutInfo2 = {};
-	layoutInfo2.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo2.bindingCount = 1;
-	layoutInfo2.pBindings = &samplerLayoutBinding;
+	// set 1 - the instance data of the frame, bound once for all of its draws
+	VkDescriptorSetLayoutBinding instanceLayoutBinding = {};
+	instanceLayoutBinding.binding = 0;
+	instanceLayoutBinding.descriptorCount = 1;
+	instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	instanceLayoutBinding.pImmutableSamplers = nullptr;
+	instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo instanceLayoutInfo = {};
+	instanceLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	instanceLayoutInfo.bindingCount = 1;
+	instanceLayoutInfo.pBindings = &instanceLayoutBinding;
 
-	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutInfo2, nullptr, &mDescriptorSetLayout2));
+	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &instanceLayoutInfo, nullptr, &mInstanceSetLayout));
 }
 
 void Renderer::CreateMaterial(Material * material)
 {
-	if (material->DiffuseTexture == nullptr)
-		return;
-
-	std::vector<VkDescriptorSetLayout> layouts(mSwapChainImages.size(), mDescriptorSetLayout);
+	std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, mDescriptorSetLayout);
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = mDescriptorPool;
-	allocInfo.descriptorSetCount = 1;
+	allocInfo.descriptorPool = mMaterialDescriptorPool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
 	allocInfo.pSetLayouts = layouts.data();
 
-	VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocInfo, &material->DescriptorSets));
+	material->DescriptorSets.resize(layouts.size());
+	material->DescriptorImageVersions.resize(layouts.size());
+	VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocInfo, material->DescriptorSets.data()));
+
+	for (uint32_t frameIndex = 0; frameIndex < MAX_FRAMES_IN_FLIGHT; ++frameIndex)
+	{
+		UpdateMaterialDescriptorSet(material, frameIndex);
+	}
+}
 
+void Renderer::UpdateMaterialDescriptorSet(Material * material, uint32_t frameIndex)
+{
 	VkDescriptorBufferInfo bufferInfo = {};
 	bufferInfo.buffer = mUniformBuffers;
 	bufferInfo.offset = 0;
 	bufferInfo.range = sizeof(UniformBufferObject);
 
+	// the placeholder until the texture is created, and for good when the material has none
+	const Texture* diffuseTexture = material->DiffuseTexture;
+	const Texture* texture = (diffuseTexture != nullptr && diffuseTexture->TextureImageView != VK_NULL_HANDLE) ? diffuseTexture : mPlaceholderTexture.get();
+
 	VkDescriptorImageInfo imageInfo = {};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = material->DiffuseTexture->TextureImageView;
-	imageInfo.sampler = material->DiffuseTexture->TextureSampler;
+	imageInfo.imageView = texture->TextureImageView;
+	imageInfo.sampler = texture->TextureSampler;
 
 	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
 
 	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet = material->DescriptorSets;
+	descriptorWrites[0].dstSet = material->DescriptorSets[frameIndex];
 	descriptorWrites[0].dstBinding = 0;
 	descriptorWrites[0].dstArrayElement = 0;
 	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -716,7 +1720,7 @@ void Renderer::CreateMaterial(Material * material)
 	descriptorWrites[0].pBufferInfo = &bufferInfo;
 
 	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[1].dstSet = material->DescriptorSets;
+	descriptorWrites[1].dstSet = material->DescriptorSets[frameIndex];
 	descriptorWrites[1].dstBinding = 1;
 	descriptorWrites[1].dstArrayElement = 0;
 	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -724,14 +1728,18 @@ void Renderer::CreateMaterial(Material * material)
 	descriptorWrites[1].pImageInfo = &imageInfo;
 
 	vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	material->DescriptorImageVersions[frameIndex] = (diffuseTexture != nullptr) ? diffuseTexture->ImageVersion : 0;
 }
 
 void Renderer::CreateGraphicsPipeline()
 {
 	auto vertShaderCode = ReadFile("build/Data/Shaders/shader.vert.spv");
+	auto packedVertShaderCode = ReadFile("build/Data/Shaders/shader_packed.vert.spv");
 	auto fragShaderCode = ReadFile("build/Data/Shaders/shader.frag.spv");
 
 	VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
+	VkShaderModule packedVertShaderModule = CreateShaderModule(packedVertShaderCode);
 	VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -783,6 +1791,36 @@ void Renderer::CreateGraphicsPipeline()
 	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
+	// PackedVertex - the vertex color lives in the w component of the position and is decoded in the shader
+	VkVertexInputBindingDescription packedBindingDescription = {};
+	packedBindingDescription.binding = 0;
+	packedBindingDescription.stride = sizeof(PackedVertex);
+	packedBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	std::array<VkVertexInputAttributeDescription, 3> packedAttributeDescriptions = {};
+
+	packedAttributeDescriptions[0].binding = 0;
+	packedAttributeDescriptions[0].location = 0;
+	packedAttributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UINT;
+	packedAttributeDescriptions[0].offset = offsetof(PackedVertex, Position);
+
+	packedAttributeDescriptions[1].binding = 0;
+	packedAttributeDescriptions[1].location = 1;
+	packedAttributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+	packedAttributeDescriptions[1].offset = offsetof(PackedVertex, UV);
+
+	packedAttributeDescriptions[2].binding = 0;
+	packedAttributeDescriptions[2].location = 2;
+	packedAttributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+	packedAttributeDescriptions[2].offset = offsetof(PackedVertex, Normal);
+
+	VkPipelineVertexInputStateCreateInfo packedVertexInputInfo = {};
+	packedVertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	packedVertexInputInfo.vertexBindingDescriptionCount = 1;
+	packedVertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(packedAttributeDescriptions.size());
+	packedVertexInputInfo.pVertexBindingDescriptions = &packedBindingDescription;
+	packedVertexInputInfo.pVertexAttributeDescriptions = packedAttributeDescriptions.data();
+
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -845,19 +1883,13 @@ void Renderer::CreateGraphicsPipeline()
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(UniformPushConstant);
-
-	std::array<VkDescriptorSetLayout*, 2> sets = { &mDescriptorSetLayout , &mDescriptorSetLayout2 };
+	// set 0 - the material, set 1 - the instance data of the frame
+	std::array<VkDescriptorSetLayout, 2> sets = { mDescriptorSetLayout, mInstanceSetLayout };
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(sets.size());
-	pipelineLayoutInfo.pSetLayouts = sets.front();
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	pipelineLayoutInfo.pSetLayouts = sets.data();
 
 	VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout));
 
@@ -879,10 +1911,71 @@ void Renderer::CreateGraphicsPipeline()
 
 	VK_CHECK(vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mGraphicsPipeline));
 
+	// same state with the quantized vertex layout
+	shaderStages[0].module = packedVertShaderModule;
+	pipelineInfo.pVertexInputState = &packedVertexInputInfo;
+
+	VK_CHECK(vkCreateGraphicsPipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mPackedGraphicsPipeline));
+
 	vkDestroyShaderModule(mDevice, fragShaderModule, nullptr);
+	vkDestroyShaderModule(mDevice, packedVertShaderModule, nullptr);
 	vkDestroyShaderModule(mDevice, vertShaderModule, nullptr);
 }
 
+// Compute pipeline of the cull pass, its set 0 holds the instance data, the indirect commands, the counters, the ranks
+// and the texture requests of a frame. Only created when the device can draw indirect.
+void Renderer::CreateCullPipeline()
+{
+	if (mDrawIndirectSupported == false)
+		return;
+
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
+	for (uint32_t binding = 0; binding < bindings.size(); ++binding)
+	{
+		bindings[binding].binding = binding;
+		bindings[binding].descriptorCount = 1;
+		bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[binding].pImmutableSamplers = nullptr;
+		bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mCullSetLayout));
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstant);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &mCullSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	VK_CHECK(vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &mCullPipelineLayout));
+
+	auto cullShaderCode = ReadFile("build/Data/Shaders/cull.comp.spv");
+	VkShaderModule cullShaderModule = CreateShaderModule(cullShaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = cullShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = mCullPipelineLayout;
+
+	VK_CHECK(vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mCullPipeline));
+
+	vkDestroyShaderModule(mDevice, cullShaderModule, nullptr);
+}
+
 void Renderer::CreateFramebuffers()
 {
 	mSwapChainFramebuffers.resize(mSwapChainImageViews.size());
@@ -931,35 +2024,54 @@ void Renderer::CreateDepthResources()
 	TransitionImageLayout(mDepthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 }
 
-void Renderer::CreateTextureImage(Texture * texture)
+struct TextureUploadFormat
+{
+	VkFormat Format;
+	VkComponentMapping Components;
+};
+
+// BC4 and BC5 hold grey (and alpha) in red and green, the view expands them back
+static TextureUploadFormat GetTextureUploadFormat(TextureFormat format)
 {
-	VkDeviceSize imageSize = texture->TextureWidth * texture->TextureHeight * 4;
-	texture->MipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture->TextureWidth, texture->TextureHeight)))) + 1;
+	const VkComponentMapping identity = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	switch (format)
+	{
+	case TextureFormat::BC1: return { VK_FORMAT_BC1_RGB_UNORM_BLOCK, identity };
+	case TextureFormat::BC4: return { VK_FORMAT_BC4_UNORM_BLOCK, { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE } };
+	case TextureFormat::BC5: return { VK_FORMAT_BC5_UNORM_BLOCK, { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G } };
+	case TextureFormat::BC7: return { VK_FORMAT_BC7_UNORM_BLOCK, identity };
+	default: return { VK_FORMAT_R8G8B8A8_UNORM, identity };
+	}
+}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+void Renderer::CreateTextureImage(Texture * texture)
+{
+	// loaded on the scene workers, usually done by now
+	texture->WaitForPixels();
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, texture->Pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+	// the cooked texture could not be loaded, its materials keep the placeholder
+	if (texture->Mips.empty())
+		return;
 
-	texture->DestroyPixelBuffer();
+	// only the mip tail to start with, the finer levels stream in once the texture is seen
+	texture->MipLevels = static_cast<uint32_t>(texture->Mips.size());
+	texture->TargetMip = TextureStreaming::GetTailMip(*texture);
 
-	VkImageUsageFlags imageFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	CreateImage(texture->TextureWidth, texture->TextureHeight, texture->MipLevels, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, imageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture->TextureImage, texture->TextureImageMemory);
+	// Block compressed data uploads as is, without BC support it is expanded to RGBA8 on the CPU
+	const bool decompress = TextureStreaming::NeedsDecompress(*texture, mTextureCompressionBC);
 
-	TransitionImageLayout(texture->TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->MipLevels);
-	CopyBufferToImage(stagingBuffer, texture->TextureImage, static_cast<uint32_t>(texture->TextureWidth), static_cast<uint32_t>(texture->TextureHeight));
-	//transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+	std::vector<TextureMip> layout;
+	const VkDeviceSize uploadSize = TextureStreaming::GetUploadLayout(*texture, texture->TargetMip, decompress, layout);
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	const StagingRegion staging = mStagingRing.Allocate(uploadSize, STAGING_ALIGNMENT);
+	TextureStreaming::FillUpload(*texture, texture->TargetMip, decompress, layout, static_cast<uint8_t*>(staging.MappedData));
 
-	GenerateMipmaps(texture->TextureImage, VK_FORMAT_R8G8B8A8_UNORM, texture->TextureWidth, texture->TextureHeight, texture->MipLevels);
+	std::unique_ptr<PendingTextureImage> pending = std::make_unique<PendingTextureImage>();
+	RecordTextureUpload(mStagingRing.GetCommandBuffer(), texture, texture->TargetMip, layout, staging.Buffer, staging.Offset, *pending);
+	mPendingTextureImages.push_back(std::move(pending));
 
-	texture->TextureImageView = CreateImageView(texture->TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, texture->MipLevels);
+	// not planned before its first levels are in
+	texture->StreamingPending = true;
 
 	VkSamplerCreateInfo samplerInfo = {};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -982,100 +2094,262 @@ void Renderer::CreateTextureImage(Texture * texture)
 	VK_CHECK(vkCreateSampler(mDevice, &samplerInfo, nullptr, &texture->TextureSampler));
 }
 
-void Renderer::GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels)
+// Creates the image holding the levels [firstMip, MipLevels) of the texture, the copy from the staging buffer and the
+// transitions are recorded into commandBuffer of the staging ring. Its level 0 being firstMip clamps the sampled LOD.
+// The image replaces the one of the texture once the batch is done, see AcquireUploads.
+void Renderer::RecordTextureUpload(VkCommandBuffer commandBuffer, Texture * texture, uint32_t firstMip, const std::vector<TextureMip>& layout, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, PendingTextureImage& pending)
 {
-	// Check if image format supports linear blitting
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, imageFormat, &formatProperties);
+	const bool decompress = TextureStreaming::NeedsDecompress(*texture, mTextureCompressionBC);
+	const TextureUploadFormat uploadFormat = GetTextureUploadFormat(decompress ? TextureFormat::RGBA8 : texture->Format);
 
-	Debug_AssertMsg(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, "texture image format does not support linear blitting!");
+	const uint32_t levelCount = texture->MipLevels - firstMip;
+	const uint32_t width = static_cast<uint32_t>(std::max(texture->TextureWidth >> firstMip, 1));
+	const uint32_t height = static_cast<uint32_t>(std::max(texture->TextureHeight >> firstMip, 1));
+	Debug_Assert(layout.size() == levelCount);
 
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+	std::vector<VkBufferImageCopy> regions(levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = stagingOffset + layout[level].Offset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { std::max(width >> level, 1u), std::max(height >> level, 1u), 1 };
+	}
 
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+	pending.UploadTexture = texture;
+	pending.FirstMip = firstMip;
+	pending.LevelCount = levelCount;
+
+	VkImageUsageFlags imageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	CreateImage(width, height, levelCount, uploadFormat.Format, VK_IMAGE_TILING_OPTIMAL, imageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pending.Image, pending.ImageMemory);
 
-	int32_t mipWidth = texWidth;
-	int32_t mipHeight = texHeight;
+	RecordImageLayoutTransition(commandBuffer, pending.Image, uploadFormat.Format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount);
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, pending.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
 
-	for (uint32_t i = 1; i < mipLevels; i++)
+	if (mStagingRing.IsDedicatedQueue())
 	{
-		barrier.subresourceRange.baseMipLevel = i - 1;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		const VkImageMemoryBarrier release = MakeImageOwnershipBarrier(pending.Image, levelCount, false, mStagingRing.GetQueueFamily(), mGraphicsFamily);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+	}
+	else
+	{
+		RecordImageLayoutTransition(commandBuffer, pending.Image, uploadFormat.Format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levelCount);
+	}
 
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier);
-
-		VkImageBlit blit = {};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		vkCmdBlitImage(commandBuffer,
-			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit,
-			VK_FILTER_LINEAR);
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	pending.ImageView = CreateImageView(pending.Image, uploadFormat.Format, VK_IMAGE_ASPECT_COLOR_BIT, levelCount, uploadFormat.Components);
+	pending.UploadValue = mStagingRing.GetUploadValue();
+}
 
-		vkCmdPipelineBarrier(commandBuffer,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-			0, nullptr,
+// Hands the uploads whose batch is done to the frame recorded into commandBuffer, the textures get their new image and
+// the models become drawable. Never waits, the rest is picked up by a later frame. Returns the timeline value the frame
+// has to wait for on the transfer queue, 0 when it acquired nothing from it.
+uint64_t Renderer::AcquireUploads(VkCommandBuffer commandBuffer)
+{
+	const bool dedicatedQueue = mStagingRing.IsDedicatedQueue();
+	const uint32_t transferFamily = mStagingRing.GetQueueFamily();
+	const uint32_t graphicsFamily = static_cast<uint32_t>(mGraphicsFamily);
+
+	uint64_t waitValue = 0;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+
+	for (size_t i = 0; i < mPendingModelUploads.size();)
+	{
+		const PendingModelUpload& pending = mPendingModelUploads[i];
+		if (mStagingRing.IsUploadComplete(pending.UploadValue) == false)
+		{
+			++i;
+			continue;
+		}
+
+		if (dedicatedQueue)
+		{
+			const GeometryRange& geometry = pending.UploadModel->Geometry;
+			bufferBarriers.push_back(MakeBufferOwnershipBarrier(mGeometryPool.GetVertexBuffer(), geometry.VertexByteOffset, geometry.VertexSize, true, transferFamily, graphicsFamily));
+			bufferBarriers.push_back(MakeBufferOwnershipBarrier(mGeometryPool.GetIndexBuffer(), geometry.IndexByteOffset, geometry.IndexSize, true, transferFamily, graphicsFamily));
+			waitValue = std::max(waitValue, pending.UploadValue);
+		}
+		pending.UploadModel->UploadPending = false;
+		mDrawListDirty = true;
+
+		mPendingModelUploads[i] = mPendingModelUploads.back();
+		mPendingModelUploads.pop_back();
+	}
+
+	for (size_t i = 0; i < mPendingTextureImages.size();)
+	{
+		PendingTextureImage& pending = *mPendingTextureImages[i];
+		if (mStagingRing.IsUploadComplete(pending.UploadValue) == false)
+		{
+			++i;
+			continue;
+		}
+
+		if (dedicatedQueue)
+		{
+			imageBarriers.push_back(MakeImageOwnershipBarrier(pending.Image, pending.LevelCount, true, transferFamily, graphicsFamily));
+			waitValue = std::max(waitValue, pending.UploadValue);
+		}
+
+		// the frames in flight may still sample the image it replaces
+		Texture* texture = pending.UploadTexture;
+		RetireTextureImage(texture, pending.StagingBuffer, pending.StagingBufferMemory);
+
+		const bool decompress = TextureStreaming::NeedsDecompress(*texture, mTextureCompressionBC);
+		texture->TextureImage = pending.Image;
+		texture->TextureImageMemory = pending.ImageMemory;
+		texture->TextureImageView = pending.ImageView;
+		texture->ResidentMip = pending.FirstMip;
+		texture->ResidentBytes = TextureStreaming::GetResidentSize(*texture, pending.FirstMip, decompress);
+		texture->StreamingPending = false;
+		++texture->ImageVersion;
+
+		mPendingTextureImages[i] = std::move(mPendingTextureImages.back());
+		mPendingTextureImages.pop_back();
+	}
+
+	if (bufferBarriers.empty() == false || imageBarriers.empty() == false)
+	{
+		vkCmdPipelineBarrier(commandBuffer, UPLOAD_ACQUIRE_STAGES, UPLOAD_ACQUIRE_STAGES, 0,
 			0, nullptr,
-			1, &barrier);
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	return waitValue;
+}
+
+// The frames in flight may still sample the old image, it goes once they are done
+void Renderer::RetireTextureImage(Texture * texture, VkBuffer stagingBuffer, const DeviceAllocation& stagingBufferMemory)
+{
+	RetiredTextureImage retired = {};
+	retired.RetireFrame = mFrameCount;
+	retired.Image = texture->TextureImage;
+	retired.ImageMemory = texture->TextureImageMemory;
+	retired.ImageView = texture->TextureImageView;
+	retired.StagingBuffer = stagingBuffer;
+	retired.StagingBufferMemory = stagingBufferMemory;
+	mRetiredTextureImages.push_back(retired);
+
+	texture->TextureImage = VK_NULL_HANDLE;
+	texture->TextureImageMemory = DeviceAllocation();
+	texture->TextureImageView = VK_NULL_HANDLE;
+}
+
+void Renderer::DestroyRetiredTextureImages(uint64_t completedFrame)
+{
+	for (size_t i = 0; i < mRetiredTextureImages.size();)
+	{
+		RetiredTextureImage& retired = mRetiredTextureImages[i];
+		if (retired.RetireFrame > completedFrame)
+		{
+			++i;
+			continue;
+		}
+
+		vkDestroyImageView(mDevice, retired.ImageView, nullptr);
+		vkDestroyImage(mDevice, retired.Image, nullptr);
+		mDeviceMemory.Free(retired.ImageMemory);
+		vkDestroyBuffer(mDevice, retired.StagingBuffer, nullptr);
+		mDeviceMemory.Free(retired.StagingBufferMemory);
 
-		if (mipWidth > 1) mipWidth /= 2;
-		if (mipHeight > 1) mipHeight /= 2;
+		mRetiredTextureImages[i] = mRetiredTextureImages.back();
+		mRetiredTextureImages.pop_back();
 	}
+}
 
-	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+void Renderer::UpdateTextureStreaming()
+{
+	// the uploads the workers are done with are copied by the staging ring, their images are picked up by AcquireUploads
+	for (size_t i = 0; i < mTextureUploads.size();)
+	{
+		TextureUpload& upload = *mTextureUploads[i];
+		if (upload.Filled.load(std::memory_order_acquire) == false)
+		{
+			++i;
+			continue;
+		}
 
-	vkCmdPipelineBarrier(commandBuffer,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier);
+		Texture* texture = upload.UploadTexture;
+		if (upload.FirstMip > texture->ResidentMip)
+		{
+			++mTextureEvictions;
+		}
+		mTextureBytesStreamed += upload.Layout.back().Offset + upload.Layout.back().Size;
 
-	EndSingleTimeCommands(commandBuffer);
+		std::unique_ptr<PendingTextureImage> pending = std::make_unique<PendingTextureImage>();
+		RecordTextureUpload(mStagingRing.GetCommandBuffer(), texture, upload.FirstMip, upload.Layout, upload.StagingBuffer, 0, *pending);
+		pending->StagingBuffer = upload.StagingBuffer;
+		pending->StagingBufferMemory = upload.StagingBufferMemory;
+		mPendingTextureImages.push_back(std::move(pending));
+
+		mTextureUploads[i] = std::move(mTextureUploads.back());
+		mTextureUploads.pop_back();
+	}
+
+	// requests of the draws of the last frame against the budget
+	TextureStreaming::Plan(mScene->Textures, static_cast<uint64_t>(s_TextureBudgetMB) << 20, mTextureCompressionBC, mTextureStreamingChanges);
+
+	size_t startedCount = 0;
+	for (Texture* texture : mTextureStreamingChanges)
+	{
+		if (mTextureUploads.size() >= MAX_TEXTURE_UPLOADS_IN_FLIGHT)
+			break;
+
+		std::unique_ptr<TextureUpload> upload = std::make_unique<TextureUpload>();
+		upload->UploadTexture = texture;
+		upload->FirstMip = texture->TargetMip;
+
+		const bool decompress = TextureStreaming::NeedsDecompress(*texture, mTextureCompressionBC);
+		const VkDeviceSize uploadSize = TextureStreaming::GetUploadLayout(*texture, upload->FirstMip, decompress, upload->Layout);
+		CreateBuffer(uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, upload->StagingBuffer, upload->StagingBufferMemory);
+
+		TextureUpload* fillUpload = upload.get();
+		uint8_t* stagingData = static_cast<uint8_t*>(upload->StagingBufferMemory.MappedData);
+		mScene->Workers->Submit([fillUpload, stagingData, decompress]()
+		{
+			TextureStreaming::FillUpload(*fillUpload->UploadTexture, fillUpload->FirstMip, decompress, fillUpload->Layout, stagingData);
+			fillUpload->Filled.store(true, std::memory_order_release);
+		});
+
+		texture->StreamingPending = true;
+		mTextureUploads.push_back(std::move(upload));
+		++startedCount;
+	}
+	mTextureRequestsQueued = static_cast<uint32_t>(mTextureStreamingChanges.size() - startedCount);
+
+	mTextureBytesResident = 0;
+	for (const std::unique_ptr<Texture>& texture : mScene->Textures)
+	{
+		mTextureBytesResident += texture->ResidentBytes;
+	}
+
+	// only the sets of this frame, the other frames in flight may still be reading theirs
+	for (const std::unique_ptr<Material>& material : mScene->Materials)
+	{
+		// untextured materials keep the placeholder
+		if (material->DescriptorSets.empty() || material->DiffuseTexture == nullptr)
+			continue;
+
+		if (material->DescriptorImageVersions[mCurrentFrame] != material->DiffuseTexture->ImageVersion)
+		{
+			UpdateMaterialDescriptorSet(material.get(), mCurrentFrame);
+		}
+	}
 }
 
-VkImageView Renderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
+VkImageView Renderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkComponentMapping components)
 {
 	VkImageViewCreateInfo viewInfo = {};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = format;
+	viewInfo.components = components;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
 	viewInfo.subresourceRange.levelCount = mipLevels;
@@ -1088,7 +2362,7 @@ VkImageView Renderer::CreateImageView(VkImage image, VkFormat format, VkImageAsp
 	return imageView;
 }
 
-void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage & image, VkDeviceMemory & imageMemory)
+void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage & image, DeviceAllocation & imageMemory)
 {
 	VkImageCreateInfo imageInfo = {};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1110,20 +2384,21 @@ void Renderer::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels,
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(mDevice, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-	VK_CHECK(vkAllocateMemory(mDevice, &allocInfo, nullptr, &imageMemory));
+	const DeviceResourceType resourceType = (tiling == VK_IMAGE_TILING_OPTIMAL) ? DeviceResourceType::Optimal : DeviceResourceType::Linear;
+	imageMemory = mDeviceMemory.Allocate(memRequirements, properties, resourceType);
 
-	vkBindImageMemory(mDevice, image, imageMemory, 0);
+	VK_CHECK(vkBindImageMemory(mDevice, image, imageMemory.Memory, imageMemory.Offset));
 }
 
 void Renderer::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 {
 	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+	RecordImageLayoutTransition(commandBuffer, image, format, oldLayout, newLayout, mipLevels);
+	EndSingleTimeCommands(commandBuffer);
+}
 
+void Renderer::RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+{
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
@@ -1192,92 +2467,188 @@ void Renderer::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayo
 		0, nullptr,
 		1, &barrier
 	);
-
-	EndSingleTimeCommands(commandBuffer);
 }
 
-void Renderer::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void Renderer::LoadScene()
 {
+	CreatePlaceholderTexture();
+
+	// sampled by the first materials, so it is waited for
+	mStagingRing.Flush();
+	mStagingRing.WaitIdle();
+
 	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+	AcquireUploads(commandBuffer);
+	EndSingleTimeCommands(commandBuffer);
 
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { width, height, 1 };
+	if (PROGRESSIVE_SCENE_LOADING)
+	{
+		// nothing to draw until the loaded scene is swapped in
+		mScene = std::make_unique<Scene>();
 
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		mSceneLoadThread = std::thread([this]()
+		{
+			mLoadedScene = Scene::Load(SCENE_FILE_PATH);
+			mSceneLoadFinished.store(true, std::memory_order_release);
+		});
+	}
+	else
+	{
+		mLoadedScene = Scene::Load(SCENE_FILE_PATH);
+		mSceneLoadFinished = true;
 
-	EndSingleTimeCommands(commandBuffer);
+		UpdateSceneLoading(true);
+	}
 }
 
-void Renderer::LoadScene()
+// Swaps in the loaded scene and creates the GPU resources of what is ready. Blocking waits for every texture and
+// creates everything, otherwise the work stops once the frame budget is spent and carries on next frame.
+void Renderer::UpdateSceneLoading(bool blocking)
 {
-	mScene = Scene::Load("Data/Scenes/StanfordDragon.fbx");
-	//mScene = Scene::Load("Data/Scenes/StudioLighting.fbx");
+	if (mSceneFullyLoaded)
+		return;
 
-	for (auto& texture : mScene->Textures)
+	// still loading on the load thread
+	if (mSceneLoadFinished.load(std::memory_order_acquire) == false)
+		return;
+
+	if (mLoadedScene != nullptr)
 	{
-		CreateTextureImage(texture.get());
+		if (mSceneLoadThread.joinable())
+		{
+			mSceneLoadThread.join();
+		}
+
+		// the empty scene drawn so far has nothing on the GPU
+		mScene = std::move(mLoadedScene);
+
+		if (mGeometryPool.IsStarted() == false)
+		{
+			VkDeviceSize vertexSize = 0;
+			VkDeviceSize indexSize = 0;
+			for (auto& model : mScene->Models)
+			{
+				// the alignment of the ranges, see GeometryPool::Allocate
+				vertexSize += model->VertexData.size() + sizeof(Vertex);
+				indexSize += model->IndexData.size() + sizeof(uint32_t);
+			}
+
+			vertexSize = std::max(static_cast<VkDeviceSize>(vertexSize * (1.0f + GEOMETRY_POOL_HEADROOM)), GEOMETRY_POOL_MIN_SIZE);
+			indexSize = std::max(static_cast<VkDeviceSize>(indexSize * (1.0f + GEOMETRY_POOL_HEADROOM)), GEOMETRY_POOL_MIN_SIZE);
+			mGeometryPool.Startup(mDevice, mDeviceMemory, vertexSize, indexSize);
+
+			W::Logger::PrintFormat("Renderer - geometry pool of %.1f MB vertices, %.1f MB indices\n", vertexSize / (1024.0f * 1024.0f), indexSize / (1024.0f * 1024.0f));
+		}
+
+		// drawable right away with the placeholder, rewritten as their textures are created
+		CreateMaterialDescriptorPool(mScene->Materials.size());
+		for (auto& material : mScene->Materials)
+		{
+			CreateMaterial(material.get());
+		}
+
+		// the empty scene had no draws, no frame in flight reads the buffers replaced
+		uint32_t drawCapacity = 0;
+		for (auto& model : mScene->Models)
+		{
+			drawCapacity += static_cast<uint32_t>(model->Meshs.size());
+		}
+		CreateDrawBuffers(drawCapacity, static_cast<uint32_t>(mScene->Materials.size()));
+		mDrawListDirty = true;
 	}
 
-	for (auto& material : mScene->Materials)
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+	auto isBudgetSpent = [&]()
 	{
-		CreateMaterial(material.get());
-	}
+		return blocking == false && std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count() > SCENE_LOADING_FRAME_BUDGET;
+	};
 
-	for (auto& model : mScene->Models)
+	bool pending = false;
+	for (auto& texture : mScene->Textures)
 	{
-		CreateVertexBuffer(model.get());
-		CreateIndexBuffer(model.get());
-	}
-}
+		if (texture->MipLevels != 0)
+			continue;
 
-void Renderer::CreateVertexBuffer(Model * model)
-{
-	VkDeviceSize bufferSize = sizeof(Vertex) * model->Vertices.size();
+		// still decoding on the scene workers
+		if (blocking == false && texture->IsLoaded() == false)
+		{
+			pending = true;
+			continue;
+		}
+
+		if (isBudgetSpent())
+		{
+			pending = true;
+			break;
+		}
+
+		CreateTextureImage(texture.get());
+	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	for (auto& model : mScene->Models)
+	{
+		if (model->Geometry.IsValid())
+			continue;
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, model->Vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+		if (isBudgetSpent())
+		{
+			pending = true;
+			break;
+		}
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model->VertexBuffer, model->VertexBufferMemory);
+		CreateModelGeometry(model.get());
 
-	CopyBuffer(stagingBuffer, model->VertexBuffer, bufferSize);
+		// drawable once the copies are done
+		model->UploadPending = true;
+		mPendingModelUploads.push_back({ mStagingRing.GetUploadValue(), model.get() });
+	}
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	if (pending == false)
+	{
+		mSceneFullyLoaded = true;
+		mTimeToFullyLoaded = std::chrono::duration<float, std::milli>(ChronoClock::now() - mStartupTime).count();
+		W::Logger::PrintFormat("Renderer - scene fully loaded after %.2f ms, %zu models, %zu textures\n", mTimeToFullyLoaded, mScene->Models.size(), mScene->Textures.size());
+	}
 }
 
-void Renderer::CreateIndexBuffer(Model * model)
+// 1x1 grey, sampled by the materials until their texture is created
+void Renderer::CreatePlaceholderTexture()
 {
-	VkDeviceSize bufferSize = sizeof(model->Indices[0]) * model->Indices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	mPlaceholderTexture = std::make_unique<Texture>();
+	Texture* texture = mPlaceholderTexture.get();
+	texture->FilePath = "placeholder";
+	texture->TextureWidth = 1;
+	texture->TextureHeight = 1;
+	texture->TextureChannels = 4;
+	texture->Format = TextureFormat::RGBA8;
+	texture->CookedData = { 128, 128, 128, 255 };
+	texture->Data = ArrayView<uint8_t>(texture->CookedData);
+
+	TextureMip mip;
+	mip.Size = texture->CookedData.size();
+	texture->Mips.push_back(mip);
+
+	texture->Decoded = true;
+	CreateTextureImage(texture);
+}
 
-	void* data;
-	vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, model->Indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(mDevice, stagingBufferMemory);
+void Renderer::CreateModelGeometry(Model * model)
+{
+	const uint32_t vertexStride = (model->Format == VertexFormat::Packed) ? sizeof(PackedVertex) : sizeof(Vertex);
+	const VkDeviceSize vertexSize = model->VertexData.size();
+	const VkDeviceSize indexSize = model->IndexData.size();
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, model->IndexBuffer, model->IndexBufferMemory);
+	model->Geometry = mGeometryPool.Allocate(vertexSize, vertexStride, indexSize, model->IndexStride);
+	Debug_AssertMsg(model->Geometry.IsValid(), "geometry pool is full! %s", model->Name.c_str());
 
-	CopyBuffer(stagingBuffer, model->IndexBuffer, bufferSize);
+	const StagingRegion vertexStaging = mStagingRing.Allocate(vertexSize, STAGING_ALIGNMENT);
+	memcpy(vertexStaging.MappedData, model->VertexData.data(), (size_t)vertexSize);
+	CopyBuffer(vertexStaging.Buffer, vertexStaging.Offset, mGeometryPool.GetVertexBuffer(), model->Geometry.VertexByteOffset, vertexSize);
 
-	vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-	vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	const StagingRegion indexStaging = mStagingRing.Allocate(indexSize, STAGING_ALIGNMENT);
+	memcpy(indexStaging.MappedData, model->IndexData.data(), (size_t)indexSize);
+	CopyBuffer(indexStaging.Buffer, indexStaging.Offset, mGeometryPool.GetIndexBuffer(), model->Geometry.IndexByteOffset, indexSize);
 }
 
 void Renderer::CreateUniformBuffers()
@@ -1286,24 +2657,27 @@ void Renderer::CreateUniformBuffers()
 	CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mUniformBuffers, mUniformBuffersMemory);
 }
 
-void Renderer::CreateDescriptorPool()
+// Every material holds one set per frame in flight, each with the uniform buffer and the diffuse texture
+void Renderer::CreateMaterialDescriptorPool(size_t materialCount)
 {
+	const uint32_t setCount = static_cast<uint32_t>(std::max<size_t>(materialCount, 1) * MAX_FRAMES_IN_FLIGHT);
+
 	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = 1000;
+	poolSizes[0].descriptorCount = setCount;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = 1000;
+	poolSizes[1].descriptorCount = setCount;
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = 1000;
+	poolInfo.maxSets = setCount;
 
-	VK_CHECK(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool));
+	VK_CHECK(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mMaterialDescriptorPool));
 }
 
-void Renderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, VkDeviceMemory & bufferMemory)
+void Renderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, DeviceAllocation & bufferMemory)
 {
 	VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1316,13 +2690,8 @@ void Renderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemor
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(mDevice, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties);
-
-	VK_CHECK(vkAllocateMemory(mDevice, &allocInfo, nullptr, &bufferMemory));
-	VK_CHECK(vkBindBufferMemory(mDevice, buffer, bufferMemory, 0));
+	bufferMemory = mDeviceMemory.Allocate(memRequirements, properties, DeviceResourceType::Linear);
+	VK_CHECK(vkBindBufferMemory(mDevice, buffer, bufferMemory.Memory, bufferMemory.Offset));
 }
 
 VkCommandBuffer Renderer::BeginSingleTimeCommands()
@@ -1360,32 +2729,22 @@ void Renderer::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
 	vkFreeCommandBuffers(mDevice, mCommandPool, 1, &commandBuffer);
 }
 
-void Renderer::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+// Recorded into the staging ring batch, the range is released to the graphics queue when it copies on the transfer queue
+void Renderer::CopyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
 {
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+	VkCommandBuffer commandBuffer = mStagingRing.GetCommandBuffer();
 
 	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-	EndSingleTimeCommands(commandBuffer);
-}
-
-uint32_t Renderer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+	if (mStagingRing.IsDedicatedQueue())
 	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-		{
-			return i;
-		}
+		const VkBufferMemoryBarrier release = MakeBufferOwnershipBarrier(dstBuffer, dstOffset, size, false, mStagingRing.GetQueueFamily(), mGraphicsFamily);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release, 0, nullptr);
 	}
-
-	Debug_AssertMsg(false, "failed to find suitable memory type!");
-	return VK_MAX_MEMORY_TYPES;
 }
 
 void Renderer::UpdateUniformBuffer(VkCommandBuffer commandBuffer)
@@ -1399,19 +2758,24 @@ void Renderer::UpdateUniformBuffer(VkCommandBuffer commandBuffer)
 	{
 		Camera* camera = mScene->Cameras[0].get();
 
-		eyePosition = glm::vec3(camera->WorldTransform[3]);
-		cameraDirection = camera->WorldTransform[0];
+		const glm::mat4& cameraTransform = mScene->GetWorldTransform(*camera);
+		eyePosition = glm::vec3(cameraTransform[3]);
+		cameraDirection = cameraTransform[0];
 		lookAtPosition = eyePosition + cameraDirection;
 		fieldOfView = camera->FieldOfView;
 	}
 
 	UniformBufferObject ubo = {};
 	ubo.View = glm::lookAt(eyePosition, lookAtPosition, glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.Projection = glm::perspective(glm::radians(fieldOfView), mSwapChainExtent.width / (float)mSwapChainExtent.height, 0.01f, 1000.0f);
+	ubo.Projection = glm::perspective(glm::radians(fieldOfView), mSwapChainExtent.width / (float)mSwapChainExtent.height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
 	ubo.Projection[1][1] *= -1.0f;
 
 	ubo.CameraPosition = eyePosition;
 
+	mViewProjection = ubo.Projection * ubo.View;
+	mCameraPosition = eyePosition;
+	mProjectionScale = std::fabs(ubo.Projection[1][1]);
+
 	ubo.AmbientLightColor = (glm::vec3&)s_AmbientLightColor;
 	ubo.AmbientLightIntensity = s_AmbientLightIntensity;
 
@@ -1429,7 +2793,8 @@ void Renderer::UpdateUniformBuffer(VkCommandBuffer commandBuffer)
 		Light* light = mScene->Lights[i].get();
 
 		ubo.Lights[i].Type = (int)light->LightType;
-		ubo.Lights[i].Position = glm::vec3(light->WorldTransform[3][0], light->WorldTransform[3][1], light->WorldTransform[3][2]);
+		const glm::mat4& lightTransform = mScene->GetWorldTransform(*light);
+		ubo.Lights[i].Position = glm::vec3(lightTransform[3][0], lightTransform[3][1], lightTransform[3][2]);
 		ubo.Lights[i].Direction = glm::vec3(0.0f, 0.0f, -1.0f);
 		ubo.Lights[i].Color = light->Color;
 		ubo.Lights[i].Intensity = light->Intensity;
@@ -1624,6 +2989,17 @@ QueueFamilyIndices Renderer::FindQueueFamilies(VkPhysicalDevice device)
 		i++;
 	}
 
+	// the copy engine, a family with transfer and without graphics or compute. Transfer is implied by the other two.
+	for (uint32_t family = 0; family < queueFamilyCount; ++family)
+	{
+		const VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+		{
+			indices.TransferFamily = static_cast<int>(family);
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -1704,4 +3080,14 @@ void Renderer::CreateFrameData()
 			VK_CHECK(vkCreateSemaphore(mDevice, &info, nullptr, &frameData.RenderCompleteSemaphore));
 		}
 	}
+
+	// the cull pass of the frame n writes the queries 2n and 2n + 1
+	if (mDrawIndirectSupported && mTimestampPeriod > 0.0f)
+	{
+		VkQueryPoolCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+		VK_CHECK(vkCreateQueryPool(mDevice, &info, nullptr, &mCullQueryPool));
+	}
 }
@@ -4,10 +4,21 @@
 
 #include <vulkan/vulkan.h>
 
+#include "DeviceMemory.h"
+#include "DrawList.h"
+#include "GeometryPool.h"
+#include "StagingRing.h"
+
+#include <atomic>
+#include <chrono>
 #include <unordered_map>
 #include <memory>
+#include <thread>
 
 struct Texture;
+struct TextureMip;
+struct TextureUpload;
+struct PendingTextureImage;
 struct Model;
 struct Material;
 struct Scene;
@@ -16,6 +27,7 @@ struct QueueFamilyIndices
 {
 	int GraphicsFamily = -1;
 	int PresentFamily = -1;
+	int TransferFamily = -1;	// transfer only, -1 when the device has none
 
 	bool IsComplete()
 	{
@@ -66,9 +78,54 @@ struct UniformBufferObject
 	alignas(16) Light		Lights[8];
 };
 
-struct UniformPushConstant
+// Levels of detail of a draw the cull pass picks from, MAX_MESH_LODS of Scene.h
+const int INSTANCE_MAX_LODS = 5;
+
+// Index range of a level of detail of a draw in the scene geometry pool, see MeshLod
+struct InstanceLod
+{
+	alignas(4)  uint32_t	FirstIndex;
+	alignas(4)  uint32_t	IndexCount;
+	alignas(4)  float		Error;			// geometric deviation from the full resolution mesh, model space
+	alignas(4)  uint32_t	Padding;
+};
+
+// Per draw data fetched by the vertex shaders at gl_InstanceIndex, the InstanceBuffer of set 1 (std430). Written when
+// the draw list is rebuilt, only Model is patched when a transform moves, see Renderer::BuildDrawList.
+struct InstanceData
 {
-	alignas(64) glm::mat4	Model;
+	alignas(16) glm::mat4	Model;
+	alignas(16) glm::vec4	PositionScale;	// PackedVertex dequantization
+	alignas(16) glm::vec4	PositionOffset;
+	alignas(16) glm::vec4	BoundingSphere;	// model space, moved by Model in the cull pass
+
+	alignas(4)  uint32_t	MaterialIndex;
+	alignas(4)  int32_t		VertexOffset;
+	alignas(4)  uint32_t	LodCount;
+	alignas(4)  uint32_t	DrawGroup;		// state group of the draw and its first draw, see Renderer::DrawGroup
+	alignas(4)  uint32_t	DrawGroupStart;
+
+	alignas(4)  InstanceLod	Lods[INSTANCE_MAX_LODS];	// std430 aligns a struct of scalars to 4
+};
+
+// Frustum of the cull pass, the planes of UniformBufferObject Projection * View, the level of detail settings and which
+// of its dispatches runs. 128 bytes, the smallest maxPushConstantsSize.
+struct CullPushConstant
+{
+	alignas(16) glm::vec4	FrustumPlanes[6];			// always passing when the culling is off
+	alignas(16) glm::vec4	CameraPositionPixelScale;	// w - cot(fov / 2) * half the viewport height
+	alignas(4)  uint32_t	DrawCount;
+	alignas(4)  uint32_t	Pass;			// CULL_PASS_TEST, CULL_PASS_SCAN, CULL_PASS_COMPACT or CULL_PASS_IN_PLACE of cull.comp
+	alignas(4)  int32_t		ForceLod;		// -1 picks by LodErrorThreshold
+	alignas(4)  float		LodErrorThreshold;	// pixels
+};
+
+// Head of the counter buffer of the cull pass, followed by the visible draw count of every state group
+struct CullCounters
+{
+	alignas(4)  uint32_t	TestedCount;
+	alignas(4)  uint32_t	VisibleCount;
+	alignas(4)  uint32_t	TriangleCount;	// of the visible draws at their level of detail
 };
 
 class Renderer
@@ -96,6 +153,9 @@ private:
 
 	VkQueue mGraphicsQueue = VK_NULL_HANDLE;
 	VkQueue mPresentQueue = VK_NULL_HANDLE;
+	VkQueue mTransferQueue = VK_NULL_HANDLE;
+	int mGraphicsFamily = -1;
+	int mTransferFamily = -1;	// -1 when the staging ring copies on the graphics queue
 
 	VkSwapchainKHR mSwapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> mSwapChainImages;
@@ -106,22 +166,133 @@ private:
 
 	VkRenderPass mRenderPass = VK_NULL_HANDLE;
 	VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
-	VkDescriptorSetLayout mDescriptorSetLayout2 = VK_NULL_HANDLE;
+	VkDescriptorSetLayout mInstanceSetLayout = VK_NULL_HANDLE;
 	VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
 	VkPipeline mGraphicsPipeline = VK_NULL_HANDLE;
+	VkPipeline mPackedGraphicsPipeline = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout mCullSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout mCullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline mCullPipeline = VK_NULL_HANDLE;
+	VkQueryPool mCullQueryPool = VK_NULL_HANDLE;	// a timestamp before and after the cull pass of each frame
 
 	VkCommandPool mCommandPool = VK_NULL_HANDLE;
 
+	DeviceMemoryAllocator mDeviceMemory;
+	StagingRing mStagingRing;
+	GeometryPool mGeometryPool;
+
 	VkImage mDepthImage = VK_NULL_HANDLE;
-	VkDeviceMemory mDepthImageMemory = VK_NULL_HANDLE;
+	DeviceAllocation mDepthImageMemory;
 	VkImageView mDepthImageView = VK_NULL_HANDLE;
 
 	std::unique_ptr<Scene> mScene;
 
+	// Progressive loading - the scene loads on mSceneLoadThread while the frames draw what is ready
+	std::thread mSceneLoadThread;
+	std::atomic<bool> mSceneLoadFinished{ false };
+	std::unique_ptr<Scene> mLoadedScene;
+	std::unique_ptr<Texture> mPlaceholderTexture;
+	bool mSceneFullyLoaded = false;
+
+	std::chrono::steady_clock::time_point mStartupTime;
+	float mTimeToFirstFrame = 0.0f;		// ms
+	float mTimeToFullyLoaded = 0.0f;	// ms
+
+	glm::mat4 mViewProjection = glm::mat4(1.0f);
+	glm::vec3 mCameraPosition = glm::vec3(0.0f);
+	float mProjectionScale = 1.0f; // cot(fov / 2)
+
+	uint64_t mTrianglesDrawn = 0;
+	uint64_t mTrianglesFullDetail = 0;
+
+	// Draws of the last frame and the binds they needed, see RecordDrawList. DrawCount and SortTime are the ones of the
+	// last rebuild of the list, see BuildDrawList.
+	struct DrawStatistics
+	{
+		uint32_t DrawCount = 0;
+		uint32_t PipelineBinds = 0;
+		uint32_t DescriptorSetBinds = 0;
+		uint32_t IndexBufferBinds = 0;
+		uint32_t DrawCalls = 0;			// vkCmdDrawIndexed or vkCmdDrawIndexedIndirect
+		uint32_t ListRebuilds = 0;
+		float SortTime = 0.0f;	// ms
+	};
+
+	// Draws recorded with the same state, split at mMaxDrawIndirectCount
+	struct DrawGroup
+	{
+		uint32_t FirstDraw;
+		uint32_t DrawCount;
+	};
+
+	// Read back from the cull pass of the frame MAX_FRAMES_IN_FLIGHT frames ago
+	struct CullStatistics
+	{
+		uint32_t TestedCount = 0;
+		uint32_t VisibleCount = 0;
+		float GpuTime = 0.0f;	// ms, 0 when the queue has no timestamps
+	};
+
+	// The draw list only changes with the scene, it is rebuilt when a model becomes drawable or the order is toggled.
+	// The instance buffer holds a row per draw in list order and is device local, the rows are written through the
+	// upload buffer of the frame: all of them at a rebuild, the Model of the draws whose transform moved otherwise.
+	DrawList mDrawList;
+	std::vector<DrawGroup> mDrawGroups;
+	DrawStatistics mDrawStatistics;
+	CullStatistics mCullStatistics;
+	bool mDrawListDirty = true;
+	bool mTransformsUpdated = false;	// since the last frame, see Scene::UpdateTransforms
+
+	VkBuffer mInstanceBuffer = VK_NULL_HANDLE;
+	DeviceAllocation mInstanceBufferMemory;
+	VkDescriptorSet mInstanceDescriptorSet = VK_NULL_HANDLE;
+	uint32_t mDrawCapacity = 0;		// every mesh of the scene, see CreateDrawBuffers
+	uint32_t mMaterialCapacity = 0;
+
+	// Instance rows of the draws of every model, the model n has mModelDraws[mModelDrawOffsets[n]] up to the offset of
+	// the model n + 1
+	std::vector<uint32_t> mModelDrawOffsets;
+	std::vector<uint32_t> mModelDraws;
+	std::vector<VkBufferCopy> mInstanceCopies;
+
+	// Texture streaming - the uploads are filled on the scene workers and applied by the next frame
+	std::vector<std::unique_ptr<TextureUpload>> mTextureUploads;
+	std::vector<Texture*> mTextureStreamingChanges;
+
+	struct RetiredTextureImage
+	{
+		uint64_t RetireFrame;
+		VkImage Image;
+		DeviceAllocation ImageMemory;
+		VkImageView ImageView;
+		VkBuffer StagingBuffer;
+		DeviceAllocation StagingBufferMemory;
+	};
+
+	std::vector<RetiredTextureImage> mRetiredTextureImages;
+
+	// Copies of the staging ring batches not known to be done, see AcquireUploads
+	struct PendingModelUpload
+	{
+		uint64_t UploadValue;
+		Model* UploadModel;
+	};
+
+	std::vector<PendingModelUpload> mPendingModelUploads;
+	std::vector<std::unique_ptr<PendingTextureImage>> mPendingTextureImages;
+
+	uint64_t mFrameCount = 0;
+	uint64_t mTextureBytesStreamed = 0;
+	uint64_t mTextureBytesResident = 0;
+	uint32_t mTextureRequestsQueued = 0;
+	uint32_t mTextureEvictions = 0;
+
 	VkBuffer mUniformBuffers = VK_NULL_HANDLE;
-	VkDeviceMemory mUniformBuffersMemory = VK_NULL_HANDLE;
+	DeviceAllocation mUniformBuffersMemory;
 
 	VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorPool mMaterialDescriptorPool = VK_NULL_HANDLE;	// MAX_FRAMES_IN_FLIGHT sets per material of the scene
 
 	uint32_t mCurrentFrame = 0;
 	uint32_t imageIndex = 0;
@@ -132,6 +303,26 @@ private:
 		VkFence             Fence;
 		VkSemaphore         ImageAcquiredSemaphore;
 		VkSemaphore         RenderCompleteSemaphore;
+
+		// Instance rows copied to mInstanceBuffer by the frame, persistently mapped, see BuildDrawList
+		VkBuffer            InstanceUploadBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    InstanceUploadBufferMemory;
+
+		// The cull pass writes the indirect commands into IndirectBuffer and counts them in CullCounterBuffer, ranking
+		// the draws in CullRankBuffer and taking the largest screen size of every material in TextureRequestBuffer, see
+		// RecordCullPass. The totals and the screen sizes are copied to CullReadbackBuffer.
+		VkBuffer            IndirectBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    IndirectBufferMemory;
+		VkBuffer            CullCounterBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    CullCounterBufferMemory;
+		VkBuffer            CullRankBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    CullRankBufferMemory;
+		VkBuffer            TextureRequestBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    TextureRequestBufferMemory;
+		VkBuffer            CullReadbackBuffer = VK_NULL_HANDLE;
+		DeviceAllocation    CullReadbackBufferMemory;
+		VkDescriptorSet     CullDescriptorSet = VK_NULL_HANDLE;
+		bool                CullPending = false;	// the last submit of the frame culled, its counters are read back
 	};
 
 	std::vector<FrameData> mFrameData;
@@ -139,6 +330,11 @@ private:
 	VkAllocationCallbacks mAllocationCallbacks;
 
 	bool mFrameBufferResized = false;
+	bool mTextureCompressionBC = false;
+	bool mDrawIndirectSupported = false;	// multiDrawIndirect and drawIndirectFirstInstance
+	bool mDrawIndirectCountSupported = false;
+	uint32_t mMaxDrawIndirectCount = 1;
+	float mTimestampPeriod = 0.0f;	// ns per tick, 0 when the graphics queue has no timestamps
 
 private:
 	void InitRenderDoc();
@@ -156,33 +352,50 @@ private:
 	void CreateRenderPass();
 	void CreateDescriptorSetLayout();
 	void CreateGraphicsPipeline();
+	void CreateCullPipeline();
 	void CreateFramebuffers();
 	void CreateCommandPool();
 	void CreateDepthResources();
 
 	void CreateTextureImage(Texture* texture);
+	void RecordTextureUpload(VkCommandBuffer commandBuffer, Texture* texture, uint32_t firstMip, const std::vector<TextureMip>& layout, VkBuffer stagingBuffer, VkDeviceSize stagingOffset, PendingTextureImage& pending);
+	uint64_t AcquireUploads(VkCommandBuffer commandBuffer);
+	void RetireTextureImage(Texture* texture, VkBuffer stagingBuffer, const DeviceAllocation& stagingBufferMemory);
+	void DestroyRetiredTextureImages(uint64_t completedFrame);
+	void UpdateTextureStreaming();
+
+	void CreateDrawBuffers(uint32_t drawCapacity, uint32_t materialCapacity);
+	void DestroyDrawBuffers();
+	void BuildDrawList(FrameData& frameData);
+	void PatchDrawTransforms(FrameData& frameData);
+	void RecordInstanceCopies(FrameData& frameData);
+	void RecordCullPass(FrameData& frameData, bool compact, bool frustumCulling);
+	void ReadCullStatistics(FrameData& frameData);
+	void RecordDrawList(FrameData& frameData, bool drawIndirect, bool compacted);
+
 	void CreateMaterial(Material* material);
+	void UpdateMaterialDescriptorSet(Material* material, uint32_t frameIndex);
 
-	void GenerateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
-	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
-	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, VkComponentMapping components = {});
+	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, DeviceAllocation& imageMemory);
 	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
-	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void RecordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
 
 	void LoadScene();
+	void UpdateSceneLoading(bool blocking);
+	void CreatePlaceholderTexture();
 
-	void CreateVertexBuffer(Model* model);
-	void CreateIndexBuffer(Model* model);
+	void CreateModelGeometry(Model* model);
 
 	void CreateUniformBuffers();
-	void CreateDescriptorPool();
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	void CreateMaterialDescriptorPool(size_t materialCount);
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, DeviceAllocation& bufferMemory);
 
 	VkCommandBuffer BeginSingleTimeCommands();
 	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void CopyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
 
 	void UpdateUniformBuffer(VkCommandBuffer commandBuffer);
 
@@ -197,7 +410,6 @@ private:
 	QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);
 	std::vector<const char*> GetRequiredExtensions();
 	bool CheckValidationLayerSupport();
-	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 };
 
 
@@ -1,9 +1,30 @@
 #include "Scene.h"
+#include "BoundingVolumes.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include "VertexPacking.h"
 
 #include <Framework/Debug/Debug.hpp>
+#include <Framework/Cryptography/Hash.hpp>
+#include <Framework/Platform/OperatingSystem.hpp>
+#include <Framework/Threading/ThreadPool.hpp>
 
 #include <glm/glm.hpp>
 
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -11,28 +32,456 @@
 
 static const int TRIANGLE_VERTEX_COUNT = 3;
 
+// Cook setting - store the quantized PackedVertex layout instead of the float Vertex layout
+static const bool SCENE_PACK_VERTICES = true;
+
+// Cook setting - store textures block compressed (BC1/BC4/BC5/BC7) instead of RGBA8
+static const bool SCENE_COMPRESS_TEXTURES = true;
+
+// Cook setting - filter of the texture mip chains
+static const MipFilter SCENE_MIP_FILTER = MipFilter::Kaiser;
+
+//////////////////////////////////////////////////////////////////////////
+//                              Cook Paths                              //
+//////////////////////////////////////////////////////////////////////////
+// Written into the cache headers, the application only loads what was cooked with the settings it was built with
+static uint64_t GetSceneSettingsHash()
+{
+	return W::Hash::DataHash64(&SCENE_PACK_VERTICES, sizeof(SCENE_PACK_VERTICES));
+}
+
+static uint64_t GetTextureSettingsHash()
+{
+	const uint64_t settingsHash = W::Hash::DataHash64(&SCENE_COMPRESS_TEXTURES, sizeof(SCENE_COMPRESS_TEXTURES));
+	return W::Hash::DataHash64(&SCENE_MIP_FILTER, sizeof(SCENE_MIP_FILTER), settingsHash);
+}
+
+static bool HashSourceFile(const char* filePath, uint64_t& sourceHash)
+{
+	W::MappedFile sourceFile;
+	if (sourceFile.Open(filePath) == false)
+		return false;
+
+	sourceHash = W::Hash::DataHash64(sourceFile.Data(), sourceFile.Size());
+	return true;
+}
+
+static std::string GetCachePath(const char* filePath, const char* extension)
+{
+	// cooked data lives next to the compiled shaders, e.g. build/Data/Scenes/StudioLighting.fbx.kscene
+	std::string cachePath = std::string("build/") + filePath + extension;
+
+	// make sure every directory along the path exists
+	for (size_t separator = cachePath.find_first_of("/\\"); separator != std::string::npos; separator = cachePath.find_first_of("/\\", separator + 1))
+	{
+		W::OS::CreateDirectory(cachePath.substr(0, separator).c_str());
+	}
+
+	return cachePath;
+}
+
+// Both separators and the "." and ".." segments resolve to the same key, so "Textures\Brick.png" and
+// "Textures/./Brick.png" share one texture. The case is folded on Windows only, where the file system ignores it;
+// elsewhere "Brick.png" and "brick.png" are different files
+static std::string NormalizeTexturePath(const char* filePath)
+{
+	std::vector<std::string> segments;
+	std::string segment;
+
+	for (const char* c = filePath; ; ++c)
+	{
+		if (*c == '/' || *c == '\\' || *c == '\0')
+		{
+			if (segment == "..")
+			{
+				if (!segments.empty() && segments.back() != "..")
+					segments.pop_back();
+				else
+					segments.push_back(segment);
+			}
+			else if (!segment.empty() && segment != ".")
+			{
+				segments.push_back(segment);
+			}
+
+			segment.clear();
+			if (*c == '\0')
+				break;
+		}
+		else
+		{
+#ifdef _WIN32
+			segment.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(*c))));
+#else
+			segment.push_back(*c);
+#endif
+		}
+	}
+
+	std::string normalizedPath;
+	for (const std::string& pathSegment : segments)
+	{
+		if (!normalizedPath.empty())
+			normalizedPath.push_back('/');
+		normalizedPath += pathSegment;
+	}
+	return normalizedPath;
+}
+
 //////////////////////////////////////////////////////////////////////////
 //                                Texture                               //
 //////////////////////////////////////////////////////////////////////////
-std::unique_ptr<Texture> Texture::Load(const char* filePath)
+// Wall time of the whole batch against the time the loads (or cooks) took summed over all threads
+struct TextureLoadBatch
 {
+	using ChronoClock = std::chrono::steady_clock;
+
+	ChronoClock::time_point StartTime;
+	std::atomic<size_t> PendingCount{ 0 };
+	std::atomic<uint64_t> LoadMicroseconds{ 0 };
+	size_t TextureCount = 0;
+};
+
+// Builds the full mip chain and block compresses it when enabled, the renderer uploads the levels as they are
+static bool CookTexture(Texture& texture, W::ThreadPool& threadPool)
+{
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+
 	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load(filePath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	Debug_AssertMsg(pixels != nullptr, "failed to load texture image!");
+	stbi_uc* pixels = stbi_load(texture.FilePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+	{
+		W::Logger::PrintFormat("TextureCompression - failed to load texture image %s: %s\n", texture.FilePath.c_str(), stbi_failure_reason());
+		return false;
+	}
+
+	texture.TextureWidth = texWidth;
+	texture.TextureHeight = texHeight;
+	texture.TextureChannels = texChannels;
+	texture.Format = SCENE_COMPRESS_TEXTURES ? TextureCompression::ChooseFormat(texChannels, pixels, texWidth, texHeight) : TextureFormat::RGBA8;
+
+	const std::vector<MipImage> mipImages = MipGenerator::Generate(pixels, texWidth, texHeight, SCENE_MIP_FILTER, &threadPool);
+	const uint32_t mipCount = static_cast<uint32_t>(mipImages.size());
+	Debug_Assert(mipCount <= MAX_TEXTURE_MIPS);
+
+	const float mipTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count();
+
+	texture.Mips.resize(mipCount);
+	size_t cookedSize = 0;
+	size_t sourceSize = 0;
+	for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel)
+	{
+		texture.Mips[mipLevel].Offset = cookedSize;
+		texture.Mips[mipLevel].Size = TextureCompression::GetImageSize(texture.Format, mipImages[mipLevel].Width, mipImages[mipLevel].Height);
+		cookedSize += (texture.Mips[mipLevel].Size + 15) & ~size_t(15);
+		sourceSize += mipImages[mipLevel].Pixels.size();
+	}
+	texture.CookedData.assign(cookedSize, 0);
+
+	for (uint32_t mipLevel = 0; mipLevel < mipCount; ++mipLevel)
+	{
+		const MipImage& mipImage = mipImages[mipLevel];
+		TextureCompression::Compress(texture.Format, mipImage.Pixels.data(), mipImage.Width, mipImage.Height, texture.CookedData.data() + texture.Mips[mipLevel].Offset, &threadPool);
+	}
+
+	// quality of the top level against the source
+	std::vector<uint8_t> decodedPixels(static_cast<size_t>(texWidth) * texHeight * 4);
+	TextureCompression::Decompress(texture.Format, texture.CookedData.data(), texWidth, texHeight, decodedPixels.data());
+	const float psnr = TextureCompression::ComputePSNR(decodedPixels.data(), pixels, texWidth, texHeight, texChannels);
+
+	stbi_image_free(pixels);
+	texture.Data = ArrayView<uint8_t>(texture.CookedData);
+
+	const float cookTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count();
+	W::Logger::PrintFormat("TextureCompression - %s: %s %dx%d %d channels, %u mips (%s, %.2f ms), %.1f KB -> %.1f KB, PSNR %.2f dB, %.2f ms\n",
+		texture.FilePath.c_str(), TextureCompression::GetFormatName(texture.Format), texWidth, texHeight, texChannels, mipCount,
+		MipGenerator::GetFilterName(SCENE_MIP_FILTER), mipTime, sourceSize / 1024.0f, texture.Data.size() / 1024.0f, psnr, cookTime);
+	return true;
+}
+
+// Named after the path so shared files share the cache
+static std::string GetTextureCachePath(const char* filePath)
+{
+	char cacheName[64];
+	snprintf(cacheName, sizeof(cacheName), "Textures/%016llx", static_cast<unsigned long long>(W::Hash::StringHash64(NormalizeTexturePath(filePath).c_str())));
+	return GetCachePath(cacheName, ".ktex");
+}
+
+static void LoadTexture(Texture& texture, TextureLoadBatch& batch)
+{
+	const TextureLoadBatch::ChronoClock::time_point startTime = TextureLoadBatch::ChronoClock::now();
+
+	const std::string cachePath = GetTextureCachePath(texture.FilePath.c_str());
+	if (texture.LoadCache(cachePath.c_str(), CacheMatch::AnySource, GetTextureSettingsHash()) == false)
+	{
+		// its materials keep the placeholder
+		W::Logger::PrintFormat("Texture::LoadAsync - missing or outdated cooked texture %s for %s, run kokoromi-cook\n", cachePath.c_str(), texture.FilePath.c_str());
+	}
+
+	const TextureLoadBatch::ChronoClock::time_point endTime = TextureLoadBatch::ChronoClock::now();
+	batch.LoadMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+
+	{
+		std::lock_guard<std::mutex> lock(texture.DecodeMutex);
+		texture.Decoded = true;
+	}
+	texture.DecodeFinished.notify_all();
+
+	if (batch.PendingCount.fetch_sub(1) == 1)
+	{
+		const float wallTime = std::chrono::duration<float, std::milli>(endTime - batch.StartTime).count();
+		const float loadTime = static_cast<float>(batch.LoadMicroseconds.load()) / 1000.0f;
+		W::Logger::PrintFormat("Texture::LoadAsync - %zu textures, wall %.2f ms, load %.2f ms summed over threads (%.1fx)\n",
+			batch.TextureCount, wallTime, loadTime, (wallTime > 0.0f) ? loadTime / wallTime : 1.0f);
+	}
+}
+
+CookResult Texture::Cook(const char* filePath, W::ThreadPool& threadPool)
+{
+	// keyed by the content of the image and the cook settings
+	uint64_t sourceHash = 0;
+	if (HashSourceFile(filePath, sourceHash) == false)
+	{
+		W::Logger::PrintFormat("Texture::Cook - failed to read texture %s\n", filePath);
+		return CookResult::Failed;
+	}
+	const uint64_t settingsHash = GetTextureSettingsHash();
+
+	const std::string cachePath = GetTextureCachePath(filePath);
+
+	Texture texture;
+	texture.FilePath = filePath;
+	if (texture.LoadCache(cachePath.c_str(), CacheMatch::Source, settingsHash, sourceHash))
+		return CookResult::UpToDate;
+
+	if (CookTexture(texture, threadPool) == false)
+		return CookResult::Failed;
+
+	texture.SaveCache(cachePath.c_str(), settingsHash, sourceHash);
+	return CookResult::Cooked;
+}
+
+static void CookTextureTask(Texture& texture, TextureLoadBatch& batch, W::ThreadPool& threadPool)
+{
+	const TextureLoadBatch::ChronoClock::time_point startTime = TextureLoadBatch::ChronoClock::now();
+
+	const CookResult result = Texture::Cook(texture.FilePath.c_str(), threadPool);
+
+	const TextureLoadBatch::ChronoClock::time_point endTime = TextureLoadBatch::ChronoClock::now();
+	batch.LoadMicroseconds.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count());
+
+	{
+		std::lock_guard<std::mutex> lock(texture.DecodeMutex);
+		texture.CookStatus = result;
+		texture.Decoded = true;
+	}
+	texture.DecodeFinished.notify_all();
+
+	if (batch.PendingCount.fetch_sub(1) == 1)
+	{
+		const float wallTime = std::chrono::duration<float, std::milli>(endTime - batch.StartTime).count();
+		const float cookTime = static_cast<float>(batch.LoadMicroseconds.load()) / 1000.0f;
+		W::Logger::PrintFormat("Texture::CookAsync - %zu textures, wall %.2f ms, decode and cook %.2f ms summed over threads (%.1fx)\n",
+			batch.TextureCount, wallTime, cookTime, (wallTime > 0.0f) ? cookTime / wallTime : 1.0f);
+	}
+}
+
+void Texture::CookAsync(const std::vector<std::unique_ptr<Texture>>& textures, W::ThreadPool& threadPool)
+{
+	if (textures.empty())
+		return;
+
+	std::shared_ptr<TextureLoadBatch> batch = std::make_shared<TextureLoadBatch>();
+	batch->StartTime = TextureLoadBatch::ChronoClock::now();
+	batch->PendingCount = textures.size();
+	batch->TextureCount = textures.size();
+
+	for (const std::unique_ptr<Texture>& texture : textures)
+	{
+		Texture* cookTexture = texture.get();
+		threadPool.Submit([cookTexture, batch, &threadPool]()
+		{
+			CookTextureTask(*cookTexture, *batch, threadPool);
+		});
+	}
+}
+
+void Texture::LoadAsync(const std::vector<std::unique_ptr<Texture>>& textures, W::ThreadPool& threadPool)
+{
+	if (textures.empty())
+		return;
 
-	std::unique_ptr<Texture> texture = std::make_unique<Texture>();
-	texture->TextureWidth = texWidth;
-	texture->TextureHeight = texHeight;
-	texture->TextureChannels = texChannels;
-	texture->Pixels = pixels;
+	std::shared_ptr<TextureLoadBatch> batch = std::make_shared<TextureLoadBatch>();
+	batch->StartTime = TextureLoadBatch::ChronoClock::now();
+	batch->PendingCount = textures.size();
+	batch->TextureCount = textures.size();
 
-	return texture;
+	for (const std::unique_ptr<Texture>& texture : textures)
+	{
+		Texture* loadTexture = texture.get();
+		threadPool.Submit([loadTexture, batch]()
+		{
+			LoadTexture(*loadTexture, *batch);
+		});
+	}
+}
+
+void Texture::WaitForPixels()
+{
+	std::unique_lock<std::mutex> lock(DecodeMutex);
+	DecodeFinished.wait(lock, [this]() { return Decoded; });
+}
+
+bool Texture::IsLoaded()
+{
+	std::lock_guard<std::mutex> lock(DecodeMutex);
+	return Decoded;
 }
 
 void Texture::DestroyPixelBuffer()
 {
-	stbi_image_free(Pixels);
-	Pixels = nullptr;
+	Data = ArrayView<uint8_t>();
+	CookedData = std::vector<uint8_t>();
+	CacheFile.reset();
+}
+
+// Materials referencing the same image share one Texture, so it is decoded and uploaded once
+struct TextureRegistry
+{
+	struct Entry
+	{
+		std::string NormalizedPath;
+		Texture* LoadedTexture = nullptr;
+	};
+
+	std::unordered_map<uint64_t, Entry> Entries;
+	size_t ReferenceCount = 0;
+
+	Texture* FindOrLoad(Scene& scene, const char* filePath)
+	{
+		++ReferenceCount;
+
+		const std::string normalizedPath = NormalizeTexturePath(filePath);
+		const uint64_t pathHash = W::Hash::StringHash64(normalizedPath.c_str());
+
+		auto it = Entries.find(pathHash);
+		if (it != Entries.end() && it->second.NormalizedPath == normalizedPath)
+			return it->second.LoadedTexture;
+
+		// cooked by Scene::Cook and loaded later on, see Texture::LoadAsync
+		std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+		texture->FilePath = filePath;
+		Texture* result = texture.get();
+		scene.Textures.push_back(std::move(texture));
+
+		// on a hash collision the second path is simply not shared
+		if (it == Entries.end())
+		{
+			Entries.emplace(pathHash, Entry{ normalizedPath, result });
+		}
+		return result;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                        Scene - Vertex Welding                        //
+//////////////////////////////////////////////////////////////////////////
+static bool VertexEquals(const Vertex& a, const Vertex& b)
+{
+	// exact bit comparison, the converter emits bit identical attributes for shared corners
+	return memcmp(&a, &b, sizeof(Vertex)) == 0;
+}
+
+static uint32_t VertexHash(const Vertex& vertex)
+{
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex must be a multiple of 4 bytes");
+
+	// FNV-1a over the attribute bits
+	uint32_t bits[sizeof(Vertex) / sizeof(uint32_t)];
+	memcpy(bits, &vertex, sizeof(Vertex));
+
+	uint32_t hash = 2166136261u;
+	for (uint32_t word : bits)
+	{
+		hash = (hash ^ word) * 16777619u;
+	}
+
+	return hash ^ (hash >> 15);
+}
+
+// Deduplicates identical vertices and rewrites the index buffer to reference the shared copies
+static void WeldVertices(Model& model)
+{
+	const size_t vertexCount = model.Vertices.size();
+	if (vertexCount == 0)
+		return;
+
+	// open addressing table sized to a power of two with at most 50% load
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2)
+	{
+		tableSize *= 2;
+	}
+
+	const uint32_t EmptySlot = UINT32_MAX;
+	std::vector<uint32_t> table(tableSize, EmptySlot);
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<Vertex> weldedVertices;
+	weldedVertices.reserve(vertexCount);
+
+	for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex)
+	{
+		const Vertex& vertex = model.Vertices[vertexIndex];
+
+		size_t slot = VertexHash(vertex) & (tableSize - 1);
+		while (table[slot] != EmptySlot && VertexEquals(weldedVertices[table[slot]], vertex) == false)
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == EmptySlot)
+		{
+			table[slot] = static_cast<uint32_t>(weldedVertices.size());
+			weldedVertices.push_back(vertex);
+		}
+
+		remap[vertexIndex] = table[slot];
+	}
+
+	for (uint32_t& index : model.Indices)
+	{
+		index = remap[index];
+	}
+
+	W::Logger::PrintFormat("WeldVertices - %s: %zu -> %zu vertices\n", model.Name.c_str(), vertexCount, weldedVertices.size());
+
+	model.Vertices = std::move(weldedVertices);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Scene - Model                             //
+//////////////////////////////////////////////////////////////////////////
+void Model::FinishImport()
+{
+	// Share the corners of adjacent polygons so the index buffer actually indexes
+	WeldVertices(*this);
+
+	// Reorder triangles for the post-transform cache and overdraw, then vertices for fetch locality
+	MeshOptimizer::Optimize(*this);
+
+	// Local bounds of the final vertex set, also the quantization range of the packed positions
+	BoundingVolumes::Build(*this);
+
+	// Clusters for culling at a finer granularity than the whole model
+	Meshlets::Build(*this);
+
+	// Simplified index ranges behind the full resolution ones
+	MeshSimplifier::BuildLods(*this);
+
+	// The GPU ready views reference the converted data
+	VertexPacking::Pack(*this, SCENE_PACK_VERTICES);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -63,24 +512,110 @@ static glm::mat4x4 FbxToGlm(const FbxDouble4x4& in)
 	return glm::mat4x4(FbxToGlm(in[0]), FbxToGlm(in[1]), FbxToGlm(in[2]), FbxToGlm(in[3]));
 }
 
+// Contiguous doubles to floats, four per step: two conversions of two doubles stored as one vector of four floats
+static void ConvertToFloat(const double* source, size_t count, float* destination)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 low = _mm_cvtpd_ps(_mm_loadu_pd(source + i));
+		const __m128 high = _mm_cvtpd_ps(_mm_loadu_pd(source + i + 2));
+		_mm_storeu_ps(destination + i, _mm_movelh_ps(low, high));
+	}
+
+	for (; i < count; ++i)
+	{
+		destination[i] = static_cast<float>(source[i]);
+	}
+}
+
+// Layer element (normals, UVs, colors) ready for a gather over the polygon corners. The direct array is
+// converted to float in one pass and the mapping and reference modes are resolved into one entry per corner.
+struct LayerElementData
+{
+	std::vector<float> Values;			// ComponentCount floats per direct array entry
+	std::vector<int> CornerElements;	// direct array entry of each polygon corner
+	int ComponentCount = 0;
+
+	const float* GetValues(int polygonVertexIndex) const { return &Values[static_cast<size_t>(CornerElements[polygonVertexIndex]) * ComponentCount]; }
+};
+
+template <typename T>
+static bool ExtractLayerElement(FbxLayerElementTemplate<T>* element, const int* polygonVertices, int cornerCount, LayerElementData& result)
+{
+	// FbxVector4, FbxVector2 and FbxColor are plain arrays of doubles
+	static_assert(sizeof(T) % sizeof(double) == 0, "layer element values must be doubles");
+
+	const FbxLayerElement::EMappingMode mappingMode = element->GetMappingMode();
+	if (mappingMode != FbxLayerElement::eByControlPoint && mappingMode != FbxLayerElement::eByPolygonVertex &&
+		mappingMode != FbxLayerElement::eByPolygon && mappingMode != FbxLayerElement::eAllSame)
+	{
+		return false;
+	}
+
+	FbxLayerElementArrayTemplate<T>& directArray = element->GetDirectArray();
+	const int directCount = directArray.GetCount();
+	if (directCount == 0)
+		return false;
+
+	result.ComponentCount = static_cast<int>(sizeof(T) / sizeof(double));
+	result.Values.resize(static_cast<size_t>(directCount) * result.ComponentCount);
+
+	T* directValues = directArray.GetLocked(FbxLayerElementArray::eReadLock);
+	ConvertToFloat(reinterpret_cast<const double*>(directValues), result.Values.size(), result.Values.data());
+	directArray.Release(&directValues);
+
+	result.CornerElements.resize(cornerCount);
+	for (int corner = 0; corner < cornerCount; ++corner)
+	{
+		switch (mappingMode)
+		{
+		case FbxLayerElement::eByControlPoint: result.CornerElements[corner] = polygonVertices[corner]; break;
+		case FbxLayerElement::eByPolygonVertex: result.CornerElements[corner] = corner; break;
+		case FbxLayerElement::eByPolygon: result.CornerElements[corner] = corner / TRIANGLE_VERTEX_COUNT; break;
+		default: result.CornerElements[corner] = 0; break;
+		}
+	}
+
+	if (element->GetReferenceMode() != FbxLayerElement::eDirect)
+	{
+		FbxLayerElementArrayTemplate<int>& indexArray = element->GetIndexArray();
+		const int indexCount = indexArray.GetCount();
+
+		int* indices = indexArray.GetLocked(FbxLayerElementArray::eReadLock);
+		for (int& cornerElement : result.CornerElements)
+		{
+			cornerElement = (cornerElement < indexCount) ? indices[cornerElement] : -1;
+		}
+		indexArray.Release(&indices);
+	}
+
+	for (int cornerElement : result.CornerElements)
+	{
+		if (cornerElement < 0 || cornerElement >= directCount)
+			return false;
+	}
+
+	return true;
+}
+
 static void UpdateSceneObject(SceneObject& obj, FbxObject* fbxObject)
 {
 	obj.Name = fbxObject->GetName();
 }
 
-static void UpdateSceneNode(SceneNode& obj, FbxNode* fbxNode)
+static void UpdateSceneNode(SceneNode& obj, FbxNode* fbxNode, int32_t transformIndex)
 {
 	UpdateSceneObject(obj, fbxNode);
 
-	FbxAMatrix& globalTransform = fbxNode->EvaluateGlobalTransform();
-	obj.WorldTransform = FbxToGlm(globalTransform);
-
-	FbxAMatrix& localTransform = fbxNode->EvaluateLocalTransform();
-	obj.LocalTransform = FbxToGlm(localTransform);
+	// the transform itself lives in Scene::Transforms, added for every FbxNode while walking the node tree
+	obj.TransformIndex = transformIndex;
 }
 
 static void BuildMaterials(Scene& scene, FbxScene* fbxScene)
 {
+	TextureRegistry textureRegistry;
+
 	int materialCount = fbxScene->GetMaterialCount();
 	for (int i = 0; i < materialCount; ++i)
 	{
@@ -99,44 +634,119 @@ static void BuildMaterials(Scene& scene, FbxScene* fbxScene)
 				if (fbxTexture != nullptr)
 				{
 					const char* filePath = fbxTexture->GetFileName();
-
-					std::unique_ptr<Texture> texture = Texture::Load(filePath);
-					material->DiffuseTexture = texture.get();
-					scene.Textures.push_back(std::move(texture));
+					material->DiffuseTexture = textureRegistry.FindOrLoad(scene, filePath);
 				}
 			}
 		}
 
 		scene.Materials.push_back(std::move(material));
 	}
+
+	W::Logger::PrintFormat("Scene::Import - %zu textures for %zu material references\n", scene.Textures.size(), textureRegistry.ReferenceCount);
 }
 
-static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, FbxMesh* fbxMesh)
+// Mesh conversion is split in two. Everything read from the SDK is copied into the task on the calling thread while
+// gathering, next to the calls that modify the FBX scene (node evaluation, polygon cleanup, normal generation). The
+// SDK makes no promise about concurrent reads either, so the conversion on the thread pool only works on those copies
+// and writes its own Model.
+struct MeshConversionTask
+{
+	int PolygonCount = 0;
+	std::vector<int> PolygonVertices;	// control point of each polygon corner
+	std::vector<float> Positions;		// 4 floats per control point
+	std::vector<int> PolygonMaterials;	// node material slot of each polygon, empty when they all use the first one
+	std::vector<int> MaterialSlots;		// scene material of each node material slot
+
+	LayerElementData Normals;
+	LayerElementData UVs;
+	LayerElementData Colors;
+	bool HasNormals = false;
+	bool HasUVs = false;
+	bool HasColors = false;
+
+	std::unique_ptr<Model> Result;
+};
+
+static void ExtractMesh(FbxScene* fbxScene, FbxNode* fbxNode, FbxMesh* fbxMesh, MeshConversionTask& task)
 {
-	std::unique_ptr<Model> model = std::make_unique<Model>();
-	UpdateSceneNode(*model, fbxNode);
+	Debug_Assert(fbxMesh->GetElementMaterial() != nullptr);
+
+	task.PolygonCount = fbxMesh->GetPolygonCount();
+	Debug_Assert(task.PolygonCount > 0);
+
+	const int vertexCount = task.PolygonCount * TRIANGLE_VERTEX_COUNT;
+	Debug_Assert(fbxMesh->GetPolygonVertexCount() == vertexCount);
+
+	const int* polygonVertices = fbxMesh->GetPolygonVertices();
+	task.PolygonVertices.assign(polygonVertices, polygonVertices + vertexCount);
+
+	task.Positions.resize(static_cast<size_t>(fbxMesh->GetControlPointsCount()) * 4);
+	ConvertToFloat(reinterpret_cast<const double*>(fbxMesh->GetControlPoints()), task.Positions.size(), task.Positions.data());
+
+	// the polygons of each material
+	if (fbxMesh->GetElementMaterial()->GetMappingMode() == FbxGeometryElement::eByPolygon)
+	{
+		FbxLayerElementArrayTemplate<int>& materialIndexArray = fbxMesh->GetElementMaterial()->GetIndexArray();
+		Debug_Assert(materialIndexArray.GetCount() == task.PolygonCount);
+
+		int* materialIndices = materialIndexArray.GetLocked(FbxLayerElementArray::eReadLock);
+		task.PolygonMaterials.assign(materialIndices, materialIndices + task.PolygonCount);
+		materialIndexArray.Release(&materialIndices);
+	}
+
+	// the node material slots resolved to the scene materials, see BuildMaterials
+	const int materialCount = fbxScene->GetMaterialCount();
+	task.MaterialSlots.resize(fbxNode->GetMaterialCount(), 0);
+	for (int slot = 0; slot < fbxNode->GetMaterialCount(); ++slot)
+	{
+		FbxSurfaceMaterial* fbxMaterial = fbxNode->GetMaterial(slot);
+		for (int materialIndex = 0; materialIndex < materialCount; ++materialIndex)
+		{
+			if (fbxMaterial == fbxScene->GetMaterial(materialIndex))
+			{
+				task.MaterialSlots[slot] = materialIndex;
+			}
+		}
+	}
+
+	// every attribute is converted to float in one pass over its direct array, with the element of each corner
+	// resolved once per layer
+	task.HasNormals = (fbxMesh->GetElementNormalCount() > 0) && ExtractLayerElement(fbxMesh->GetElementNormal(0), polygonVertices, vertexCount, task.Normals);
+	task.HasUVs = (fbxMesh->GetElementUVCount() > 0) && ExtractLayerElement(fbxMesh->GetElementUV(0), polygonVertices, vertexCount, task.UVs);
+	task.HasColors = (fbxMesh->GetLayer(0)->GetVertexColors() != nullptr) && ExtractLayerElement(fbxMesh->GetLayer(0)->GetVertexColors(), polygonVertices, vertexCount, task.Colors);
+
+	Debug_AssertMsg(task.HasNormals, "failed to get normal");
+}
+
+static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, int32_t transformIndex, FbxMesh* fbxMesh, std::vector<MeshConversionTask>& meshTasks)
+{
+	MeshConversionTask task;
+	task.Result = std::make_unique<Model>();
+	UpdateSceneNode(*task.Result, fbxNode, transformIndex);
 
 	fbxMesh->RemoveBadPolygons();
 	fbxMesh->GenerateNormals();
 
-	Debug_Assert(fbxMesh->GetElementMaterial() != nullptr);
+	ExtractMesh(fbxScene, fbxNode, fbxMesh, task);
 
-	const int polygonCount = fbxMesh->GetPolygonCount();
-	Debug_Assert(polygonCount > 0);
+	meshTasks.push_back(std::move(task));
+}
+
+// Runs on the thread pool, does not call into the SDK
+static void ConvertMesh(MeshConversionTask& task)
+{
+	Model* model = task.Result.get();
 
+	const int polygonCount = task.PolygonCount;
 	const int vertexCount = polygonCount * TRIANGLE_VERTEX_COUNT;
+	const bool materialPerPolygon = (task.PolygonMaterials.empty() == false);
 
-	// Count the polygon count of each material
-	FbxLayerElementArrayTemplate<int>* materialIndexArray = &fbxMesh->GetElementMaterial()->GetIndexArray();
-	FbxGeometryElement::EMappingMode materialMappingMode = fbxMesh->GetElementMaterial()->GetMappingMode();
-	if (materialMappingMode == FbxGeometryElement::eByPolygon)
+	// Count the faces of each material
+	if (materialPerPolygon)
 	{
-		Debug_Assert(materialIndexArray->GetCount() == polygonCount);
-
-		// Count the faces of each material
 		for (int polygonIndex = 0; polygonIndex < polygonCount; ++polygonIndex)
 		{
-			const size_t materialIndex = materialIndexArray->GetAt(polygonIndex);
+			const size_t materialIndex = task.PolygonMaterials[polygonIndex];
 			const size_t requiredMeshSize = materialIndex + 1;
 			if (model->Meshs.size() < requiredMeshSize)
 			{
@@ -146,7 +756,7 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 			model->Meshs[materialIndex].TriangleCount += 1;
 		}
 	}
-	else if (materialMappingMode == FbxGeometryElement::eAllSame)
+	else
 	{
 		model->Meshs.resize(1);
 		model->Meshs[0].TriangleCount = polygonCount;
@@ -158,7 +768,7 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 		for (Mesh& mesh : model->Meshs)
 		{
 			mesh.IndexOffset = currentIndexOffset;
-			currentIndexOffset += mesh.TriangleCount;
+			currentIndexOffset += mesh.TriangleCount * TRIANGLE_VERTEX_COUNT;
 
 			// reset the triangle count to fill in the index buffer
 			mesh.TriangleCount = 0;
@@ -172,13 +782,9 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 		for (int polygonIndex = 0; polygonIndex < polygonCount; ++polygonIndex)
 		{
 			// The material for current face
-			int materiaindex = 0;
-			if (materialMappingMode == FbxGeometryElement::eByPolygon)
-			{
-				materiaindex = materialIndexArray->GetAt(polygonIndex);
-			}
+			const int materialIndex = materialPerPolygon ? task.PolygonMaterials[polygonIndex] : 0;
 
-			Mesh& mesh = model->Meshs[materiaindex];
+			Mesh& mesh = model->Meshs[materialIndex];
 			const int polygonIndexOffset = mesh.IndexOffset + (mesh.TriangleCount * TRIANGLE_VERTEX_COUNT);
 
 			for (int vertexIndex = 0; vertexIndex < TRIANGLE_VERTEX_COUNT; ++vertexIndex)
@@ -191,139 +797,66 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 		}
 	}
 
-	// Populate the index array
+	// The scene material of each mesh
+	for (size_t i = 0; i < model->Meshs.size(); ++i)
 	{
-		for (int i = 0; i < model->Meshs.size(); ++i)
+		if (i < task.MaterialSlots.size())
 		{
-			FbxSurfaceMaterial* fbxMaterial = fbxMesh->GetNode()->GetMaterial(i);
-			int materialCount = fbxScene->GetMaterialCount();
-			for (int materialIndex = 0; materialIndex < materialCount; ++materialIndex)
-			{
-				if (fbxMaterial == fbxScene->GetMaterial(materialIndex))
-				{
-					model->Meshs[i].MaterialIndex = materialIndex;
-				}
-			}
+			model->Meshs[i].MaterialIndex = task.MaterialSlots[i];
 		}
 	}
 
-	// Populate the vertex array
+	// Populate the vertex array - a gather per corner from the attributes extracted by ExtractMesh
 	{
-		const FbxVector4* controlPoints = fbxMesh->GetControlPoints();
-		const FbxGeometryElementNormal* normalElement = nullptr;
-		const FbxGeometryElementUV* uvElement = nullptr;
-		const FbxLayerElementVertexColor* vertexColorSet = nullptr;
+		model->HasVertexColor = task.HasColors;
+
+		model->Vertices.resize(vertexCount);
 
-		// Normals - only support ByControlPoint mapping
-		if (fbxMesh->GetElementNormalCount() > 0)
+		for (int polygonVertexIndex = 0; polygonVertexIndex < vertexCount; ++polygonVertexIndex)
 		{
-			FbxGeometryElement::EMappingMode normalMappingMode = fbxMesh->GetElementNormal(0)->GetMappingMode();
-			if (normalMappingMode == FbxGeometryElement::eByControlPoint ||
-				normalMappingMode == FbxGeometryElement::eByPolygonVertex)
+			Vertex& vertex = model->Vertices[polygonVertexIndex];
+
+			const float* position = &task.Positions[static_cast<size_t>(task.PolygonVertices[polygonVertexIndex]) * 4];
+			vertex.Position = glm::vec3(position[0], position[1], position[2]);
+
+			if (task.HasNormals)
 			{
-				normalElement = fbxMesh->GetElementNormal(0);
+				const float* normal = task.Normals.GetValues(polygonVertexIndex);
+				vertex.Normal = glm::vec3(normal[0], normal[1], normal[2]);
 			}
-		}
 
-		// UVs - only support ByControlPoint mapping
-		if (fbxMesh->GetElementUVCount() > 0)
-		{
-			FbxGeometryElement::EMappingMode uvMappingMode = fbxMesh->GetElementUV(0)->GetMappingMode();
-			if (uvMappingMode == FbxGeometryElement::eByControlPoint ||
-				uvMappingMode == FbxGeometryElement::eByPolygonVertex)
+			if (task.HasUVs)
 			{
-				uvElement = fbxMesh->GetElementUV(0);
+				const float* uv = task.UVs.GetValues(polygonVertexIndex);
+				vertex.UV = glm::vec2(uv[0], 1.0f - uv[1]); // inverted V
 			}
-		}
-
-		if (fbxMesh->GetLayer(0)->GetVertexColors() != nullptr)
-		{
-			vertexColorSet = fbxMesh->GetLayer(0)->GetVertexColors();
-		}
-
-		model->Vertices.resize(vertexCount);
 
-		for (int polygonIndex = 0; polygonIndex < polygonCount; ++polygonIndex)
-		{
-			for (int vertexIndex = 0; vertexIndex < TRIANGLE_VERTEX_COUNT; ++vertexIndex)
+			if (task.HasColors)
 			{
-				int polygonVertexIndex = (polygonIndex * TRIANGLE_VERTEX_COUNT) + vertexIndex;
-				int index = fbxMesh->GetPolygonVertex(polygonIndex, vertexIndex);
-
-				Vertex& vertex = model->Vertices[polygonVertexIndex];
-
-				// Save the vertex position
-				vertex.Position = glm::vec3(
-					static_cast<float>(controlPoints[index][0]),
-					static_cast<float>(controlPoints[index][1]),
-					static_cast<float>(controlPoints[index][2])
-				);
-
-				// Save the vertex normal
-				if (normalElement != nullptr)
-				{
-					int elementIndex = (normalElement->GetMappingMode() == FbxGeometryElement::eByControlPoint) ? index : polygonVertexIndex;
-					if (normalElement->GetReferenceMode() == FbxLayerElement::eIndexToDirect)
-					{
-						elementIndex = normalElement->GetIndexArray().GetAt(elementIndex);
-					}
-
-					FbxVector4 normal = normalElement->GetDirectArray().GetAt(elementIndex);
-					vertex.Normal = FbxToGlm(normal);
-				}
-				else
-				{
-					Debug_AssertMsg(false, "failed to get normal");
-				}
-
-				// Save the vertex UV
-				if (uvElement != nullptr)
-				{
-					int elementIndex = (uvElement->GetMappingMode() == FbxGeometryElement::eByControlPoint) ? index : polygonVertexIndex;
-					if (uvElement->GetReferenceMode() == FbxLayerElement::eIndexToDirect)
-					{
-						elementIndex = uvElement->GetIndexArray().GetAt(elementIndex);
-					}
-
-					FbxVector2 uv = uvElement->GetDirectArray().GetAt(elementIndex);
-					vertex.UV = FbxToGlm(uv);
-					vertex.UV.y = 1.0f - vertex.UV.y; // inverted V
-				}
-
-				// Save the vertex color
-				if (vertexColorSet != nullptr)
-				{
-					int elementIndex = (vertexColorSet->GetMappingMode() == FbxGeometryElement::eByControlPoint) ? index : polygonVertexIndex;
-					if (vertexColorSet->GetReferenceMode() == FbxLayerElement::eIndexToDirect)
-					{
-						elementIndex = vertexColorSet->GetIndexArray().GetAt(elementIndex);
-					}
-
-					FbxColor color = vertexColorSet->GetDirectArray().GetAt(elementIndex);
-					vertex.Color = FbxToGlm(color);
-				}
-				else
-				{
-					vertex.Color = glm::vec3(1.0f, 1.0f, 1.0f);
-				}
+				const float* color = task.Colors.GetValues(polygonVertexIndex);
+				vertex.Color = glm::vec3(color[0], color[1], color[2]);
+			}
+			else
+			{
+				vertex.Color = glm::vec3(1.0f, 1.0f, 1.0f);
 			}
 		}
 	}
 
-	scene.Models.push_back(std::move(model));
+	model->FinishImport();
 }
 
-static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, FbxCamera* fbxCamera)
+static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, int32_t transformIndex, FbxCamera* fbxCamera)
 {
 	std::unique_ptr<Camera> camera = std::make_unique<Camera>();
 
-	UpdateSceneNode(*camera, fbxNode);
+	UpdateSceneNode(*camera, fbxNode, transformIndex);
 	camera->FieldOfView = static_cast<float>(fbxCamera->FieldOfView);
 
 	scene.Cameras.push_back(std::move(camera));
 }
 
-static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, FbxLight* fbxLight)
+static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, int32_t transformIndex, FbxLight* fbxLight)
 {
 	FbxLight::EType fbxLightType = fbxLight->LightType.Get();
 
@@ -338,7 +871,7 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 
 	std::unique_ptr<Light> light = std::make_unique<Light>();
 
-	UpdateSceneNode(*light, fbxNode);
+	UpdateSceneNode(*light, fbxNode, transformIndex);
 	light->LightType = lightType;
 	light->Color = FbxToGlm(fbxLight->Color.Get());
 	light->Intensity = (float)fbxLight->Intensity.Get();
@@ -365,8 +898,12 @@ static void BuildResource(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, Fb
 	scene.Lights.push_back(std::move(light));
 }
 
-static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode)
+static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode, int32_t parentTransformIndex, std::vector<MeshConversionTask>& meshTasks)
 {
+	// depth first, so the transform of a node is always added after the one of its parent
+	FbxAMatrix& localTransform = fbxNode->EvaluateLocalTransform();
+	const int32_t transformIndex = scene.Transforms.AddNode(parentTransformIndex, FbxToGlm(localTransform));
+
 	FbxNodeAttribute* nodeAttribute = fbxNode->GetNodeAttribute();
 	if (nodeAttribute != nullptr)
 	{
@@ -375,7 +912,7 @@ static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode)
 			FbxMesh* fbxMesh = fbxNode->GetMesh();
 			if (fbxMesh != nullptr)
 			{
-				BuildResource(scene, fbxScene, fbxNode, fbxMesh);
+				BuildResource(scene, fbxScene, fbxNode, transformIndex, fbxMesh, meshTasks);
 			}
 		}
 
@@ -384,7 +921,7 @@ static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode)
 			FbxCamera* fbxCamera = fbxNode->GetCamera();
 			if (fbxCamera != nullptr)
 			{
-				BuildResource(scene, fbxScene, fbxNode, fbxCamera);
+				BuildResource(scene, fbxScene, fbxNode, transformIndex, fbxCamera);
 			}
 		}
 
@@ -393,7 +930,7 @@ static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode)
 			FbxLight* fbxLight = fbxNode->GetLight();
 			if (fbxLight != nullptr)
 			{
-				BuildResource(scene, fbxScene, fbxNode, fbxLight);
+				BuildResource(scene, fbxScene, fbxNode, transformIndex, fbxLight);
 			}
 		}
 	}
@@ -401,14 +938,122 @@ static void BuildResources(Scene& scene, FbxScene* fbxScene, FbxNode* fbxNode)
 	const int childCount = fbxNode->GetChildCount();
 	for (int childIndex = 0; childIndex < childCount; ++childIndex)
 	{
-		BuildResources(scene, fbxScene, fbxNode->GetChild(childIndex));
+		BuildResources(scene, fbxScene, fbxNode->GetChild(childIndex), transformIndex, meshTasks);
 	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 //                                Scene                                 //
 //////////////////////////////////////////////////////////////////////////
+bool Scene::UpdateTransforms()
+{
+	if (Transforms.Update() == false)
+		return false;
+
+	for (const std::unique_ptr<Model>& model : Models)
+	{
+		if (Transforms.IsUpdated(model->TransformIndex))
+		{
+			model->UpdateWorldBounds(Transforms.GetWorldTransform(model->TransformIndex));
+		}
+	}
+
+	return true;
+}
+
 std::unique_ptr<Scene> Scene::Load(const char* filePath)
+{
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+
+	// whatever kokoromi-cook wrote last, the source is not read so it does not have to ship
+	const std::string cachePath = GetCachePath(filePath, ".kscene");
+
+	std::unique_ptr<Scene> scene = LoadCache(cachePath.c_str(), CacheMatch::AnySource, GetSceneSettingsHash());
+	if (scene == nullptr)
+	{
+		// nothing to draw, the application keeps running
+		W::Logger::PrintFormat("Scene::Load - missing or outdated cooked scene %s for %s, run kokoromi-cook\n", cachePath.c_str(), filePath);
+		return std::make_unique<Scene>();
+	}
+
+	scene->Workers = std::make_unique<W::ThreadPool>();
+	Texture::LoadAsync(scene->Textures, *scene->Workers);
+
+	const float loadTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count();
+	W::Logger::PrintFormat("Scene::Load - %s %.2f ms\n", filePath, loadTime);
+
+	return scene;
+}
+
+CookResult Scene::Cook(const char* filePath, W::ThreadPool& threadPool)
+{
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+
+	// The cache is keyed by the content of the source file, so the slow path only runs when the source actually changes
+	uint64_t sourceHash = 0;
+	if (HashSourceFile(filePath, sourceHash) == false)
+	{
+		W::Logger::PrintFormat("Scene::Cook - failed to read scene %s\n", filePath);
+		return CookResult::Failed;
+	}
+
+	// changing a cook setting has to re-cook as well
+	const uint64_t settingsHash = GetSceneSettingsHash();
+
+	const std::string cachePath = GetCachePath(filePath, ".kscene");
+
+	// the textures have their own content keys, an edited image re-cooks even when the scene did not change. The
+	// importers start them as soon as the materials are known so they overlap the mesh conversion.
+	std::unique_ptr<Scene> scene = LoadCache(cachePath.c_str(), CacheMatch::Source, settingsHash, sourceHash);
+	const bool cacheHit = (scene != nullptr);
+	if (cacheHit)
+	{
+		Texture::CookAsync(scene->Textures, threadPool);
+	}
+	else
+	{
+		scene = Import(filePath, threadPool);
+		if (scene == nullptr)
+		{
+			W::Logger::PrintFormat("Scene::Cook - failed to import scene %s\n", filePath);
+			return CookResult::Failed;
+		}
+
+		SaveCache(*scene, cachePath.c_str(), settingsHash, sourceHash);
+	}
+
+	CookResult result = cacheHit ? CookResult::UpToDate : CookResult::Cooked;
+	for (const std::unique_ptr<Texture>& texture : scene->Textures)
+	{
+		texture->WaitForPixels();
+
+		if (texture->CookStatus == CookResult::Failed)
+			result = CookResult::Failed;
+		else if (texture->CookStatus == CookResult::Cooked && result == CookResult::UpToDate)
+			result = CookResult::Cooked;
+	}
+
+	const float cookTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count();
+	W::Logger::PrintFormat("Scene::Cook - %s (%s, %zu textures) %.2f ms\n", filePath, cacheHit ? "cache" : "import", scene->Textures.size(), cookTime);
+
+	return result;
+}
+
+std::unique_ptr<Scene> Scene::Import(const char* filePath, W::ThreadPool& threadPool)
+{
+	std::string extension = filePath;
+	extension = extension.substr(std::min(extension.find_last_of('.'), extension.size()));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	if (extension == ".gltf" || extension == ".glb")
+		return ImportGltf(filePath, threadPool);
+
+	return ImportFbx(filePath, threadPool);
+}
+
+std::unique_ptr<Scene> Scene::ImportFbx(const char* filePath, W::ThreadPool& threadPool)
 {
 	// The first thing to do is to create the FBX Manager which is the object allocator for almost all the classes in the SDK
 	FbxManager* fbxManager = FbxManager::Create();
@@ -454,17 +1099,40 @@ std::unique_ptr<Scene> Scene::Load(const char* filePath)
 			geomConverter.Triangulate(fbxScene, TriangulateOpt_Replace);
 
 			// Build the graphics resources
+			std::vector<MeshConversionTask> meshTasks;
 			BuildMaterials(*scene, fbxScene);
-			BuildResources(*scene, fbxScene, fbxScene->GetRootNode());
+			Texture::CookAsync(scene->Textures, threadPool);
+			BuildResources(*scene, fbxScene, fbxScene->GetRootNode(), TransformHierarchy::INVALID_NODE, meshTasks);
+
+			// Convert the meshes in parallel, the models are appended in node order so the result does not depend on scheduling
+			using ChronoClock = std::chrono::steady_clock;
+			const ChronoClock::time_point convertStartTime = ChronoClock::now();
+
+			threadPool.ParallelFor(meshTasks.size(), [&meshTasks](size_t taskIndex)
+			{
+				ConvertMesh(meshTasks[taskIndex]);
+			});
+
+			for (MeshConversionTask& task : meshTasks)
+			{
+				scene->Models.push_back(std::move(task.Result));
+			}
+
+			scene->UpdateTransforms();
+
+			const float convertTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - convertStartTime).count();
+			W::Logger::PrintFormat("Scene::Import - converted %zu meshes on %u threads %.2f ms\n", meshTasks.size(), threadPool.GetThreadCount() + 1, convertTime);
 		}
 		else
 		{
-			Debug_AssertMsg(false, "failed to import scene");
+			W::Logger::PrintFormat("Scene::ImportFbx - failed to import %s: %s\n", filePath, importer->GetStatus().GetErrorString());
+			scene = nullptr;
 		}
 	}
 	else
 	{
-		Debug_AssertMsg(false, "failed to initialize impoter");
+		W::Logger::PrintFormat("Scene::ImportFbx - failed to initialize the importer for %s: %s\n", filePath, importer->GetStatus().GetErrorString());
+		scene = nullptr;
 	}
 
 	// Destroy the importer to release the file.
@@ -4,11 +4,49 @@
 #include <array>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
-#include <glm\glm.hpp>
-#include <glm\gtx\hash.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtx/hash.hpp>
 
-#include <vulkan\vulkan.h>
+#include <vulkan/vulkan.h>
+
+#include <Framework/Platform/MappedFile.hpp>
+#include <Framework/Threading/ThreadPool.hpp>
+
+#include "DeviceMemory.h"
+#include "GeometryPool.h"
+#include "TransformHierarchy.h"
+
+// Read-only view over contiguous data owned elsewhere (a std::vector or a mapped file)
+template <typename T>
+struct ArrayView
+{
+	const T* Data = nullptr;
+	size_t Count = 0;
+
+	ArrayView() = default;
+	ArrayView(const T* data, size_t count) : Data(data), Count(count) {}
+	ArrayView(const std::vector<T>& data) : Data(data.data()), Count(data.size()) {}
+
+	bool empty() const { return Count == 0; }
+	size_t size() const { return Count; }
+	const T* data() const { return Data; }
+
+	const T* begin() const { return Data; }
+	const T* end() const { return Data + Count; }
+
+	const T& operator[](size_t index) const { return Data[index]; }
+};
+
+// Axis aligned box and sphere enclosing the same geometry
+struct Bounds
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+	glm::vec4 Sphere = glm::vec4(0.0f);	// xyz - center, w - radius
+};
 
 struct SceneObject
 {
@@ -17,27 +55,97 @@ struct SceneObject
 
 struct SceneNode : SceneObject
 {
-	glm::mat4x4 WorldTransform;
-	glm::mat4x4 LocalTransform;
+	int32_t TransformIndex = TransformHierarchy::INVALID_NODE;	// row in Scene::Transforms
+};
+
+enum class TextureFormat : uint32_t
+{
+	RGBA8,
+	BC1,	// RGB, 8 bytes per 4x4 block
+	BC4,	// grey, 8 bytes per block
+	BC5,	// grey + alpha, 16 bytes per block
+	BC7,	// RGBA, 16 bytes per block
+};
+
+// Mip level of a cooked texture, Offset is relative to Texture::Data
+struct TextureMip
+{
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+};
+
+const uint32_t MAX_TEXTURE_MIPS = 16;
+
+// Outcome of cooking one source file, see kokoromi-cook
+enum class CookResult : uint32_t
+{
+	UpToDate,	// the cooked data matches the source and the cook settings
+	Cooked,
+	Failed,
+};
+
+// Which cooked cache a LoadCache accepts
+enum class CacheMatch : uint32_t
+{
+	Source,		// cooked from the source content of the given hash
+	AnySource,	// whatever source it was cooked from, the application does not ship the sources
 };
 
 struct Texture
 {
-	static std::unique_ptr<Texture> Load(const char* filePath);
+	// Loads the cooked textures on the thread pool, they have to be cooked beforehand. WaitForPixels blocks
+	// until the one texture is loaded, IsLoaded only checks.
+	static void LoadAsync(const std::vector<std::unique_ptr<Texture>>& textures, W::ThreadPool& threadPool);
+	void WaitForPixels();
+	bool IsLoaded();
 	void DestroyPixelBuffer();
 
+	// Cooks the image into its .ktex unless the one there was cooked from the same content and settings
+	static CookResult Cook(const char* filePath, W::ThreadPool& threadPool);
+
+	// Cooks the textures on the thread pool while the caller carries on, WaitForPixels blocks until the one texture is
+	// cooked and CookStatus holds the outcome. The textures are only placeholders of the paths, nothing is loaded.
+	static void CookAsync(const std::vector<std::unique_ptr<Texture>>& textures, W::ThreadPool& threadPool);
+
+	// Cooked texture cache (.ktex), a cache cooked with other settings never loads, sourceHash is only compared for
+	// CacheMatch::Source
+	bool LoadCache(const char* cachePath, CacheMatch match, uint64_t settingsHash, uint64_t sourceHash = 0);
+	void SaveCache(const char* cachePath, uint64_t settingsHash, uint64_t sourceHash) const;
+
 	// CPU DataBlock
-	int TextureWidth;
-	int TextureHeight;
-	int TextureChannels;
-	void* Pixels;
+	std::string FilePath;
+	int TextureWidth = 0;
+	int TextureHeight = 0;
+	int TextureChannels = 0;	// of the source image
+
+	// CPU DataBlock - cooked mip chain, Data points at CookedData or into the mapped texture cache.
+	// Kept for the lifetime of the texture, the streaming uploads read the levels from it.
+	TextureFormat Format = TextureFormat::RGBA8;
+	std::vector<TextureMip> Mips;
+	std::vector<uint8_t> CookedData;
+	std::unique_ptr<W::MappedFile> CacheFile;
+	ArrayView<uint8_t> Data;
+
+	std::mutex DecodeMutex;
+	std::condition_variable DecodeFinished;
+	bool Decoded = false;
+	CookResult CookStatus = CookResult::UpToDate;	// see CookAsync
+
+	// GPU DataBlock - TextureImage holds the levels [ResidentMip, MipLevels) of the chain, its level 0 is ResidentMip
+	uint32_t MipLevels = 0;
+	uint32_t ResidentMip = 0;
+	uint64_t ResidentBytes = 0;
+	uint32_t ImageVersion = 0;	// bumped every time TextureImageView is replaced
+	VkImage TextureImage = VK_NULL_HANDLE;
+	DeviceAllocation TextureImageMemory;
+	VkImageView TextureImageView = VK_NULL_HANDLE;
+	VkSampler TextureSampler = VK_NULL_HANDLE;
 
-	// GPU DataBlock
-	uint32_t MipLevels;
-	VkImage TextureImage;
-	VkDeviceMemory TextureImageMemory;
-	VkImageView TextureImageView;
-	VkSampler TextureSampler;
+	// Streaming - see TextureStreaming::Plan
+	uint32_t WantedMip = UINT32_MAX;	// finest level a draw asked for this frame
+	float ScreenSize = 0.0f;			// largest size on screen in pixels this frame
+	uint32_t TargetMip = 0;
+	bool StreamingPending = false;		// levels are being uploaded
 };
 
 struct Material : SceneObject
@@ -45,8 +153,9 @@ struct Material : SceneObject
 	// CPU DataBlock
 	Texture* DiffuseTexture = nullptr;
 
-	// GPU DataBlock
-	VkDescriptorSet DescriptorSets = VK_NULL_HANDLE;
+	// GPU DataBlock - one set per frame in flight, each rewritten when the texture image changes
+	std::vector<VkDescriptorSet> DescriptorSets;
+	std::vector<uint32_t> DescriptorImageVersions;
 };
 
 struct Vertex
@@ -57,26 +166,94 @@ struct Vertex
 	glm::vec3 Normal;
 };
 
+// Quantized vertex, 16 bytes instead of the 44 of Vertex
+struct PackedVertex
+{
+	uint16_t Position[4];	// xyz - unorm16 relative to the model bounds, w - RGB565 vertex color
+	int16_t Normal[2];		// octahedral encoded snorm16
+	uint16_t UV[2];			// half floats
+};
+
+enum class VertexFormat : uint32_t
+{
+	Float,	// Vertex
+	Packed,	// PackedVertex
+};
+
+// Cluster of at most Meshlets::MAX_VERTICES vertices and Meshlets::MAX_TRIANGLES triangles, the unit of cluster culling
+struct Meshlet
+{
+	glm::vec4 BoundingSphere;	// xyz - center, w - radius, model space
+	glm::vec4 ConeAxisCutoff;	// xyz - normal cone axis, w - sine of the cone angle, 1 when the cone can not cull
+	uint32_t VertexOffset;		// first entry in Model::MeshletVertices
+	uint32_t TriangleOffset;	// first entry in Model::MeshletTriangles, 3 local indices per triangle
+	uint32_t VertexCount;
+	uint32_t TriangleCount;
+};
+
+// Level of detail of a Mesh, an index range sharing the vertex buffer of the full resolution Mesh
+struct MeshLod
+{
+	int IndexOffset = 0;
+	int TriangleCount = 0;
+	float Error = 0.0f;		// geometric deviation from the full resolution Mesh, model space
+};
+
+const int MAX_MESH_LODS = 5;
+
 struct Mesh
 {
 	int IndexOffset = 0;
 	int TriangleCount = 0;
 	int MaterialIndex = 0;
+	int MeshletOffset = 0;
+	int MeshletCount = 0;
+	Bounds LocalBounds;	// full resolution index range
+
+	// Lods[0] is the full resolution range above, see MeshSimplifier
+	int LodCount = 0;
+	MeshLod Lods[MAX_MESH_LODS];
 };
 
 struct Model : SceneNode
 {
 	std::vector<Mesh> Meshs;
 
-	// CPU DataBlock
+	// Bounds of every vertex, WorldBounds is refreshed by Scene::UpdateTransforms
+	Bounds LocalBounds;
+	Bounds WorldBounds;
+
+	void UpdateWorldBounds(const glm::mat4& worldTransform);
+
+	// Run by every importer once Vertices/Indices/Meshs are filled - welds and optimizes the geometry, then builds
+	// the bounds, meshlets, lods and the GPU ready views
+	void FinishImport();
+
+	// CPU DataBlock - filled by the importer, left empty when loaded from a scene cache
 	std::vector<Vertex> Vertices;
 	std::vector<uint32_t> Indices;
+	bool HasVertexColor = false;
 
-	// GPU DataBlock
-	VkBuffer VertexBuffer;
-	VkDeviceMemory VertexBufferMemory;
-	VkBuffer IndexBuffer;
-	VkDeviceMemory IndexBufferMemory;
+	// CPU DataBlock - meshlets of every Mesh range, see Meshlets
+	std::vector<Meshlet> Meshlets;
+	std::vector<uint32_t> MeshletVertices;	// model vertex index of each meshlet vertex
+	std::vector<uint8_t> MeshletTriangles;	// meshlet local vertex indices
+
+	// CPU DataBlock - packed copies of Vertices/Indices, see VertexPacking
+	std::vector<PackedVertex> PackedVertices;
+	std::vector<uint16_t> PackedIndices;
+
+	// CPU DataBlock - GPU ready data, points at the vectors above or into the mapped scene cache
+	VertexFormat Format = VertexFormat::Float;
+	uint32_t IndexStride = sizeof(uint32_t);
+	glm::vec4 PositionScale = glm::vec4(1.0f);	// Packed only, dequantization of the positions
+	glm::vec4 PositionOffset = glm::vec4(0.0f);
+	ArrayView<uint8_t> VertexData;
+	ArrayView<uint8_t> IndexData;
+
+	// GPU DataBlock - drawable once its range of the scene geometry buffers is filled
+	GeometryRange Geometry;
+	bool UploadPending = false;	// the range is still being copied
 };
 
 struct Camera : SceneNode
@@ -100,7 +277,7 @@ enum class LightType
 
 struct Light : SceneNode
 {
-	LightType LightType;
+	::LightType LightType;
 	glm::vec3 Color;
 	float Intensity;
 	float InnerAngle;
@@ -109,11 +286,41 @@ struct Light : SceneNode
 
 struct Scene
 {
+	// Loads the cooked .kscene for the source file and starts loading its textures, the source itself is never read
 	static std::unique_ptr<Scene> Load(const char* filePath);
 
+	// Imports the scene into its .kscene unless the one there was cooked from the same content and settings,
+	// then cooks the textures it references the same way. Run by kokoromi-cook, not by the application.
+	static CookResult Cook(const char* filePath, W::ThreadPool& threadPool);
+
+	// Source import (slow path), .gltf/.glb go to ImportGltf and everything else to the FBX SDK. nullptr when the
+	// source can not be read or parsed.
+	static std::unique_ptr<Scene> Import(const char* filePath, W::ThreadPool& threadPool);
+	static std::unique_ptr<Scene> ImportFbx(const char* filePath, W::ThreadPool& threadPool);
+	static std::unique_ptr<Scene> ImportGltf(const char* filePath, W::ThreadPool& threadPool);
+
+	// Binary scene cache (.kscene), a cache cooked with other settings never loads, sourceHash is only compared for
+	// CacheMatch::Source
+	static std::unique_ptr<Scene> LoadCache(const char* cachePath, CacheMatch match, uint64_t settingsHash, uint64_t sourceHash = 0);
+	static void SaveCache(const Scene& scene, const char* cachePath, uint64_t settingsHash, uint64_t sourceHash);
+
+	// Recomputes the world transforms of the nodes that moved and the world bounds of their models, false when none
+	// moved. TransformHierarchy::IsUpdated tells the nodes apart until the next call that moves one.
+	bool UpdateTransforms();
+
+	const glm::mat4& GetWorldTransform(const SceneNode& node) const { return Transforms.GetWorldTransform(node.TransformIndex); }
+
+	TransformHierarchy Transforms;
+
 	std::vector<std::unique_ptr<Model>> Models;
 	std::vector<std::unique_ptr<Material>> Materials;
 	std::vector<std::unique_ptr<Texture>> Textures;
 	std::vector<std::unique_ptr<Camera>> Cameras;
 	std::vector<std::unique_ptr<Light>> Lights;
+
+	// Keeps the cache mapped while models reference its vertex/index data
+	std::unique_ptr<W::MappedFile> CacheFile;
+
+	// Runs the texture decodes that outlive the load, declared last so it finishes them before the textures are destroyed
+	std::unique_ptr<W::ThreadPool> Workers;
 };
\ No newline at end of file
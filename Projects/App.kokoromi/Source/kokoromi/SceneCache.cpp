@@ -0,0 +1,478 @@
+#include "Scene.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Cryptography/Hash.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+//////////////////////////////////////////////////////////////////////////
+//                        Scene Cache - Format                          //
+//////////////////////////////////////////////////////////////////////////
+// A .kscene file is the header followed by the textures, materials, cameras,
+// lights and models in that order. Vertex and index arrays are stored 16 byte
+// aligned in their GPU layout so they can be used in place from the mapping.
+static const uint32_t SCENE_CACHE_MAGIC = 0x4E43534B; // "KSCN"
+static const uint32_t SCENE_CACHE_VERSION = 10;
+static const size_t SCENE_CACHE_ALIGNMENT = 16;
+
+struct SceneCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint64_t SettingsHash;	// cook settings, checked whatever the CacheMatch
+	uint64_t FileSize;
+	uint32_t TextureCount;
+	uint32_t MaterialCount;
+	uint32_t CameraCount;
+	uint32_t LightCount;
+	uint32_t ModelCount;
+	uint32_t Reserved;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                        Scene Cache - Writer                          //
+//////////////////////////////////////////////////////////////////////////
+class SceneCacheWriter
+{
+public:
+	std::vector<uint8_t> Buffer;
+
+	void WriteBytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		Buffer.insert(Buffer.end(), bytes, bytes + size);
+	}
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "scene cache values must be trivially copyable");
+		WriteBytes(&value, sizeof(T));
+	}
+
+	void WriteString(const std::string& text)
+	{
+		Write(static_cast<uint32_t>(text.size()));
+		WriteBytes(text.data(), text.size());
+	}
+
+	template <typename T>
+	void WriteArray(ArrayView<T> data)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "scene cache arrays must be trivially copyable");
+		Write(static_cast<uint64_t>(data.size()));
+		Align();
+		WriteBytes(data.data(), data.size() * sizeof(T));
+	}
+
+	void Align()
+	{
+		Buffer.resize((Buffer.size() + SCENE_CACHE_ALIGNMENT - 1) & ~(SCENE_CACHE_ALIGNMENT - 1), 0);
+	}
+
+	void WriteSceneNode(const SceneNode& node)
+	{
+		WriteString(node.Name);
+		Write(node.TransformIndex);
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                        Scene Cache - Reader                          //
+//////////////////////////////////////////////////////////////////////////
+class SceneCacheReader
+{
+private:
+	const uint8_t* mData;
+	size_t mSize;
+	size_t mOffset = 0;
+	bool mValid = true;
+
+public:
+	SceneCacheReader(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+	bool IsValid() const { return mValid; }
+
+	const uint8_t* ReadBytes(size_t size)
+	{
+		if (mValid == false || size > mSize - mOffset)
+		{
+			mValid = false;
+			return nullptr;
+		}
+
+		const uint8_t* bytes = mData + mOffset;
+		mOffset += size;
+		return bytes;
+	}
+
+	template <typename T>
+	void Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "scene cache values must be trivially copyable");
+		const uint8_t* bytes = ReadBytes(sizeof(T));
+		if (bytes != nullptr)
+		{
+			memcpy(&value, bytes, sizeof(T));
+		}
+	}
+
+	void ReadString(std::string& text)
+	{
+		uint32_t length = 0;
+		Read(length);
+
+		const uint8_t* bytes = ReadBytes(length);
+		if (bytes != nullptr)
+		{
+			text.assign(reinterpret_cast<const char*>(bytes), length);
+		}
+	}
+
+	// Arrays are not copied, the view points straight into the mapped file
+	template <typename T>
+	void ReadArray(ArrayView<T>& data)
+	{
+		uint64_t count = 0;
+		Read(count);
+		Align();
+
+		if (count > (mSize - mOffset) / sizeof(T))
+		{
+			mValid = false;
+			return;
+		}
+
+		const uint8_t* bytes = ReadBytes(static_cast<size_t>(count) * sizeof(T));
+		if (bytes != nullptr)
+		{
+			data = ArrayView<T>(reinterpret_cast<const T*>(bytes), static_cast<size_t>(count));
+		}
+	}
+
+	void Align()
+	{
+		size_t alignedOffset = (mOffset + SCENE_CACHE_ALIGNMENT - 1) & ~(SCENE_CACHE_ALIGNMENT - 1);
+		ReadBytes(alignedOffset - mOffset);
+	}
+
+	void ReadSceneNode(SceneNode& node)
+	{
+		ReadString(node.Name);
+		Read(node.TransformIndex);
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                             Scene Cache                              //
+//////////////////////////////////////////////////////////////////////////
+std::unique_ptr<Scene> Scene::LoadCache(const char* cachePath, CacheMatch match, uint64_t settingsHash, uint64_t sourceHash)
+{
+	std::unique_ptr<W::MappedFile> cacheFile = std::make_unique<W::MappedFile>();
+	if (cacheFile->Open(cachePath) == false)
+		return nullptr;
+
+	SceneCacheReader reader(cacheFile->Data(), cacheFile->Size());
+
+	SceneCacheHeader header = {};
+	reader.Read(header);
+	if (reader.IsValid() == false ||
+		header.Magic != SCENE_CACHE_MAGIC ||
+		header.Version != SCENE_CACHE_VERSION ||
+		header.SettingsHash != settingsHash ||
+		(match == CacheMatch::Source && header.SourceHash != sourceHash) ||
+		header.FileSize != cacheFile->Size())
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
+
+	// Textures - loaded once the rest of the cache has been validated
+	std::vector<std::string> texturePaths(header.TextureCount);
+	for (std::string& texturePath : texturePaths)
+	{
+		reader.ReadString(texturePath);
+	}
+
+	// Materials
+	std::vector<int32_t> materialTextures(header.MaterialCount, -1);
+	for (uint32_t i = 0; i < header.MaterialCount; ++i)
+	{
+		std::unique_ptr<Material> material = std::make_unique<Material>();
+		reader.ReadString(material->Name);
+		reader.Read(materialTextures[i]);
+
+		scene->Materials.push_back(std::move(material));
+	}
+
+	// Transforms - parents are stored before their children
+	ArrayView<int32_t> transformParents;
+	ArrayView<glm::mat4> localTransforms;
+	reader.ReadArray(transformParents);
+	reader.ReadArray(localTransforms);
+
+	// Cameras
+	for (uint32_t i = 0; i < header.CameraCount; ++i)
+	{
+		std::unique_ptr<Camera> camera = std::make_unique<Camera>();
+		reader.ReadSceneNode(*camera);
+		reader.Read(camera->FieldOfView);
+
+		scene->Cameras.push_back(std::move(camera));
+	}
+
+	// Lights
+	for (uint32_t i = 0; i < header.LightCount; ++i)
+	{
+		std::unique_ptr<Light> light = std::make_unique<Light>();
+		reader.ReadSceneNode(*light);
+		reader.Read(light->LightType);
+		reader.Read(light->Color);
+		reader.Read(light->Intensity);
+		reader.Read(light->InnerAngle);
+		reader.Read(light->OuterAngle);
+
+		scene->Lights.push_back(std::move(light));
+	}
+
+	// Models
+	for (uint32_t i = 0; i < header.ModelCount; ++i)
+	{
+		std::unique_ptr<Model> model = std::make_unique<Model>();
+		reader.ReadSceneNode(*model);
+
+		ArrayView<Mesh> meshs;
+		reader.ReadArray(meshs);
+		model->Meshs.assign(meshs.begin(), meshs.end());
+		reader.Read(model->LocalBounds);
+
+		reader.Read(model->Format);
+		reader.Read(model->IndexStride);
+		reader.Read(model->PositionScale);
+		reader.Read(model->PositionOffset);
+		reader.ReadArray(model->VertexData);
+		reader.ReadArray(model->IndexData);
+
+		ArrayView<Meshlet> meshlets;
+		ArrayView<uint32_t> meshletVertices;
+		ArrayView<uint8_t> meshletTriangles;
+		reader.ReadArray(meshlets);
+		reader.ReadArray(meshletVertices);
+		reader.ReadArray(meshletTriangles);
+		model->Meshlets.assign(meshlets.begin(), meshlets.end());
+		model->MeshletVertices.assign(meshletVertices.begin(), meshletVertices.end());
+		model->MeshletTriangles.assign(meshletTriangles.begin(), meshletTriangles.end());
+
+		scene->Models.push_back(std::move(model));
+	}
+
+	if (reader.IsValid() == false)
+		return nullptr;
+
+	for (uint32_t i = 0; i < header.MaterialCount; ++i)
+	{
+		if (materialTextures[i] >= static_cast<int32_t>(header.TextureCount))
+			return nullptr;
+	}
+
+	if (transformParents.size() != localTransforms.size())
+		return nullptr;
+
+	for (size_t i = 0; i < transformParents.size(); ++i)
+	{
+		if (transformParents[i] < TransformHierarchy::INVALID_NODE || transformParents[i] >= static_cast<int32_t>(i))
+			return nullptr;
+	}
+
+	const int32_t transformCount = static_cast<int32_t>(transformParents.size());
+	const auto isValidTransform = [transformCount](const SceneNode& node) { return node.TransformIndex >= 0 && node.TransformIndex < transformCount; };
+	for (const std::unique_ptr<Camera>& camera : scene->Cameras)
+	{
+		if (isValidTransform(*camera) == false)
+			return nullptr;
+	}
+	for (const std::unique_ptr<Light>& light : scene->Lights)
+	{
+		if (isValidTransform(*light) == false)
+			return nullptr;
+	}
+	for (const std::unique_ptr<Model>& model : scene->Models)
+	{
+		if (isValidTransform(*model) == false)
+			return nullptr;
+	}
+
+	for (const std::unique_ptr<Model>& model : scene->Models)
+	{
+		const size_t vertexStride = (model->Format == VertexFormat::Packed) ? sizeof(PackedVertex) : sizeof(Vertex);
+		if ((model->Format != VertexFormat::Float && model->Format != VertexFormat::Packed) ||
+			(model->IndexStride != sizeof(uint16_t) && model->IndexStride != sizeof(uint32_t)) ||
+			(model->VertexData.size() % vertexStride) != 0 ||
+			(model->IndexData.size() % model->IndexStride) != 0)
+		{
+			return nullptr;
+		}
+
+		// every range the Renderer draws or culls from, summed in size_t so a corrupt one can not wrap around
+		const size_t indexCount = model->IndexData.size() / model->IndexStride;
+		const auto isValidIndexRange = [indexCount](int indexOffset, int triangleCount)
+		{
+			return indexOffset >= 0 && triangleCount >= 0 && static_cast<size_t>(indexOffset) + static_cast<size_t>(triangleCount) * 3 <= indexCount;
+		};
+
+		for (const Mesh& mesh : model->Meshs)
+		{
+			if (mesh.MaterialIndex < 0 || static_cast<uint32_t>(mesh.MaterialIndex) >= header.MaterialCount)
+				return nullptr;
+
+			// the full resolution range, drawn as is when the mesh has no levels
+			if (isValidIndexRange(mesh.IndexOffset, mesh.TriangleCount) == false)
+				return nullptr;
+
+			if (mesh.LodCount < 0 || mesh.LodCount > MAX_MESH_LODS)
+				return nullptr;
+
+			for (int lod = 0; lod < mesh.LodCount; ++lod)
+			{
+				if (isValidIndexRange(mesh.Lods[lod].IndexOffset, mesh.Lods[lod].TriangleCount) == false)
+					return nullptr;
+			}
+
+			if (mesh.MeshletOffset < 0 || mesh.MeshletCount < 0 ||
+				static_cast<size_t>(mesh.MeshletOffset) + static_cast<size_t>(mesh.MeshletCount) > model->Meshlets.size())
+			{
+				return nullptr;
+			}
+		}
+
+		for (const Meshlet& meshlet : model->Meshlets)
+		{
+			if (static_cast<size_t>(meshlet.VertexOffset) + meshlet.VertexCount > model->MeshletVertices.size() ||
+				static_cast<size_t>(meshlet.TriangleOffset) + static_cast<size_t>(meshlet.TriangleCount) * 3 > model->MeshletTriangles.size())
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	for (const std::string& texturePath : texturePaths)
+	{
+		std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+		texture->FilePath = texturePath;
+		scene->Textures.push_back(std::move(texture));
+	}
+
+	for (uint32_t i = 0; i < header.MaterialCount; ++i)
+	{
+		if (materialTextures[i] >= 0)
+		{
+			scene->Materials[i]->DiffuseTexture = scene->Textures[materialTextures[i]].get();
+		}
+	}
+
+	scene->Transforms.Reserve(transformParents.size());
+	for (size_t i = 0; i < transformParents.size(); ++i)
+	{
+		scene->Transforms.AddNode(transformParents[i], localTransforms[i]);
+	}
+	scene->UpdateTransforms();
+
+	scene->CacheFile = std::move(cacheFile);
+	return scene;
+}
+
+void Scene::SaveCache(const Scene& scene, const char* cachePath, uint64_t settingsHash, uint64_t sourceHash)
+{
+	SceneCacheWriter writer;
+
+	SceneCacheHeader header = {};
+	header.Magic = SCENE_CACHE_MAGIC;
+	header.Version = SCENE_CACHE_VERSION;
+	header.SourceHash = sourceHash;
+	header.SettingsHash = settingsHash;
+	header.TextureCount = static_cast<uint32_t>(scene.Textures.size());
+	header.MaterialCount = static_cast<uint32_t>(scene.Materials.size());
+	header.CameraCount = static_cast<uint32_t>(scene.Cameras.size());
+	header.LightCount = static_cast<uint32_t>(scene.Lights.size());
+	header.ModelCount = static_cast<uint32_t>(scene.Models.size());
+	writer.Write(header);
+
+	// Textures
+	for (const std::unique_ptr<Texture>& texture : scene.Textures)
+	{
+		writer.WriteString(texture->FilePath);
+	}
+
+	// Materials
+	for (const std::unique_ptr<Material>& material : scene.Materials)
+	{
+		int32_t textureIndex = -1;
+		for (size_t i = 0; i < scene.Textures.size(); ++i)
+		{
+			if (scene.Textures[i].get() == material->DiffuseTexture)
+			{
+				textureIndex = static_cast<int32_t>(i);
+			}
+		}
+
+		writer.WriteString(material->Name);
+		writer.Write(textureIndex);
+	}
+
+	// Transforms
+	writer.WriteArray(ArrayView<int32_t>(scene.Transforms.GetParents()));
+	writer.WriteArray(ArrayView<glm::mat4>(scene.Transforms.GetLocalTransforms()));
+
+	// Cameras
+	for (const std::unique_ptr<Camera>& camera : scene.Cameras)
+	{
+		writer.WriteSceneNode(*camera);
+		writer.Write(camera->FieldOfView);
+	}
+
+	// Lights
+	for (const std::unique_ptr<Light>& light : scene.Lights)
+	{
+		writer.WriteSceneNode(*light);
+		writer.Write(light->LightType);
+		writer.Write(light->Color);
+		writer.Write(light->Intensity);
+		writer.Write(light->InnerAngle);
+		writer.Write(light->OuterAngle);
+	}
+
+	// Models
+	for (const std::unique_ptr<Model>& model : scene.Models)
+	{
+		writer.WriteSceneNode(*model);
+		writer.WriteArray(ArrayView<Mesh>(model->Meshs));
+		writer.Write(model->LocalBounds);
+		writer.Write(model->Format);
+		writer.Write(model->IndexStride);
+		writer.Write(model->PositionScale);
+		writer.Write(model->PositionOffset);
+		writer.WriteArray(model->VertexData);
+		writer.WriteArray(model->IndexData);
+		writer.WriteArray(ArrayView<Meshlet>(model->Meshlets));
+		writer.WriteArray(ArrayView<uint32_t>(model->MeshletVertices));
+		writer.WriteArray(ArrayView<uint8_t>(model->MeshletTriangles));
+	}
+
+	// patch the final size into the header, a truncated write is then detected as a stale cache
+	header.FileSize = writer.Buffer.size();
+	memcpy(writer.Buffer.data(), &header, sizeof(header));
+
+	std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		W::Logger::PrintFormat("Scene::SaveCache - failed to open %s\n", cachePath);
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(writer.Buffer.data()), writer.Buffer.size());
+	file.close();
+}
@@ -0,0 +1,892 @@
+#include "Scene.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Text/Json.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+//////////////////////////////////////////////////////////////////////////
+//                         Scene glTF - Format                          //
+//////////////////////////////////////////////////////////////////////////
+// glTF 2.0, a JSON document describing the scene and binary buffers holding the geometry.
+// A .glb is the JSON and the first buffer in one file, a .gltf references its buffers by uri.
+static const uint32_t GLB_MAGIC = 0x46546C67;		// "glTF"
+static const uint32_t GLB_VERSION = 2;
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;	// "JSON"
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;	// "BIN\0"
+
+struct GlbHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Length;
+};
+
+struct GlbChunkHeader
+{
+	uint32_t Length;
+	uint32_t Type;
+};
+
+static const int GLTF_MODE_TRIANGLES = 4;
+
+enum GltfComponentType
+{
+	GltfComponentType_Byte = 5120,
+	GltfComponentType_UnsignedByte = 5121,
+	GltfComponentType_Short = 5122,
+	GltfComponentType_UnsignedShort = 5123,
+	GltfComponentType_UnsignedInt = 5125,
+	GltfComponentType_Float = 5126,
+};
+
+// The buffers are views into the mapped files, the accessors read straight out of them
+struct GltfDocument
+{
+	std::string Directory;	// of the .gltf, the uris are relative to it
+	W::JsonValue Json;
+
+	std::vector<std::unique_ptr<W::MappedFile>> Files;
+	std::vector<std::vector<uint8_t>> DecodedBuffers;	// data: uris
+	std::vector<ArrayView<uint8_t>> Buffers;
+};
+
+// Typed, strided view of an accessor, Stride is the bufferView byteStride or the element size when tightly packed
+struct GltfAccessor
+{
+	const uint8_t* Data = nullptr;
+	size_t Count = 0;
+	size_t Stride = 0;
+	int ComponentType = 0;
+	int ComponentCount = 0;
+	bool Normalized = false;
+};
+
+//////////////////////////////////////////////////////////////////////////
+//                         Scene glTF - Buffers                         //
+//////////////////////////////////////////////////////////////////////////
+static int HexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Relative uri to a file path, "My%20Texture.png" is "My Texture.png" on disk
+static std::string GetUriPath(const GltfDocument& document, const char* uri)
+{
+	std::string filePath = document.Directory;
+	for (const char* c = uri; *c != '\0'; ++c)
+	{
+		if (c[0] == '%' && HexValue(c[1]) >= 0 && HexValue(c[2]) >= 0)
+		{
+			filePath.push_back(static_cast<char>(HexValue(c[1]) * 16 + HexValue(c[2])));
+			c += 2;
+		}
+		else
+		{
+			filePath.push_back(*c);
+		}
+	}
+	return filePath;
+}
+
+static bool IsDataUri(const char* uri)
+{
+	return strncmp(uri, "data:", 5) == 0;
+}
+
+static bool DecodeDataUri(const char* uri, std::vector<uint8_t>& data)
+{
+	const char* base64 = strstr(uri, ";base64,");
+	if (base64 == nullptr)
+		return false;
+
+	base64 += strlen(";base64,");
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (const char* c = base64; *c != '\0' && *c != '='; ++c)
+	{
+		int value;
+		if (*c >= 'A' && *c <= 'Z') value = *c - 'A';
+		else if (*c >= 'a' && *c <= 'z') value = *c - 'a' + 26;
+		else if (*c >= '0' && *c <= '9') value = *c - '0' + 52;
+		else if (*c == '+') value = 62;
+		else if (*c == '/') value = 63;
+		else return false;
+
+		bits = (bits << 6) | static_cast<uint32_t>(value);
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			data.push_back(static_cast<uint8_t>(bits >> bitCount));
+		}
+	}
+	return true;
+}
+
+static bool OpenDocument(const char* filePath, GltfDocument& document)
+{
+	std::unique_ptr<W::MappedFile> file = std::make_unique<W::MappedFile>();
+	if (file->Open(filePath) == false)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - failed to open %s\n", filePath);
+		return false;
+	}
+
+	const std::string path = filePath;
+	const size_t separator = path.find_last_of("/\\");
+	document.Directory = (separator != std::string::npos) ? path.substr(0, separator + 1) : std::string();
+
+	const char* jsonText = reinterpret_cast<const char*>(file->Data());
+	size_t jsonLength = file->Size();
+	ArrayView<uint8_t> binaryChunk;
+
+	GlbHeader header = {};
+	if (file->Size() >= sizeof(GlbHeader))
+	{
+		memcpy(&header, file->Data(), sizeof(GlbHeader));
+	}
+
+	if (header.Magic == GLB_MAGIC)
+	{
+		if (header.Version != GLB_VERSION || header.Length > file->Size())
+		{
+			W::Logger::PrintFormat("Scene::ImportGltf - unsupported or truncated glb %s\n", filePath);
+			return false;
+		}
+
+		// the JSON chunk comes first, then the optional binary chunk
+		jsonText = nullptr;
+		size_t offset = sizeof(GlbHeader);
+		while (offset + sizeof(GlbChunkHeader) <= header.Length)
+		{
+			GlbChunkHeader chunk;
+			memcpy(&chunk, file->Data() + offset, sizeof(GlbChunkHeader));
+			offset += sizeof(GlbChunkHeader);
+
+			if (chunk.Length > header.Length - offset)
+				break;
+
+			if (chunk.Type == GLB_CHUNK_JSON && jsonText == nullptr)
+			{
+				jsonText = reinterpret_cast<const char*>(file->Data() + offset);
+				jsonLength = chunk.Length;
+			}
+			else if (chunk.Type == GLB_CHUNK_BIN && binaryChunk.empty())
+			{
+				binaryChunk = ArrayView<uint8_t>(file->Data() + offset, chunk.Length);
+			}
+
+			offset += (chunk.Length + 3) & ~3u;
+		}
+
+		if (jsonText == nullptr)
+		{
+			W::Logger::PrintFormat("Scene::ImportGltf - no JSON chunk in %s\n", filePath);
+			return false;
+		}
+	}
+
+	size_t errorOffset = 0;
+	if (W::Json::Parse(jsonText, jsonLength, document.Json, &errorOffset) == false)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - invalid JSON in %s at byte %zu\n", filePath, errorOffset);
+		return false;
+	}
+
+	const W::JsonValue& buffers = document.Json["buffers"];
+	document.Buffers.resize(buffers.Size());
+	document.DecodedBuffers.resize(buffers.Size());
+	for (size_t bufferIndex = 0; bufferIndex < buffers.Size(); ++bufferIndex)
+	{
+		const W::JsonValue& buffer = buffers[bufferIndex];
+		const size_t byteLength = static_cast<size_t>(buffer["byteLength"].AsInt());
+
+		ArrayView<uint8_t> data;
+		if (buffer.HasMember("uri") == false)
+		{
+			// only the first buffer of a .glb may leave out the uri, it is the binary chunk
+			if (bufferIndex == 0)
+				data = binaryChunk;
+		}
+		else if (IsDataUri(buffer["uri"].AsString()))
+		{
+			std::vector<uint8_t>& decodedBuffer = document.DecodedBuffers[bufferIndex];
+			if (DecodeDataUri(buffer["uri"].AsString(), decodedBuffer))
+				data = ArrayView<uint8_t>(decodedBuffer);
+		}
+		else
+		{
+			const std::string bufferPath = GetUriPath(document, buffer["uri"].AsString());
+
+			std::unique_ptr<W::MappedFile> bufferFile = std::make_unique<W::MappedFile>();
+			if (bufferFile->Open(bufferPath.c_str()))
+			{
+				data = ArrayView<uint8_t>(bufferFile->Data(), bufferFile->Size());
+				document.Files.push_back(std::move(bufferFile));
+			}
+		}
+
+		if (data.size() < byteLength)
+		{
+			W::Logger::PrintFormat("Scene::ImportGltf - buffer %zu of %s is missing or shorter than %zu bytes\n", bufferIndex, filePath, byteLength);
+			return false;
+		}
+
+		document.Buffers[bufferIndex] = ArrayView<uint8_t>(data.data(), byteLength);
+	}
+
+	document.Files.push_back(std::move(file));
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                        Scene glTF - Accessors                        //
+//////////////////////////////////////////////////////////////////////////
+static int GetComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+	case GltfComponentType_Byte:
+	case GltfComponentType_UnsignedByte: return 1;
+	case GltfComponentType_Short:
+	case GltfComponentType_UnsignedShort: return 2;
+	case GltfComponentType_UnsignedInt:
+	case GltfComponentType_Float: return 4;
+	default: return 0;
+	}
+}
+
+static int GetComponentCount(const char* type)
+{
+	if (strcmp(type, "SCALAR") == 0) return 1;
+	if (strcmp(type, "VEC2") == 0) return 2;
+	if (strcmp(type, "VEC3") == 0) return 3;
+	if (strcmp(type, "VEC4") == 0) return 4;
+	return 0;
+}
+
+static bool GetAccessor(const GltfDocument& document, int64_t accessorIndex, GltfAccessor& result)
+{
+	if (accessorIndex < 0)
+		return false;
+
+	const W::JsonValue& accessor = document.Json["accessors"][static_cast<size_t>(accessorIndex)];
+	if (accessor.IsObject() == false)
+		return false;
+
+	if (accessor.HasMember("sparse"))
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - sparse accessor %lld is not supported\n", static_cast<long long>(accessorIndex));
+		return false;
+	}
+
+	const int64_t bufferViewIndex = accessor["bufferView"].AsInt(-1);
+	if (bufferViewIndex < 0)
+		return false;
+
+	const W::JsonValue& bufferView = document.Json["bufferViews"][static_cast<size_t>(bufferViewIndex)];
+	if (bufferView.IsObject() == false)
+		return false;
+
+	const int64_t bufferIndex = bufferView["buffer"].AsInt(-1);
+	if (bufferIndex < 0 || static_cast<size_t>(bufferIndex) >= document.Buffers.size())
+		return false;
+
+	// the sizes and offsets come straight from the file, negative ones are rejected before any arithmetic
+	const int64_t count = accessor["count"].AsInt(-1);
+	const int64_t accessorOffset = accessor["byteOffset"].AsInt(0);
+	const int64_t viewOffset = bufferView["byteOffset"].AsInt(0);
+	const int64_t viewLength = bufferView["byteLength"].AsInt(-1);
+	const int64_t byteStride = bufferView["byteStride"].AsInt(0);
+	if (count < 0 || accessorOffset < 0 || viewOffset < 0 || viewLength < 0 || byteStride < 0)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - accessor %lld has a negative size or offset\n", static_cast<long long>(accessorIndex));
+		return false;
+	}
+
+	result.ComponentType = static_cast<int>(accessor["componentType"].AsInt());
+	result.ComponentCount = GetComponentCount(accessor["type"].AsString());
+	result.Normalized = accessor["normalized"].AsBool();
+	result.Count = static_cast<size_t>(count);
+
+	const size_t elementSize = static_cast<size_t>(GetComponentSize(result.ComponentType)) * result.ComponentCount;
+	if (elementSize == 0)
+		return false;
+
+	result.Stride = (byteStride != 0) ? static_cast<size_t>(byteStride) : elementSize;
+	if (result.Stride < elementSize)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - accessor %lld has a stride of %zu for %zu byte elements\n", static_cast<long long>(accessorIndex), result.Stride, elementSize);
+		return false;
+	}
+
+	// the whole range has to be inside the view and the view inside the buffer, every test is written so it can not
+	// overflow: the last element starts (Count - 1) * Stride bytes after the first one and has to end in the view
+	const ArrayView<uint8_t>& buffer = document.Buffers[static_cast<size_t>(bufferIndex)];
+	const size_t viewStart = static_cast<size_t>(viewOffset);
+	const size_t viewSize = static_cast<size_t>(viewLength);
+	const size_t accessorStart = static_cast<size_t>(accessorOffset);
+
+	bool inBounds = (viewSize <= buffer.size()) && (viewStart <= buffer.size() - viewSize) && (accessorStart <= viewSize);
+	if (inBounds && result.Count > 0)
+	{
+		const size_t available = viewSize - accessorStart;
+		inBounds = (elementSize <= available) && (result.Count - 1 <= (available - elementSize) / result.Stride);
+	}
+
+	if (inBounds == false)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - accessor %lld is out of the bounds of its buffer\n", static_cast<long long>(accessorIndex));
+		return false;
+	}
+
+	result.Data = buffer.data() + viewStart + accessorStart;
+	return true;
+}
+
+// One loop per component type, the switch is outside of it. Integer components are converted to float,
+// normalized ones to [0, 1] or [-1, 1].
+template <typename T>
+static void ReadComponents(const GltfAccessor& accessor, int componentCount, float* output, size_t outputStride)
+{
+	const bool normalized = accessor.Normalized && std::numeric_limits<T>::is_integer;
+	const float scale = normalized ? 1.0f / static_cast<float>(std::numeric_limits<T>::max()) : 1.0f;
+
+	// the most negative snorm value is below -1, it maps to -1 as well
+	const float minimum = (normalized && std::numeric_limits<T>::is_signed) ? -1.0f : std::numeric_limits<float>::lowest();
+
+	const uint8_t* element = accessor.Data;
+	uint8_t* destination = reinterpret_cast<uint8_t*>(output);
+	for (size_t elementIndex = 0; elementIndex < accessor.Count; ++elementIndex)
+	{
+		T components[4];
+		memcpy(components, element, sizeof(T) * componentCount);
+
+		float* values = reinterpret_cast<float*>(destination);
+		for (int c = 0; c < componentCount; ++c)
+		{
+			values[c] = std::max(static_cast<float>(components[c]) * scale, minimum);
+		}
+
+		element += accessor.Stride;
+		destination += outputStride;
+	}
+}
+
+// Reads up to componentCount components of every element into output, which advances by outputStride bytes per element
+static void ReadAccessor(const GltfAccessor& accessor, int componentCount, float* output, size_t outputStride)
+{
+	componentCount = std::min(componentCount, accessor.ComponentCount);
+
+	switch (accessor.ComponentType)
+	{
+	case GltfComponentType_Byte: ReadComponents<int8_t>(accessor, componentCount, output, outputStride); break;
+	case GltfComponentType_UnsignedByte: ReadComponents<uint8_t>(accessor, componentCount, output, outputStride); break;
+	case GltfComponentType_Short: ReadComponents<int16_t>(accessor, componentCount, output, outputStride); break;
+	case GltfComponentType_UnsignedShort: ReadComponents<uint16_t>(accessor, componentCount, output, outputStride); break;
+	case GltfComponentType_UnsignedInt: ReadComponents<uint32_t>(accessor, componentCount, output, outputStride); break;
+	case GltfComponentType_Float: ReadComponents<float>(accessor, componentCount, output, outputStride); break;
+	default: Debug_AssertMsg(false, "invalid accessor component type %d", accessor.ComponentType); break;
+	}
+}
+
+template <typename T>
+static void ReadIndexComponents(const GltfAccessor& accessor, uint32_t baseVertex, uint32_t* output)
+{
+	const uint8_t* element = accessor.Data;
+	for (size_t elementIndex = 0; elementIndex < accessor.Count; ++elementIndex)
+	{
+		T index;
+		memcpy(&index, element, sizeof(T));
+		output[elementIndex] = baseVertex + static_cast<uint32_t>(index);
+
+		element += accessor.Stride;
+	}
+}
+
+static bool ReadIndices(const GltfAccessor& accessor, uint32_t baseVertex, uint32_t* output)
+{
+	switch (accessor.ComponentType)
+	{
+	case GltfComponentType_UnsignedByte: ReadIndexComponents<uint8_t>(accessor, baseVertex, output); return true;
+	case GltfComponentType_UnsignedShort: ReadIndexComponents<uint16_t>(accessor, baseVertex, output); return true;
+	case GltfComponentType_UnsignedInt: ReadIndexComponents<uint32_t>(accessor, baseVertex, output); return true;
+	default: return false;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                         Scene glTF - Meshes                          //
+//////////////////////////////////////////////////////////////////////////
+// Area weighted vertex normals for primitives that come without them
+static void GenerateNormals(Model& model, size_t firstVertex, size_t firstIndex)
+{
+	for (size_t i = firstIndex; i + 2 < model.Indices.size(); i += 3)
+	{
+		Vertex& a = model.Vertices[model.Indices[i + 0]];
+		Vertex& b = model.Vertices[model.Indices[i + 1]];
+		Vertex& c = model.Vertices[model.Indices[i + 2]];
+
+		const glm::vec3 faceNormal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+		a.Normal += faceNormal;
+		b.Normal += faceNormal;
+		c.Normal += faceNormal;
+	}
+
+	for (size_t vertexIndex = firstVertex; vertexIndex < model.Vertices.size(); ++vertexIndex)
+	{
+		Vertex& vertex = model.Vertices[vertexIndex];
+		const float length = glm::length(vertex.Normal);
+		vertex.Normal = (length > 0.0f) ? vertex.Normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+}
+
+// Appends the primitive to the model as one Mesh range, the attributes are read straight into Model::Vertices
+static bool ConvertPrimitive(const GltfDocument& document, const W::JsonValue& primitive, int materialIndex, Model& model)
+{
+	if (primitive["mode"].AsInt(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - %s: skipped a primitive that is not a triangle list\n", model.Name.c_str());
+		return false;
+	}
+
+	const W::JsonValue& attributes = primitive["attributes"];
+
+	GltfAccessor positions;
+	if (GetAccessor(document, attributes["POSITION"].AsInt(-1), positions) == false || positions.ComponentCount != 3 || positions.Count == 0)
+	{
+		W::Logger::PrintFormat("Scene::ImportGltf - %s: skipped a primitive without positions\n", model.Name.c_str());
+		return false;
+	}
+
+	const size_t firstVertex = model.Vertices.size();
+	const size_t firstIndex = model.Indices.size();
+	const uint32_t baseVertex = static_cast<uint32_t>(firstVertex);
+
+	// indices first, a primitive with an invalid index buffer is dropped before anything is appended
+	GltfAccessor indices;
+	if (primitive.HasMember("indices"))
+	{
+		if (GetAccessor(document, primitive["indices"].AsInt(-1), indices) == false || indices.ComponentCount != 1)
+		{
+			W::Logger::PrintFormat("Scene::ImportGltf - %s: skipped a primitive with invalid indices\n", model.Name.c_str());
+			return false;
+		}
+
+		model.Indices.resize(firstIndex + indices.Count - indices.Count % 3);
+		indices.Count = model.Indices.size() - firstIndex;
+		if (ReadIndices(indices, baseVertex, model.Indices.data() + firstIndex) == false)
+		{
+			model.Indices.resize(firstIndex);
+			return false;
+		}
+
+		for (size_t i = firstIndex; i < model.Indices.size(); ++i)
+		{
+			if (model.Indices[i] - baseVertex >= positions.Count)
+			{
+				W::Logger::PrintFormat("Scene::ImportGltf - %s: skipped a primitive with an index out of range\n", model.Name.c_str());
+				model.Indices.resize(firstIndex);
+				return false;
+			}
+		}
+	}
+	else
+	{
+		// not indexed, every three vertices are a triangle
+		model.Indices.resize(firstIndex + positions.Count - positions.Count % 3);
+		for (size_t i = firstIndex; i < model.Indices.size(); ++i)
+		{
+			model.Indices[i] = baseVertex + static_cast<uint32_t>(i - firstIndex);
+		}
+	}
+
+	Vertex defaultVertex = {};
+	defaultVertex.Color = glm::vec3(1.0f, 1.0f, 1.0f);
+	model.Vertices.resize(firstVertex + positions.Count, defaultVertex);
+
+	Vertex* vertices = model.Vertices.data() + firstVertex;
+	ReadAccessor(positions, 3, &vertices->Position.x, sizeof(Vertex));
+
+	// the optional attributes have to match the vertex count, a mismatching one is ignored
+	GltfAccessor normals;
+	const bool hasNormals = GetAccessor(document, attributes["NORMAL"].AsInt(-1), normals) && normals.Count == positions.Count;
+	if (hasNormals)
+	{
+		ReadAccessor(normals, 3, &vertices->Normal.x, sizeof(Vertex));
+	}
+
+	// glTF UVs have their origin top left like Vulkan, unlike the FBX ones they are not flipped
+	GltfAccessor uvs;
+	if (GetAccessor(document, attributes["TEXCOORD_0"].AsInt(-1), uvs) && uvs.Count == positions.Count)
+	{
+		ReadAccessor(uvs, 2, &vertices->UV.x, sizeof(Vertex));
+	}
+
+	// RGB or RGBA, the alpha is dropped
+	GltfAccessor colors;
+	if (GetAccessor(document, attributes["COLOR_0"].AsInt(-1), colors) && colors.Count == positions.Count)
+	{
+		ReadAccessor(colors, 3, &vertices->Color.x, sizeof(Vertex));
+		model.HasVertexColor = true;
+	}
+
+	if (hasNormals == false)
+	{
+		GenerateNormals(model, firstVertex, firstIndex);
+	}
+
+	Mesh mesh;
+	mesh.IndexOffset = static_cast<int>(firstIndex);
+	mesh.TriangleCount = static_cast<int>((model.Indices.size() - firstIndex) / 3);
+	mesh.MaterialIndex = materialIndex;
+	model.Meshs.push_back(mesh);
+
+	return true;
+}
+
+// One Model per mesh instance, the primitives of the mesh are its Mesh ranges
+static void ConvertMesh(const GltfDocument& document, const W::JsonValue& mesh, int defaultMaterialIndex, Model* model)
+{
+	const W::JsonValue& primitives = mesh["primitives"];
+	const size_t materialCount = document.Json["materials"].Size();
+
+	for (size_t primitiveIndex = 0; primitiveIndex < primitives.Size(); ++primitiveIndex)
+	{
+		const W::JsonValue& primitive = primitives[primitiveIndex];
+
+		const int64_t materialIndex = primitive["material"].AsInt(-1);
+		const bool hasMaterial = (materialIndex >= 0 && static_cast<size_t>(materialIndex) < materialCount);
+
+		ConvertPrimitive(document, primitive, hasMaterial ? static_cast<int>(materialIndex) : defaultMaterialIndex, *model);
+	}
+
+	if (model->Indices.empty())
+		return;
+
+	model->FinishImport();
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                         Scene glTF - Scene                           //
+//////////////////////////////////////////////////////////////////////////
+// Every image referenced by a material is one Texture, cooked from the file next to the .gltf
+static void BuildMaterials(Scene& scene, const GltfDocument& document)
+{
+	const W::JsonValue& images = document.Json["images"];
+	const W::JsonValue& textures = document.Json["textures"];
+	const W::JsonValue& materials = document.Json["materials"];
+
+	std::vector<Texture*> imageTextures(images.Size(), nullptr);
+	size_t referenceCount = 0;
+	size_t untexturedCount = 0;
+
+	for (size_t materialIndex = 0; materialIndex < materials.Size(); ++materialIndex)
+	{
+		const W::JsonValue& gltfMaterial = materials[materialIndex];
+
+		std::unique_ptr<Material> material = std::make_unique<Material>();
+		material->Name = gltfMaterial["name"].AsString();
+
+		const W::JsonValue& baseColorTexture = gltfMaterial["pbrMetallicRoughness"]["baseColorTexture"];
+		const size_t imageIndex = static_cast<size_t>(textures[static_cast<size_t>(baseColorTexture["index"].AsInt(-1))]["source"].AsInt(-1));
+		if (imageIndex < images.Size())
+		{
+			++referenceCount;
+
+			const char* uri = images[imageIndex]["uri"].AsString(nullptr);
+			if (uri == nullptr || IsDataUri(uri))
+			{
+				// the texture cook reads image files, embedded images would have to be written out first
+				W::Logger::PrintFormat("Scene::ImportGltf - %s: embedded images are not supported\n", material->Name.c_str());
+			}
+			else
+			{
+				if (imageTextures[imageIndex] == nullptr)
+				{
+					std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+					texture->FilePath = GetUriPath(document, uri);
+					imageTextures[imageIndex] = texture.get();
+					scene.Textures.push_back(std::move(texture));
+				}
+
+				material->DiffuseTexture = imageTextures[imageIndex];
+			}
+		}
+		else
+		{
+			++untexturedCount;
+		}
+
+		scene.Materials.push_back(std::move(material));
+	}
+
+	// materials without a base color texture (baseColorFactor only) are kept, the renderer draws them with its placeholder
+	// since a Material has no color of its own yet
+	W::Logger::PrintFormat("Scene::ImportGltf - %zu textures for %zu material references, %zu untextured materials\n", scene.Textures.size(), referenceCount, untexturedCount);
+}
+
+static glm::vec3 GetVec3(const W::JsonValue& value, const glm::vec3& defaultValue)
+{
+	if (value.Size() != 3)
+		return defaultValue;
+
+	return glm::vec3(value[0].AsFloat(), value[1].AsFloat(), value[2].AsFloat());
+}
+
+static glm::mat4 GetLocalTransform(const W::JsonValue& node)
+{
+	const W::JsonValue& matrix = node["matrix"];
+	if (matrix.Size() == 16)
+	{
+		// column major like glm
+		glm::mat4 transform;
+		for (int i = 0; i < 16; ++i)
+		{
+			transform[i / 4][i % 4] = matrix[i].AsFloat();
+		}
+		return transform;
+	}
+
+	const glm::vec3 translation = GetVec3(node["translation"], glm::vec3(0.0f));
+	const glm::vec3 scale = GetVec3(node["scale"], glm::vec3(1.0f));
+
+	glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+	const W::JsonValue& gltfRotation = node["rotation"];
+	if (gltfRotation.Size() == 4)
+	{
+		// glTF stores x, y, z, w
+		rotation = glm::quat(gltfRotation[3].AsFloat(), gltfRotation[0].AsFloat(), gltfRotation[1].AsFloat(), gltfRotation[2].AsFloat());
+	}
+
+	glm::mat4 transform = glm::mat4_cast(rotation);
+	transform[0] *= scale.x;
+	transform[1] *= scale.y;
+	transform[2] *= scale.z;
+	transform[3] = glm::vec4(translation, 1.0f);
+	return transform;
+}
+
+static void BuildCamera(Scene& scene, const GltfDocument& document, const W::JsonValue& node, int32_t transformIndex)
+{
+	const W::JsonValue& gltfCamera = document.Json["cameras"][static_cast<size_t>(node["camera"].AsInt(-1))];
+	if (gltfCamera.IsObject() == false)
+		return;
+
+	std::unique_ptr<Camera> camera = std::make_unique<Camera>();
+	camera->Name = node["name"].AsString(gltfCamera["name"].AsString());
+
+	// glTF cameras look down -Z, the renderer looks down the X axis of the camera transform like the FBX ones
+	const glm::mat4 lookDownX(
+		glm::vec4(0.0f, 0.0f, -1.0f, 0.0f),
+		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	camera->TransformIndex = scene.Transforms.AddNode(transformIndex, lookDownX);
+
+	// vertical field of view in radians, orthographic cameras get the default
+	camera->FieldOfView = glm::degrees(gltfCamera["perspective"]["yfov"].AsFloat(glm::radians(45.0f)));
+
+	scene.Cameras.push_back(std::move(camera));
+}
+
+// KHR_lights_punctual
+static void BuildLight(Scene& scene, const GltfDocument& document, const W::JsonValue& node, int32_t transformIndex)
+{
+	const size_t lightIndex = static_cast<size_t>(node["extensions"]["KHR_lights_punctual"]["light"].AsInt(-1));
+	const W::JsonValue& gltfLight = document.Json["extensions"]["KHR_lights_punctual"]["lights"][lightIndex];
+	if (gltfLight.IsObject() == false)
+		return;
+
+	const char* type = gltfLight["type"].AsString();
+
+	LightType lightType = LightType::Unknown;
+	if (strcmp(type, "directional") == 0) { lightType = LightType::Directional; }
+	else if (strcmp(type, "point") == 0) { lightType = LightType::Point; }
+	else if (strcmp(type, "spot") == 0) { lightType = LightType::Spot; }
+
+	if (lightType == LightType::Unknown)
+		return;
+
+	std::unique_ptr<Light> light = std::make_unique<Light>();
+	light->Name = node["name"].AsString(gltfLight["name"].AsString());
+	light->TransformIndex = transformIndex;
+	light->LightType = lightType;
+	light->Color = GetVec3(gltfLight["color"], glm::vec3(1.0f));
+
+	// glTF cone angles are from the axis to the edge in radians, the Light ones are the full cone in degrees
+	const W::JsonValue& spot = gltfLight["spot"];
+	light->InnerAngle = glm::degrees(2.0f * spot["innerConeAngle"].AsFloat(0.0f));
+	light->OuterAngle = glm::degrees(2.0f * spot["outerConeAngle"].AsFloat(glm::quarter_pi<float>()));
+
+	// Note: glTF lights are photometric, candela for point and spot lights and lux for sun lights.
+	// The Light intensity is the Blender Watts the FBX lights end up with, so use the inverse of the
+	// conversion the Blender exporter applies - 683 lm/W over the whole sphere. Sun lights are exported as is.
+	const float intensity = gltfLight["intensity"].AsFloat(1.0f);
+	light->Intensity = (lightType == LightType::Directional) ? intensity : intensity * 4.0f * glm::pi<float>() / 683.0f;
+
+	scene.Lights.push_back(std::move(light));
+}
+
+// Mesh instances found while walking the nodes, converted on the thread pool afterwards
+struct GltfMeshTask
+{
+	size_t MeshIndex = 0;
+	std::unique_ptr<Model> Result;
+};
+
+static void BuildNodes(Scene& scene, const GltfDocument& document, size_t nodeIndex, int32_t parentTransformIndex, std::vector<uint8_t>& visited, std::vector<GltfMeshTask>& meshTasks)
+{
+	const W::JsonValue& node = document.Json["nodes"][nodeIndex];
+	if (node.IsObject() == false || visited[nodeIndex] != 0)
+		return;
+
+	visited[nodeIndex] = 1;
+
+	// depth first, so the transform of a node is always added after the one of its parent
+	const int32_t transformIndex = scene.Transforms.AddNode(parentTransformIndex, GetLocalTransform(node));
+
+	const size_t meshIndex = static_cast<size_t>(node["mesh"].AsInt(-1));
+	if (meshIndex < document.Json["meshes"].Size())
+	{
+		GltfMeshTask task;
+		task.MeshIndex = meshIndex;
+		task.Result = std::make_unique<Model>();
+		task.Result->Name = node["name"].AsString(document.Json["meshes"][meshIndex]["name"].AsString());
+		task.Result->TransformIndex = transformIndex;
+		meshTasks.push_back(std::move(task));
+	}
+
+	if (node.HasMember("camera"))
+	{
+		BuildCamera(scene, document, node, transformIndex);
+	}
+
+	if (node["extensions"].HasMember("KHR_lights_punctual"))
+	{
+		BuildLight(scene, document, node, transformIndex);
+	}
+
+	const W::JsonValue& children = node["children"];
+	for (size_t childIndex = 0; childIndex < children.Size(); ++childIndex)
+	{
+		const size_t child = static_cast<size_t>(children[childIndex].AsInt(-1));
+		if (child < visited.size())
+		{
+			BuildNodes(scene, document, child, transformIndex, visited, meshTasks);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Scene - glTF                              //
+//////////////////////////////////////////////////////////////////////////
+std::unique_ptr<Scene> Scene::ImportGltf(const char* filePath, W::ThreadPool& threadPool)
+{
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+
+	std::unique_ptr<Scene> scene = std::make_unique<Scene>();
+
+	GltfDocument document;
+	// OpenDocument logs why
+	if (OpenDocument(filePath, document) == false)
+		return nullptr;
+
+	BuildMaterials(*scene, document);
+	Texture::CookAsync(scene->Textures, threadPool);
+
+	// primitives without a material share one, it has no texture and is drawn with the placeholder like any other
+	// untextured material, see Renderer::UpdateMaterialDescriptorSet
+	const int defaultMaterialIndex = static_cast<int>(scene->Materials.size());
+	scene->Materials.push_back(std::make_unique<Material>());
+	scene->Materials.back()->Name = "Default";
+
+	// glTF is Y up, the scenes are Z up (the FBX import converts to Maya Z up), both are in meters
+	const glm::mat4 yUpToZUp(
+		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(0.0f, -1.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	const int32_t rootTransformIndex = scene->Transforms.AddNode(TransformHierarchy::INVALID_NODE, yUpToZUp);
+
+	const W::JsonValue& nodes = document.Json["nodes"];
+	std::vector<uint8_t> visited(nodes.Size(), 0);
+	std::vector<GltfMeshTask> meshTasks;
+
+	const W::JsonValue& gltfScene = document.Json["scenes"][static_cast<size_t>(document.Json["scene"].AsInt(0))];
+	if (gltfScene.IsObject())
+	{
+		const W::JsonValue& rootNodes = gltfScene["nodes"];
+		for (size_t i = 0; i < rootNodes.Size(); ++i)
+		{
+			const size_t nodeIndex = static_cast<size_t>(rootNodes[i].AsInt(-1));
+			if (nodeIndex < nodes.Size())
+			{
+				BuildNodes(*scene, document, nodeIndex, rootTransformIndex, visited, meshTasks);
+			}
+		}
+	}
+	else
+	{
+		// no scene, every node that is nobody's child is a root
+		std::vector<uint8_t> isChild(nodes.Size(), 0);
+		for (size_t nodeIndex = 0; nodeIndex < nodes.Size(); ++nodeIndex)
+		{
+			const W::JsonValue& children = nodes[nodeIndex]["children"];
+			for (size_t childIndex = 0; childIndex < children.Size(); ++childIndex)
+			{
+				const size_t child = static_cast<size_t>(children[childIndex].AsInt(-1));
+				if (child < nodes.Size())
+					isChild[child] = 1;
+			}
+		}
+
+		for (size_t nodeIndex = 0; nodeIndex < nodes.Size(); ++nodeIndex)
+		{
+			if (isChild[nodeIndex] == 0)
+			{
+				BuildNodes(*scene, document, nodeIndex, rootTransformIndex, visited, meshTasks);
+			}
+		}
+	}
+
+	// Convert the meshes in parallel, the models are appended in node order so the result does not depend on scheduling
+	const ChronoClock::time_point convertStartTime = ChronoClock::now();
+
+	threadPool.ParallelFor(meshTasks.size(), [&meshTasks, &document, defaultMaterialIndex](size_t taskIndex)
+	{
+		const W::JsonValue& mesh = document.Json["meshes"][meshTasks[taskIndex].MeshIndex];
+		ConvertMesh(document, mesh, defaultMaterialIndex, meshTasks[taskIndex].Result.get());
+	});
+
+	for (GltfMeshTask& task : meshTasks)
+	{
+		// meshes whose primitives were all skipped
+		if (task.Result->Indices.empty())
+			continue;
+
+		scene->Models.push_back(std::move(task.Result));
+	}
+
+	scene->UpdateTransforms();
+
+	const ChronoClock::time_point endTime = ChronoClock::now();
+	const float convertTime = std::chrono::duration<float, std::milli>(endTime - convertStartTime).count();
+	const float importTime = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+	W::Logger::PrintFormat("Scene::ImportGltf - converted %zu meshes on %u threads %.2f ms, %s %.2f ms\n", meshTasks.size(), threadPool.GetThreadCount() + 1, convertTime, filePath, importTime);
+
+	return scene;
+}
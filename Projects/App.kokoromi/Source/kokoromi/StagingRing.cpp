@@ -0,0 +1,335 @@
+#include "StagingRing.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Graphics/Backend/Vk.Graphics.hpp>
+
+#include <limits>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+StagingRing::StagingRing()
+{
+}
+
+StagingRing::~StagingRing()
+{
+	Debug_Assert(mDevice == VK_NULL_HANDLE);
+}
+
+void StagingRing::Startup(VkDevice device, uint32_t queueFamily, VkQueue queue, bool dedicatedQueue, DeviceMemoryAllocator& deviceMemory, VkDeviceSize size)
+{
+	mDevice = device;
+	mQueue = queue;
+	mQueueFamily = queueFamily;
+	mDedicatedQueue = dedicatedQueue;
+	mDeviceMemory = &deviceMemory;
+	mSize = size;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	VK_CHECK(vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCommandPool));
+
+	if (mDedicatedQueue)
+	{
+		VkSemaphoreTypeCreateInfo typeInfo = {};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		VK_CHECK(vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mTimelineSemaphore));
+	}
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VK_CHECK(vkCreateBuffer(mDevice, &bufferInfo, nullptr, &mBuffer));
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(mDevice, mBuffer, &memRequirements);
+
+	mMemory = mDeviceMemory->Allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DeviceResourceType::Linear);
+	VK_CHECK(vkBindBufferMemory(mDevice, mBuffer, mMemory.Memory, mMemory.Offset));
+
+	for (Batch& batch : mBatches)
+	{
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = mCommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		VK_CHECK(vkAllocateCommandBuffers(mDevice, &allocInfo, &batch.CommandBuffer));
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VK_CHECK(vkCreateFence(mDevice, &fenceInfo, nullptr, &batch.Fence));
+	}
+}
+
+void StagingRing::Shutdown()
+{
+	Flush();
+	WaitIdle();
+
+	// the command buffers go with their pool
+	for (Batch& batch : mBatches)
+	{
+		vkDestroyFence(mDevice, batch.Fence, nullptr);
+		batch = Batch();
+	}
+	vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+	vkDestroySemaphore(mDevice, mTimelineSemaphore, nullptr);
+
+	mCommandPool = VK_NULL_HANDLE;
+	mTimelineSemaphore = VK_NULL_HANDLE;
+
+	vkDestroyBuffer(mDevice, mBuffer, nullptr);
+	mDeviceMemory->Free(mMemory);
+
+	mBuffer = VK_NULL_HANDLE;
+	mDeviceMemory = nullptr;
+	mDevice = VK_NULL_HANDLE;
+}
+
+StagingRegion StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	Update();
+
+	// batches of a part of the ring each, the first ones are copied while the next are filled
+	Batch& recordingBatch = GetRecordingBatch();
+	if (recordingBatch.Bytes > 0 && recordingBatch.Bytes + size > mSize / MAX_BATCHES)
+	{
+		Flush();
+	}
+
+	mBytesStaged += size;
+
+	StagingRegion region;
+	VkDeviceSize offset;
+	while (TryAllocate(size, alignment, offset) == false)
+	{
+		if (mCompletedBatches == mSubmittedBatches && GetRecordingBatch().Bytes == 0)
+		{
+			// larger than the whole ring, staged through a buffer of its own
+			OversizeBuffer oversize;
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = size;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			VK_CHECK(vkCreateBuffer(mDevice, &bufferInfo, nullptr, &oversize.Buffer));
+
+			VkMemoryRequirements memRequirements;
+			vkGetBufferMemoryRequirements(mDevice, oversize.Buffer, &memRequirements);
+
+			oversize.Memory = mDeviceMemory->Allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DeviceResourceType::Linear);
+			VK_CHECK(vkBindBufferMemory(mDevice, oversize.Buffer, oversize.Memory.Memory, oversize.Memory.Offset));
+
+			region.Buffer = oversize.Buffer;
+			region.Offset = 0;
+			region.MappedData = oversize.Memory.MappedData;
+
+			GetRecordingBatch().OversizeBuffers.push_back(oversize);
+			return region;
+		}
+
+		if (GetRecordingBatch().Bytes > 0)
+		{
+			Flush();
+		}
+		else
+		{
+			++mStalls;
+			WaitForOldestBatch();
+		}
+	}
+
+	region.Buffer = mBuffer;
+	region.Offset = offset;
+	region.MappedData = static_cast<uint8_t*>(mMemory.MappedData) + offset;
+	return region;
+}
+
+VkCommandBuffer StagingRing::GetCommandBuffer()
+{
+	return GetRecordingBatch().CommandBuffer;
+}
+
+void StagingRing::Flush()
+{
+	Batch& batch = mBatches[mSubmittedBatches % MAX_BATCHES];
+	if (batch.Recording == false)
+		return;
+
+	// buffers read by the draws, the images are transitioned by the upload itself. On the transfer queue the
+	// resources are released to the graphics queue by the recorder instead.
+	if (mDedicatedQueue == false)
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	VK_CHECK(vkEndCommandBuffer(batch.CommandBuffer));
+
+	const uint64_t uploadValue = GetUploadValue();
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &uploadValue;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.CommandBuffer;
+	if (mDedicatedQueue)
+	{
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &mTimelineSemaphore;
+	}
+	VK_CHECK(vkQueueSubmit(mQueue, 1, &submitInfo, batch.Fence));
+
+	batch.Recording = false;
+	batch.End = mHead;
+	++mSubmittedBatches;
+}
+
+void StagingRing::Update()
+{
+	while (mCompletedBatches < mSubmittedBatches && vkGetFenceStatus(mDevice, mBatches[mCompletedBatches % MAX_BATCHES].Fence) == VK_SUCCESS)
+	{
+		CompleteOldestBatch();
+	}
+}
+
+bool StagingRing::IsUploadComplete(uint64_t uploadValue) const
+{
+	if (mDedicatedQueue == false)
+		return uploadValue <= mSubmittedBatches;
+
+	uint64_t completedValue = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mTimelineSemaphore, &completedValue));
+	return uploadValue <= completedValue;
+}
+
+void StagingRing::WaitIdle()
+{
+	while (mCompletedBatches < mSubmittedBatches)
+	{
+		WaitForOldestBatch();
+	}
+}
+
+StagingRing::Statistics StagingRing::GetStatistics() const
+{
+	Statistics statistics;
+	statistics.Size = mSize;
+	statistics.UsedSize = mUsedSize;
+	statistics.BytesStaged = mBytesStaged;
+	statistics.BatchesSubmitted = static_cast<uint32_t>(mSubmittedBatches);
+	statistics.BatchesInFlight = static_cast<uint32_t>(mSubmittedBatches - mCompletedBatches);
+	statistics.Stalls = mStalls;
+	statistics.DedicatedQueue = mDedicatedQueue;
+	return statistics;
+}
+
+StagingRing::Batch& StagingRing::GetRecordingBatch()
+{
+	// every batch is in flight, the slot of the oldest is the next to record
+	if (mSubmittedBatches - mCompletedBatches == MAX_BATCHES)
+	{
+		++mStalls;
+		WaitForOldestBatch();
+	}
+
+	Batch& batch = mBatches[mSubmittedBatches % MAX_BATCHES];
+	if (batch.Recording == false)
+	{
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK(vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo));
+
+		batch.Recording = true;
+		batch.Bytes = 0;
+	}
+	return batch;
+}
+
+// The free space is [head, size) and [0, tail) when the head is ahead of the tail, [head, tail) once it wrapped
+bool StagingRing::TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	// may wait for a batch, which moves the tail
+	Batch& batch = GetRecordingBatch();
+
+	if (mUsedSize == 0)
+	{
+		mHead = 0;
+		mTail = 0;
+	}
+
+	VkDeviceSize start = AlignUp(mHead, alignment);
+	if (mHead > mTail || mUsedSize == 0)
+	{
+		if (start + size > mSize)
+		{
+			// the end of the ring is too short, skipped
+			if (size > mTail)
+				return false;
+			start = 0;
+		}
+	}
+	else if (start + size > mTail)
+	{
+		return false;
+	}
+
+	const VkDeviceSize consumed = (start >= mHead) ? start + size - mHead : mSize - mHead + size;
+
+	batch.Bytes += consumed;
+	mUsedSize += consumed;
+	mHead = start + size;
+
+	offset = start;
+	return true;
+}
+
+void StagingRing::WaitForOldestBatch()
+{
+	Debug_Assert(mCompletedBatches < mSubmittedBatches);
+
+	VK_CHECK(vkWaitForFences(mDevice, 1, &mBatches[mCompletedBatches % MAX_BATCHES].Fence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
+	CompleteOldestBatch();
+}
+
+void StagingRing::CompleteOldestBatch()
+{
+	Batch& batch = mBatches[mCompletedBatches % MAX_BATCHES];
+	VK_CHECK(vkResetFences(mDevice, 1, &batch.Fence));
+
+	for (OversizeBuffer& oversize : batch.OversizeBuffers)
+	{
+		vkDestroyBuffer(mDevice, oversize.Buffer, nullptr);
+		mDeviceMemory->Free(oversize.Memory);
+	}
+	batch.OversizeBuffers.clear();
+
+	mUsedSize -= batch.Bytes;
+	mTail = batch.End;
+	batch.Bytes = 0;
+	++mCompletedBatches;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DeviceMemory.h"
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Space in the staging ring the CPU writes the upload to, the copy out of Buffer is recorded into the batch command buffer
+struct StagingRegion
+{
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	void* MappedData = nullptr;
+};
+
+// One persistently mapped host visible buffer the uploads are staged through. The copies are recorded into a shared
+// command buffer and submitted in batches, each batch gives its part of the ring back once its fence signals, so
+// creating N resources costs a few submits and no vkQueueWaitIdle. Uploads larger than the ring get a buffer of
+// their own that goes with the batch.
+//
+// The batches go to a dedicated transfer queue when the device has one, each signals its upload value on a timeline
+// semaphore and the resources it copied have to be released to the graphics queue family by the recorder and
+// acquired by a frame waiting on that value. Otherwise they go to the graphics queue ahead of the frames and the
+// copies are visible to any frame submitted after them.
+class StagingRing
+{
+public:
+	struct Statistics
+	{
+		VkDeviceSize Size = 0;
+		VkDeviceSize UsedSize = 0;
+		uint64_t BytesStaged = 0;
+		uint32_t BatchesSubmitted = 0;
+		uint32_t BatchesInFlight = 0;
+		uint32_t Stalls = 0;		// waits on a batch fence because the ring was full
+		bool DedicatedQueue = false;
+	};
+
+private:
+	static const uint32_t MAX_BATCHES = 4;
+
+	struct OversizeBuffer
+	{
+		VkBuffer Buffer;
+		DeviceAllocation Memory;
+	};
+
+	struct Batch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		VkDeviceSize End = 0;			// head of the ring after the last region of the batch
+		VkDeviceSize Bytes = 0;			// of the ring, alignment and wrap padding included
+		bool Recording = false;
+		std::vector<OversizeBuffer> OversizeBuffers;
+	};
+
+	VkDevice mDevice = VK_NULL_HANDLE;
+	VkQueue mQueue = VK_NULL_HANDLE;
+	uint32_t mQueueFamily = 0;
+	bool mDedicatedQueue = false;
+	VkCommandPool mCommandPool = VK_NULL_HANDLE;
+	VkSemaphore mTimelineSemaphore = VK_NULL_HANDLE;	// dedicated queue only, batch n signals n + 1
+	DeviceMemoryAllocator* mDeviceMemory = nullptr;
+
+	VkBuffer mBuffer = VK_NULL_HANDLE;
+	DeviceAllocation mMemory;
+	VkDeviceSize mSize = 0;
+	VkDeviceSize mHead = 0;
+	VkDeviceSize mTail = 0;
+	VkDeviceSize mUsedSize = 0;
+
+	// batch n is mBatches[n % MAX_BATCHES], [mCompletedBatches, mSubmittedBatches) are in flight and mSubmittedBatches records
+	Batch mBatches[MAX_BATCHES];
+	uint64_t mSubmittedBatches = 0;
+	uint64_t mCompletedBatches = 0;
+
+	uint64_t mBytesStaged = 0;
+	uint32_t mStalls = 0;
+
+public:
+	StagingRing();
+	~StagingRing();
+
+	// dedicatedQueue when queue is not the graphics queue, timeline semaphores have to be enabled on the device then
+	void Startup(VkDevice device, uint32_t queueFamily, VkQueue queue, bool dedicatedQueue, DeviceMemoryAllocator& deviceMemory, VkDeviceSize size);
+	void Shutdown();
+
+	// size bytes at an offset aligned to alignment. May submit the batch being recorded and wait for the oldest to make room.
+	StagingRegion Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+	// The command buffer of the batch being recorded, the copies out of the regions allocated since the last Flush go there
+	VkCommandBuffer GetCommandBuffer();
+
+	// Submits the batch being recorded. The copies are visible to every command submitted to the queue after it.
+	void Flush();
+
+	// Value of the batch being recorded, the copies recorded so far are done once IsUploadComplete of it
+	uint64_t GetUploadValue() const { return mSubmittedBatches + 1; }
+
+	// On the graphics queue a submitted batch is complete for every later submit, on the transfer queue once it signalled
+	bool IsUploadComplete(uint64_t uploadValue) const;
+
+	bool IsDedicatedQueue() const { return mDedicatedQueue; }
+	uint32_t GetQueueFamily() const { return mQueueFamily; }
+	VkSemaphore GetTimelineSemaphore() const { return mTimelineSemaphore; }
+
+	// Gives back the ring space of the batches the GPU is done with, never waits
+	void Update();
+
+	void WaitIdle();
+
+	Statistics GetStatistics() const;
+
+private:
+	Batch& GetRecordingBatch();
+	bool TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void WaitForOldestBatch();
+	void CompleteOldestBatch();
+};
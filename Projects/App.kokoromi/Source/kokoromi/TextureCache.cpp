@@ -0,0 +1,128 @@
+#include "Scene.h"
+#include "TextureCompression.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Cryptography/Hash.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+//////////////////////////////////////////////////////////////////////////
+//                       Texture Cache - Format                         //
+//////////////////////////////////////////////////////////////////////////
+// A .ktex file is the header followed by the mip table and the mip levels, largest first.
+// The levels are stored 16 byte aligned in their GPU layout so they upload straight from the mapping.
+static const uint32_t TEXTURE_CACHE_MAGIC = 0x5845544B; // "KTEX"
+static const uint32_t TEXTURE_CACHE_VERSION = 3;
+static const size_t TEXTURE_CACHE_ALIGNMENT = 16;
+
+struct TextureCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint64_t SettingsHash;	// cook settings, checked whatever the CacheMatch
+	uint64_t FileSize;
+	TextureFormat Format;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t ChannelCount;
+	uint32_t MipCount;
+	uint32_t Reserved;
+};
+
+static size_t AlignTextureCacheOffset(size_t offset)
+{
+	return (offset + TEXTURE_CACHE_ALIGNMENT - 1) & ~(TEXTURE_CACHE_ALIGNMENT - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Texture Cache                             //
+//////////////////////////////////////////////////////////////////////////
+bool Texture::LoadCache(const char* cachePath, CacheMatch match, uint64_t settingsHash, uint64_t sourceHash)
+{
+	std::unique_ptr<W::MappedFile> cacheFile = std::make_unique<W::MappedFile>();
+	if (cacheFile->Open(cachePath) == false)
+		return false;
+
+	TextureCacheHeader header = {};
+	if (cacheFile->Size() < sizeof(header))
+		return false;
+
+	memcpy(&header, cacheFile->Data(), sizeof(header));
+	if (header.Magic != TEXTURE_CACHE_MAGIC ||
+		header.Version != TEXTURE_CACHE_VERSION ||
+		header.SettingsHash != settingsHash ||
+		(match == CacheMatch::Source && header.SourceHash != sourceHash) ||
+		header.FileSize != cacheFile->Size() ||
+		header.Format > TextureFormat::BC7 ||
+		header.Width == 0 || header.Height == 0 ||
+		header.MipCount == 0 || header.MipCount > MAX_TEXTURE_MIPS)
+	{
+		return false;
+	}
+
+	const size_t dataOffset = AlignTextureCacheOffset(sizeof(header) + header.MipCount * sizeof(TextureMip));
+	if (dataOffset > cacheFile->Size())
+		return false;
+
+	std::vector<TextureMip> mips(header.MipCount);
+	memcpy(mips.data(), cacheFile->Data() + sizeof(header), header.MipCount * sizeof(TextureMip));
+
+	// the levels are uploaded and decompressed at the size of their dimensions, a table entry of any other size would
+	// overrun the staging slot or the mapping
+	const size_t dataSize = cacheFile->Size() - dataOffset;
+	for (uint32_t mipLevel = 0; mipLevel < header.MipCount; ++mipLevel)
+	{
+		const TextureMip& mip = mips[mipLevel];
+		const uint32_t mipWidth = std::max(header.Width >> mipLevel, 1u);
+		const uint32_t mipHeight = std::max(header.Height >> mipLevel, 1u);
+		if (mip.Size != TextureCompression::GetImageSize(header.Format, mipWidth, mipHeight) ||
+			mip.Offset > dataSize || mip.Size > dataSize - mip.Offset)
+		{
+			return false;
+		}
+	}
+
+	Format = header.Format;
+	TextureWidth = static_cast<int>(header.Width);
+	TextureHeight = static_cast<int>(header.Height);
+	TextureChannels = static_cast<int>(header.ChannelCount);
+	Mips = std::move(mips);
+	Data = ArrayView<uint8_t>(cacheFile->Data() + dataOffset, dataSize);
+	CacheFile = std::move(cacheFile);
+	return true;
+}
+
+void Texture::SaveCache(const char* cachePath, uint64_t settingsHash, uint64_t sourceHash) const
+{
+	TextureCacheHeader header = {};
+	header.Magic = TEXTURE_CACHE_MAGIC;
+	header.Version = TEXTURE_CACHE_VERSION;
+	header.SourceHash = sourceHash;
+	header.SettingsHash = settingsHash;
+	header.Format = Format;
+	header.Width = static_cast<uint32_t>(TextureWidth);
+	header.Height = static_cast<uint32_t>(TextureHeight);
+	header.ChannelCount = static_cast<uint32_t>(TextureChannels);
+	header.MipCount = static_cast<uint32_t>(Mips.size());
+
+	const size_t dataOffset = AlignTextureCacheOffset(sizeof(header) + Mips.size() * sizeof(TextureMip));
+	header.FileSize = dataOffset + Data.size();
+
+	std::vector<uint8_t> buffer(dataOffset, 0);
+	memcpy(buffer.data(), &header, sizeof(header));
+	memcpy(buffer.data() + sizeof(header), Mips.data(), Mips.size() * sizeof(TextureMip));
+
+	std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		W::Logger::PrintFormat("Texture::SaveCache - failed to open %s\n", cachePath);
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	file.write(reinterpret_cast<const char*>(Data.data()), Data.size());
+	file.close();
+}
@@ -0,0 +1,771 @@
+#include "TextureCompression.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Threading/ThreadPool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const int BLOCK_DIMENSION = 4;
+static const int BLOCK_PIXEL_COUNT = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+// BC7 4 bit index weights, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC1 palette order is endpoint 0, endpoint 1, then the two interpolated colors
+static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+// 16 RGBA pixels, the edge pixels are repeated for blocks hanging over the image border
+struct PixelBlock
+{
+	uint8_t Pixels[BLOCK_PIXEL_COUNT][4];
+};
+
+static void LoadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, PixelBlock& block)
+{
+	for (int y = 0; y < BLOCK_DIMENSION; ++y)
+	{
+		const uint32_t pixelY = std::min(blockY * BLOCK_DIMENSION + y, height - 1);
+		for (int x = 0; x < BLOCK_DIMENSION; ++x)
+		{
+			const uint32_t pixelX = std::min(blockX * BLOCK_DIMENSION + x, width - 1);
+			memcpy(block.Pixels[y * BLOCK_DIMENSION + x], &pixels[(static_cast<size_t>(pixelY) * width + pixelX) * 4], 4);
+		}
+	}
+}
+
+static void StoreBlock(const PixelBlock& block, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t* pixels)
+{
+	for (int y = 0; y < BLOCK_DIMENSION; ++y)
+	{
+		const uint32_t pixelY = blockY * BLOCK_DIMENSION + y;
+		for (int x = 0; x < BLOCK_DIMENSION; ++x)
+		{
+			const uint32_t pixelX = blockX * BLOCK_DIMENSION + x;
+			if (pixelX < width && pixelY < height)
+			{
+				memcpy(&pixels[(static_cast<size_t>(pixelY) * width + pixelX) * 4], block.Pixels[y * BLOCK_DIMENSION + x], 4);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                             Endpoint Fit                             //
+//////////////////////////////////////////////////////////////////////////
+// Principal axis of the block colors by power iteration, the endpoints are the extremes of the projection on it
+template <int CHANNELS>
+static void FitEndpoints(const PixelBlock& block, float endpoint0[CHANNELS], float endpoint1[CHANNELS])
+{
+	float mean[CHANNELS] = {};
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		for (int c = 0; c < CHANNELS; ++c)
+			mean[c] += block.Pixels[i][c];
+	}
+	for (int c = 0; c < CHANNELS; ++c)
+		mean[c] /= BLOCK_PIXEL_COUNT;
+
+	float covariance[CHANNELS][CHANNELS] = {};
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		for (int r = 0; r < CHANNELS; ++r)
+		{
+			for (int c = 0; c < CHANNELS; ++c)
+				covariance[r][c] += (block.Pixels[i][r] - mean[r]) * (block.Pixels[i][c] - mean[c]);
+		}
+	}
+
+	float axis[CHANNELS];
+	for (int c = 0; c < CHANNELS; ++c)
+		axis[c] = 1.0f;
+
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[CHANNELS] = {};
+		for (int r = 0; r < CHANNELS; ++r)
+		{
+			for (int c = 0; c < CHANNELS; ++c)
+				next[r] += covariance[r][c] * axis[c];
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < CHANNELS; ++c)
+			length = std::max(length, std::fabs(next[c]));
+
+		// a flat block has no axis, any direction gives the same single color
+		if (length <= 0.0f)
+			break;
+
+		for (int c = 0; c < CHANNELS; ++c)
+			axis[c] = next[c] / length;
+	}
+
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		float projection = 0.0f;
+		for (int c = 0; c < CHANNELS; ++c)
+			projection += (block.Pixels[i][c] - mean[c]) * axis[c];
+
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	float axisLengthSquared = 0.0f;
+	for (int c = 0; c < CHANNELS; ++c)
+		axisLengthSquared += axis[c] * axis[c];
+
+	const float scale = (axisLengthSquared > 0.0f) ? 1.0f / axisLengthSquared : 0.0f;
+	for (int c = 0; c < CHANNELS; ++c)
+	{
+		endpoint0[c] = std::min(std::max(mean[c] + axis[c] * minProjection * scale, 0.0f), 255.0f);
+		endpoint1[c] = std::min(std::max(mean[c] + axis[c] * maxProjection * scale, 0.0f), 255.0f);
+	}
+}
+
+// Least squares endpoints for fixed interpolation weights, false when the weights do not constrain both endpoints
+template <int CHANNELS>
+static bool RefineEndpoints(const PixelBlock& block, const float weights[BLOCK_PIXEL_COUNT], float endpoint0[CHANNELS], float endpoint1[CHANNELS])
+{
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float rhs0[CHANNELS] = {};
+	float rhs1[CHANNELS] = {};
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		const float w1 = weights[i];
+		const float w0 = 1.0f - w1;
+		a += w0 * w0;
+		b += w0 * w1;
+		c += w1 * w1;
+
+		for (int channel = 0; channel < CHANNELS; ++channel)
+		{
+			rhs0[channel] += w0 * block.Pixels[i][channel];
+			rhs1[channel] += w1 * block.Pixels[i][channel];
+		}
+	}
+
+	const float determinant = a * c - b * b;
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+
+	for (int channel = 0; channel < CHANNELS; ++channel)
+	{
+		endpoint0[channel] = std::min(std::max((c * rhs0[channel] - b * rhs1[channel]) / determinant, 0.0f), 255.0f);
+		endpoint1[channel] = std::min(std::max((a * rhs1[channel] - b * rhs0[channel]) / determinant, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+template <int CHANNELS, int PALETTE_SIZE>
+static int SelectIndices(const PixelBlock& block, const int palette[PALETTE_SIZE][4], uint8_t indices[BLOCK_PIXEL_COUNT])
+{
+	int totalError = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		int bestError = INT32_MAX;
+		for (int entry = 0; entry < PALETTE_SIZE; ++entry)
+		{
+			int error = 0;
+			for (int c = 0; c < CHANNELS; ++c)
+			{
+				const int difference = palette[entry][c] - block.Pixels[i][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = static_cast<uint8_t>(entry);
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                 BC1                                  //
+//////////////////////////////////////////////////////////////////////////
+static uint16_t PackRGB565(const float color[3])
+{
+	const int r = static_cast<int>(color[0] * (31.0f / 255.0f) + 0.5f);
+	const int g = static_cast<int>(color[1] * (63.0f / 255.0f) + 0.5f);
+	const int b = static_cast<int>(color[2] * (31.0f / 255.0f) + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t color, int rgb[3])
+{
+	const int r = (color >> 11) & 31;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void BuildPaletteBC1(uint16_t color0, uint16_t color1, int palette[4][4])
+{
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+
+	for (int c = 0; c < 3; ++c)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = (color0 > color1) ? 255 : 0;
+}
+
+// Four color mode only, color0 > color1 - the block is opaque
+static int EncodeColorsBC1(const PixelBlock& block, const float endpoint0[3], const float endpoint1[3], uint16_t& color0, uint16_t& color1, uint8_t indices[BLOCK_PIXEL_COUNT])
+{
+	color0 = PackRGB565(endpoint0);
+	color1 = PackRGB565(endpoint1);
+
+	if (color0 == color1)
+	{
+		int palette[4][4];
+		BuildPaletteBC1(color0, color1, palette);
+
+		uint8_t unused[BLOCK_PIXEL_COUNT];
+		const int error = SelectIndices<3, 1>(block, palette, unused);
+
+		// equal endpoints would be three color mode, the unused one moves a step away and every index picks the other
+		if (color1 > 0)
+		{
+			color1 -= 1;
+			memset(indices, 0, BLOCK_PIXEL_COUNT);
+		}
+		else
+		{
+			color0 += 1;
+			memset(indices, 1, BLOCK_PIXEL_COUNT);
+		}
+		return error;
+	}
+
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	int palette[4][4];
+	BuildPaletteBC1(color0, color1, palette);
+	return SelectIndices<3, 4>(block, palette, indices);
+}
+
+static void CompressBlockBC1(const PixelBlock& block, uint8_t* output)
+{
+	float endpoint0[3], endpoint1[3];
+	FitEndpoints<3>(block, endpoint0, endpoint1);
+
+	uint16_t color0, color1;
+	uint8_t indices[BLOCK_PIXEL_COUNT];
+	int error = EncodeColorsBC1(block, endpoint0, endpoint1, color0, color1, indices);
+
+	// one least squares pass on the weights of the chosen indices
+	float weights[BLOCK_PIXEL_COUNT];
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+		weights[i] = BC1_WEIGHTS[indices[i]];
+
+	if (color0 != color1 && RefineEndpoints<3>(block, weights, endpoint0, endpoint1))
+	{
+		uint16_t refinedColor0, refinedColor1;
+		uint8_t refinedIndices[BLOCK_PIXEL_COUNT];
+		const int refinedError = EncodeColorsBC1(block, endpoint0, endpoint1, refinedColor0, refinedColor1, refinedIndices);
+		if (refinedError < error)
+		{
+			error = refinedError;
+			color0 = refinedColor0;
+			color1 = refinedColor1;
+			memcpy(indices, refinedIndices, BLOCK_PIXEL_COUNT);
+		}
+	}
+
+	uint32_t indexBits = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+		indexBits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+
+	memcpy(output + 0, &color0, 2);
+	memcpy(output + 2, &color1, 2);
+	memcpy(output + 4, &indexBits, 4);
+}
+
+static void DecompressBlockBC1(const uint8_t* input, PixelBlock& block)
+{
+	uint16_t color0, color1;
+	uint32_t indexBits;
+	memcpy(&color0, input + 0, 2);
+	memcpy(&color1, input + 2, 2);
+	memcpy(&indexBits, input + 4, 4);
+
+	int palette[4][4];
+	BuildPaletteBC1(color0, color1, palette);
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		const int index = (indexBits >> (i * 2)) & 3;
+		for (int c = 0; c < 4; ++c)
+			block.Pixels[i][c] = static_cast<uint8_t>(palette[index][c]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                               BC4 / BC5                              //
+//////////////////////////////////////////////////////////////////////////
+static void BuildPaletteBC4(int value0, int value1, int palette[8])
+{
+	palette[0] = value0;
+	palette[1] = value1;
+
+	if (value0 > value1)
+	{
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// Eight value mode between the extremes of the channel
+static void CompressChannelBC4(const PixelBlock& block, int channel, uint8_t* output)
+{
+	int minValue = 255;
+	int maxValue = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		minValue = std::min<int>(minValue, block.Pixels[i][channel]);
+		maxValue = std::max<int>(maxValue, block.Pixels[i][channel]);
+	}
+
+	int palette[8];
+	BuildPaletteBC4(maxValue, minValue, palette);
+
+	uint64_t indexBits = 0;
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		int bestIndex = 0;
+		int bestError = INT32_MAX;
+		for (int entry = 0; entry < 8; ++entry)
+		{
+			const int error = std::abs(palette[entry] - block.Pixels[i][channel]);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = entry;
+			}
+		}
+		indexBits |= static_cast<uint64_t>(bestIndex) << (i * 3);
+	}
+
+	output[0] = static_cast<uint8_t>(maxValue);
+	output[1] = static_cast<uint8_t>(minValue);
+	for (int i = 0; i < 6; ++i)
+		output[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+}
+
+static void DecompressChannelBC4(const uint8_t* input, uint8_t values[BLOCK_PIXEL_COUNT])
+{
+	int palette[8];
+	BuildPaletteBC4(input[0], input[1], palette);
+
+	uint64_t indexBits = 0;
+	for (int i = 0; i < 6; ++i)
+		indexBits |= static_cast<uint64_t>(input[2 + i]) << (i * 8);
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+		values[i] = static_cast<uint8_t>(palette[(indexBits >> (i * 3)) & 7]);
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                 BC7                                  //
+//////////////////////////////////////////////////////////////////////////
+// Mode 6 only - one subset, RGBA 7.7.7.7 endpoints with a shared bit each and 4 bit indices. It covers
+// smooth and alpha blended content well, the partitioned modes would only pay off on hard edged blocks.
+struct BitWriter
+{
+	uint8_t* Data;
+	int Position = 0;
+
+	void Write(uint32_t value, int bitCount)
+	{
+		for (int i = 0; i < bitCount; ++i, ++Position)
+		{
+			if ((value >> i) & 1)
+				Data[Position >> 3] |= static_cast<uint8_t>(1 << (Position & 7));
+		}
+	}
+};
+
+struct BitReader
+{
+	const uint8_t* Data;
+	int Position = 0;
+
+	uint32_t Read(int bitCount)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < bitCount; ++i, ++Position)
+			value |= static_cast<uint32_t>((Data[Position >> 3] >> (Position & 7)) & 1) << i;
+		return value;
+	}
+};
+
+struct EndpointsBC7
+{
+	int Color[2][4];	// 7 bit
+	int ParityBit[2];
+};
+
+// Rounds each endpoint to 7 bits plus the shared low bit that fits it best
+static void QuantizeEndpointsBC7(const float endpoint0[4], const float endpoint1[4], EndpointsBC7& endpoints)
+{
+	const float* source[2] = { endpoint0, endpoint1 };
+	for (int e = 0; e < 2; ++e)
+	{
+		float bestError = 1e30f;
+		for (int parity = 0; parity < 2; ++parity)
+		{
+			int color[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				color[c] = std::min(std::max(static_cast<int>((source[e][c] - parity) * 0.5f + 0.5f), 0), 127);
+				const float difference = static_cast<float>((color[c] << 1) | parity) - source[e][c];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				endpoints.ParityBit[e] = parity;
+				memcpy(endpoints.Color[e], color, sizeof(color));
+			}
+		}
+	}
+}
+
+static void BuildPaletteBC7(const EndpointsBC7& endpoints, int palette[16][4])
+{
+	for (int c = 0; c < 4; ++c)
+	{
+		const int value0 = (endpoints.Color[0][c] << 1) | endpoints.ParityBit[0];
+		const int value1 = (endpoints.Color[1][c] << 1) | endpoints.ParityBit[1];
+		for (int i = 0; i < 16; ++i)
+			palette[i][c] = ((64 - BC7_WEIGHTS[i]) * value0 + BC7_WEIGHTS[i] * value1 + 32) >> 6;
+	}
+}
+
+static int EncodeColorsBC7(const PixelBlock& block, const float endpoint0[4], const float endpoint1[4], EndpointsBC7& endpoints, uint8_t indices[BLOCK_PIXEL_COUNT])
+{
+	QuantizeEndpointsBC7(endpoint0, endpoint1, endpoints);
+
+	int palette[16][4];
+	BuildPaletteBC7(endpoints, palette);
+	return SelectIndices<4, 16>(block, palette, indices);
+}
+
+static void CompressBlockBC7(const PixelBlock& block, uint8_t* output)
+{
+	float endpoint0[4], endpoint1[4];
+	FitEndpoints<4>(block, endpoint0, endpoint1);
+
+	EndpointsBC7 endpoints;
+	uint8_t indices[BLOCK_PIXEL_COUNT];
+	const int error = EncodeColorsBC7(block, endpoint0, endpoint1, endpoints, indices);
+
+	float weights[BLOCK_PIXEL_COUNT];
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+		weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+
+	if (RefineEndpoints<4>(block, weights, endpoint0, endpoint1))
+	{
+		EndpointsBC7 refinedEndpoints;
+		uint8_t refinedIndices[BLOCK_PIXEL_COUNT];
+		if (EncodeColorsBC7(block, endpoint0, endpoint1, refinedEndpoints, refinedIndices) < error)
+		{
+			endpoints = refinedEndpoints;
+			memcpy(indices, refinedIndices, BLOCK_PIXEL_COUNT);
+		}
+	}
+
+	// the most significant bit of the first index is implicit zero, swapping the endpoints clears it
+	if (indices[0] & 8)
+	{
+		std::swap(endpoints.Color[0], endpoints.Color[1]);
+		std::swap(endpoints.ParityBit[0], endpoints.ParityBit[1]);
+		for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+			indices[i] = static_cast<uint8_t>(15 - indices[i]);
+	}
+
+	memset(output, 0, 16);
+	BitWriter writer = { output };
+	writer.Write(1 << 6, 7);
+
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.Write(endpoints.Color[0][c], 7);
+		writer.Write(endpoints.Color[1][c], 7);
+	}
+
+	writer.Write(endpoints.ParityBit[0], 1);
+	writer.Write(endpoints.ParityBit[1], 1);
+
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < BLOCK_PIXEL_COUNT; ++i)
+		writer.Write(indices[i], 4);
+}
+
+static void DecompressBlockBC7(const uint8_t* input, PixelBlock& block)
+{
+	BitReader reader = { input };
+
+	// anything but mode 6 is not written by the encoder above, decode it as opaque black like invalid blocks
+	if (reader.Read(7) != (1 << 6))
+	{
+		for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+		{
+			block.Pixels[i][0] = block.Pixels[i][1] = block.Pixels[i][2] = 0;
+			block.Pixels[i][3] = 255;
+		}
+		return;
+	}
+
+	EndpointsBC7 endpoints;
+	for (int c = 0; c < 4; ++c)
+	{
+		endpoints.Color[0][c] = reader.Read(7);
+		endpoints.Color[1][c] = reader.Read(7);
+	}
+	endpoints.ParityBit[0] = reader.Read(1);
+	endpoints.ParityBit[1] = reader.Read(1);
+
+	int palette[16][4];
+	BuildPaletteBC7(endpoints, palette);
+
+	for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+	{
+		const int index = reader.Read((i == 0) ? 3 : 4);
+		for (int c = 0; c < 4; ++c)
+			block.Pixels[i][c] = static_cast<uint8_t>(palette[index][c]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                           Texture Compression                        //
+//////////////////////////////////////////////////////////////////////////
+static size_t GetBlockBytes(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+	case TextureFormat::BC4:
+		return 8;
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+TextureFormat TextureCompression::ChooseFormat(int channelCount, const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	if (channelCount == 1)
+		return TextureFormat::BC4;
+
+	if (channelCount == 2)
+		return TextureFormat::BC5;
+
+	if (channelCount == 4)
+	{
+		const size_t pixelCount = static_cast<size_t>(width) * height;
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			if (pixels[i * 4 + 3] != 255)
+				return TextureFormat::BC7;
+		}
+	}
+
+	return TextureFormat::BC1;
+}
+
+size_t TextureCompression::GetImageSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+	if (format == TextureFormat::RGBA8)
+		return static_cast<size_t>(width) * height * 4;
+
+	const size_t blockCountX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const size_t blockCountY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	return blockCountX * blockCountY * GetBlockBytes(format);
+}
+
+void TextureCompression::Compress(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* output, W::ThreadPool* threadPool)
+{
+	if (format == TextureFormat::RGBA8)
+	{
+		memcpy(output, pixels, GetImageSize(format, width, height));
+		return;
+	}
+
+	const uint32_t blockCountX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const uint32_t blockCountY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const size_t blockBytes = GetBlockBytes(format);
+
+	auto compressRow = [=](size_t blockY)
+	{
+		uint8_t* rowOutput = output + blockY * blockCountX * blockBytes;
+		for (uint32_t blockX = 0; blockX < blockCountX; ++blockX)
+		{
+			PixelBlock block;
+			LoadBlock(pixels, width, height, blockX, static_cast<uint32_t>(blockY), block);
+
+			uint8_t* blockOutput = rowOutput + blockX * blockBytes;
+			switch (format)
+			{
+			case TextureFormat::BC1:
+				CompressBlockBC1(block, blockOutput);
+				break;
+			case TextureFormat::BC4:
+				CompressChannelBC4(block, 0, blockOutput);
+				break;
+			case TextureFormat::BC5:
+				CompressChannelBC4(block, 0, blockOutput);
+				CompressChannelBC4(block, 3, blockOutput + 8);
+				break;
+			case TextureFormat::BC7:
+				CompressBlockBC7(block, blockOutput);
+				break;
+			default:
+				Debug_AssertMsg(false, "unknown texture format %u", static_cast<uint32_t>(format));
+				break;
+			}
+		}
+	};
+
+	if (threadPool != nullptr)
+	{
+		threadPool->ParallelFor(blockCountY, compressRow);
+	}
+	else
+	{
+		for (uint32_t blockY = 0; blockY < blockCountY; ++blockY)
+			compressRow(blockY);
+	}
+}
+
+void TextureCompression::Decompress(TextureFormat format, const uint8_t* data, uint32_t width, uint32_t height, uint8_t* pixels)
+{
+	if (format == TextureFormat::RGBA8)
+	{
+		memcpy(pixels, data, GetImageSize(format, width, height));
+		return;
+	}
+
+	const uint32_t blockCountX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const uint32_t blockCountY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	const size_t blockBytes = GetBlockBytes(format);
+
+	for (uint32_t blockY = 0; blockY < blockCountY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blockCountX; ++blockX)
+		{
+			const uint8_t* blockInput = data + (static_cast<size_t>(blockY) * blockCountX + blockX) * blockBytes;
+
+			PixelBlock block;
+			uint8_t grey[BLOCK_PIXEL_COUNT];
+			uint8_t alpha[BLOCK_PIXEL_COUNT];
+			switch (format)
+			{
+			case TextureFormat::BC1:
+				DecompressBlockBC1(blockInput, block);
+				break;
+			case TextureFormat::BC4:
+			case TextureFormat::BC5:
+				DecompressChannelBC4(blockInput, grey);
+				if (format == TextureFormat::BC5)
+					DecompressChannelBC4(blockInput + 8, alpha);
+				else
+					memset(alpha, 255, sizeof(alpha));
+
+				for (int i = 0; i < BLOCK_PIXEL_COUNT; ++i)
+				{
+					block.Pixels[i][0] = block.Pixels[i][1] = block.Pixels[i][2] = grey[i];
+					block.Pixels[i][3] = alpha[i];
+				}
+				break;
+			case TextureFormat::BC7:
+				DecompressBlockBC7(blockInput, block);
+				break;
+			default:
+				Debug_AssertMsg(false, "unknown texture format %u", static_cast<uint32_t>(format));
+				return;
+			}
+
+			StoreBlock(block, width, height, blockX, blockY, pixels);
+		}
+	}
+}
+
+float TextureCompression::ComputePSNR(const uint8_t* pixels, const uint8_t* reference, uint32_t width, uint32_t height, int channelCount)
+{
+	// grey sources only carry information in red (and alpha)
+	const bool channels[4] = { true, channelCount >= 3, channelCount >= 3, channelCount == 2 || channelCount == 4 };
+
+	double squaredError = 0.0;
+	size_t sampleCount = 0;
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			if (channels[c] == false)
+				continue;
+
+			const double difference = static_cast<double>(pixels[i * 4 + c]) - reference[i * 4 + c];
+			squaredError += difference * difference;
+			sampleCount += 1;
+		}
+	}
+
+	if (sampleCount == 0 || squaredError == 0.0)
+		return INFINITY;
+
+	const double meanSquaredError = squaredError / sampleCount;
+	return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
+
+const char* TextureCompression::GetFormatName(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::RGBA8: return "RGBA8";
+	case TextureFormat::BC1: return "BC1";
+	case TextureFormat::BC4: return "BC4";
+	case TextureFormat::BC5: return "BC5";
+	case TextureFormat::BC7: return "BC7";
+	default: return "Unknown";
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum class TextureFormat : uint32_t;
+
+namespace W
+{
+	class ThreadPool;
+}
+
+namespace TextureCompression
+{
+	// BC1 for opaque color, BC7 when the alpha is used, BC4 for grey and BC5 for grey + alpha
+	TextureFormat ChooseFormat(int channelCount, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+	// Bytes of one mip level, BCn formats are stored as whole 4x4 blocks
+	size_t GetImageSize(TextureFormat format, uint32_t width, uint32_t height);
+
+	// Encodes RGBA8 pixels, the rows of blocks are spread over threadPool when one is given.
+	// BC4 stores the red channel, BC5 red and alpha - the renderer swizzles them back to grey.
+	void Compress(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* output, W::ThreadPool* threadPool);
+
+	// Decodes to RGBA8 with the channels expanded the same way the swizzle of the renderer does
+	void Decompress(TextureFormat format, const uint8_t* data, uint32_t width, uint32_t height, uint8_t* pixels);
+
+	// Peak signal to noise ratio in dB over the channels the source actually has
+	float ComputePSNR(const uint8_t* pixels, const uint8_t* reference, uint32_t width, uint32_t height, int channelCount);
+
+	const char* GetFormatName(TextureFormat format);
+} // namespace TextureCompression
@@ -0,0 +1,181 @@
+#include "TextureStreaming.h"
+
+#include <kokoromi/Scene.h>
+#include <kokoromi/TextureCompression.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Levels up to this size make up the mip tail
+static const int TAIL_MIP_SIZE = 64;
+
+static const uint64_t UPLOAD_ALIGNMENT = 16;
+
+static uint32_t GetMipWidth(const Texture& texture, uint32_t mipLevel)
+{
+	return static_cast<uint32_t>(std::max(texture.TextureWidth >> mipLevel, 1));
+}
+
+static uint32_t GetMipHeight(const Texture& texture, uint32_t mipLevel)
+{
+	return static_cast<uint32_t>(std::max(texture.TextureHeight >> mipLevel, 1));
+}
+
+static uint64_t GetMipSize(const Texture& texture, uint32_t mipLevel, bool decompress)
+{
+	if (decompress)
+		return static_cast<uint64_t>(GetMipWidth(texture, mipLevel)) * GetMipHeight(texture, mipLevel) * 4;
+
+	return texture.Mips[mipLevel].Size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                              Selection                               //
+//////////////////////////////////////////////////////////////////////////
+uint32_t TextureStreaming::GetTailMip(const Texture& texture)
+{
+	uint32_t mipLevel = 0;
+	while (mipLevel + 1 < texture.MipLevels && std::max(texture.TextureWidth, texture.TextureHeight) >> mipLevel > TAIL_MIP_SIZE)
+	{
+		++mipLevel;
+	}
+	return mipLevel;
+}
+
+uint32_t TextureStreaming::SelectMip(const Texture& texture, float screenSize)
+{
+	const uint32_t tailMip = GetTailMip(texture);
+	if (screenSize <= 1.0f)
+		return tailMip;
+
+	// one texel per pixel
+	const float texelsPerPixel = static_cast<float>(std::max(texture.TextureWidth, texture.TextureHeight)) / screenSize;
+	if (texelsPerPixel <= 1.0f)
+		return 0;
+
+	return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), tailMip);
+}
+
+void TextureStreaming::RequestMip(Texture& texture, float screenSize)
+{
+	// not created yet
+	if (texture.MipLevels == 0)
+		return;
+
+	texture.WantedMip = std::min(texture.WantedMip, SelectMip(texture, screenSize));
+	texture.ScreenSize = std::max(texture.ScreenSize, screenSize);
+}
+
+bool TextureStreaming::NeedsDecompress(const Texture& texture, bool textureCompressionBC)
+{
+	return (texture.Format != TextureFormat::RGBA8) && (textureCompressionBC == false);
+}
+
+uint64_t TextureStreaming::GetResidentSize(const Texture& texture, uint32_t firstMip, bool decompress)
+{
+	uint64_t size = 0;
+	for (uint32_t mipLevel = firstMip; mipLevel < texture.MipLevels; ++mipLevel)
+	{
+		size += GetMipSize(texture, mipLevel, decompress);
+	}
+	return size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                Budget                                //
+//////////////////////////////////////////////////////////////////////////
+void TextureStreaming::Plan(const std::vector<std::unique_ptr<Texture>>& textures, uint64_t budget, bool textureCompressionBC, std::vector<Texture*>& changes)
+{
+	std::vector<Texture*> candidates;
+	candidates.reserve(textures.size());
+
+	uint64_t tailSize = 0;
+	for (const std::unique_ptr<Texture>& texture : textures)
+	{
+		if (texture->MipLevels == 0)
+			continue;
+
+		tailSize += GetResidentSize(*texture, GetTailMip(*texture), NeedsDecompress(*texture, textureCompressionBC));
+		candidates.push_back(texture.get());
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) { return a->ScreenSize > b->ScreenSize; });
+
+	uint64_t available = (budget > tailSize) ? budget - tailSize : 0;
+	for (Texture* texture : candidates)
+	{
+		const bool decompress = NeedsDecompress(*texture, textureCompressionBC);
+		const uint32_t tailMip = GetTailMip(*texture);
+		const uint64_t textureTailSize = GetResidentSize(*texture, tailMip, decompress);
+
+		// not drawn last frame, keep the levels it has for when it comes back into view
+		uint32_t mipLevel = (texture->WantedMip == UINT32_MAX) ? texture->ResidentMip : texture->WantedMip;
+		mipLevel = std::min(mipLevel, tailMip);
+
+		while (mipLevel < tailMip && GetResidentSize(*texture, mipLevel, decompress) - textureTailSize > available)
+		{
+			++mipLevel;
+		}
+
+		available -= GetResidentSize(*texture, mipLevel, decompress) - textureTailSize;
+		texture->TargetMip = mipLevel;
+
+		texture->WantedMip = UINT32_MAX;
+		texture->ScreenSize = 0.0f;
+	}
+
+	// the evictions free the memory the loads are about to use
+	changes.clear();
+	for (Texture* texture : candidates)
+	{
+		if (texture->StreamingPending == false && texture->TargetMip > texture->ResidentMip)
+			changes.push_back(texture);
+	}
+	for (Texture* texture : candidates)
+	{
+		if (texture->StreamingPending == false && texture->TargetMip < texture->ResidentMip)
+			changes.push_back(texture);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                                Upload                                //
+//////////////////////////////////////////////////////////////////////////
+uint64_t TextureStreaming::GetUploadLayout(const Texture& texture, uint32_t firstMip, bool decompress, std::vector<TextureMip>& layout)
+{
+	Debug_Assert(firstMip < texture.MipLevels);
+
+	layout.resize(texture.MipLevels - firstMip);
+
+	uint64_t offset = 0;
+	for (uint32_t mipLevel = firstMip; mipLevel < texture.MipLevels; ++mipLevel)
+	{
+		TextureMip& mip = layout[mipLevel - firstMip];
+		mip.Offset = offset;
+		mip.Size = GetMipSize(texture, mipLevel, decompress);
+
+		offset = (offset + mip.Size + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+	}
+	return offset;
+}
+
+void TextureStreaming::FillUpload(const Texture& texture, uint32_t firstMip, bool decompress, const std::vector<TextureMip>& layout, uint8_t* upload)
+{
+	for (uint32_t mipLevel = firstMip; mipLevel < texture.MipLevels; ++mipLevel)
+	{
+		const TextureMip& source = texture.Mips[mipLevel];
+		const TextureMip& destination = layout[mipLevel - firstMip];
+
+		if (decompress)
+		{
+			TextureCompression::Decompress(texture.Format, texture.Data.data() + source.Offset, GetMipWidth(texture, mipLevel), GetMipHeight(texture, mipLevel), upload + destination.Offset);
+		}
+		else
+		{
+			memcpy(upload + destination.Offset, texture.Data.data() + source.Offset, static_cast<size_t>(source.Size));
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <memory>
+#include <vector>
+
+struct Texture;
+struct TextureMip;
+
+namespace TextureStreaming
+{
+	// First level of the mip tail, the small levels that are uploaded at load and never evicted
+	uint32_t GetTailMip(const Texture& texture);
+
+	// Finest level worth having for a surface covering screenSize pixels, the texture is assumed to be mapped once across it
+	uint32_t SelectMip(const Texture& texture, float screenSize);
+
+	// Called by every draw using the texture, the finest level and the largest screen size of the frame are kept
+	void RequestMip(Texture& texture, float screenSize);
+
+	// Block compressed levels are expanded to RGBA8 on the CPU for a device without textureCompressionBC. Decides the
+	// decompress argument below for every texture.
+	bool NeedsDecompress(const Texture& texture, bool textureCompressionBC);
+
+	// Video memory of the levels [firstMip, MipLevels), in RGBA8 when the blocks are expanded for the device
+	uint64_t GetResidentSize(const Texture& texture, uint32_t firstMip, bool decompress);
+
+	// Sets the TargetMip of every texture from the requests of the last frame and clears them. The textures largest on
+	// screen get their level first, the rest are pushed coarser until the budget fits. Textures that were not drawn
+	// keep what they have and are the first to give it up. The tails are always resident, even over the budget.
+	// changes receives the textures to re-upload - the evictions first, then the loads by screen size.
+	void Plan(const std::vector<std::unique_ptr<Texture>>& textures, uint64_t budget, bool textureCompressionBC, std::vector<Texture*>& changes);
+
+	// Upload buffer layout of the levels [firstMip, MipLevels), 16 byte aligned. Returns the buffer size.
+	uint64_t GetUploadLayout(const Texture& texture, uint32_t firstMip, bool decompress, std::vector<TextureMip>& layout);
+
+	// Copies the cooked levels into an upload buffer with that layout, expanding the blocks when decompress is set.
+	// Only reads the cooked data, so it can run on the workers.
+	void FillUpload(const Texture& texture, uint32_t firstMip, bool decompress, const std::vector<TextureMip>& layout, uint8_t* upload);
+} // namespace TextureStreaming
@@ -0,0 +1,105 @@
+#include "TransformHierarchy.h"
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <xmmintrin.h>
+
+#include <algorithm>
+
+// Column major 4x4 multiply, every result column is a linear combination of the columns of a
+static inline void MultiplyMatrix(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+	const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+	const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+	const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+	const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+	for (int column = 0; column < 4; ++column)
+	{
+		const __m128 x = _mm_set1_ps(b[column][0]);
+		const __m128 y = _mm_set1_ps(b[column][1]);
+		const __m128 z = _mm_set1_ps(b[column][2]);
+		const __m128 w = _mm_set1_ps(b[column][3]);
+
+		const __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, x), _mm_mul_ps(a1, y)), _mm_add_ps(_mm_mul_ps(a2, z), _mm_mul_ps(a3, w)));
+		_mm_storeu_ps(&result[column][0], value);
+	}
+}
+
+void TransformHierarchy::Clear()
+{
+	mParents.clear();
+	mLocalTransforms.clear();
+	mWorldTransforms.clear();
+	mDirty.clear();
+	mUpdateFrames.clear();
+	mUpdateFrame = 0;
+	mFirstDirty = 0;
+}
+
+void TransformHierarchy::Reserve(size_t nodeCount)
+{
+	mParents.reserve(nodeCount);
+	mLocalTransforms.reserve(nodeCount);
+	mWorldTransforms.reserve(nodeCount);
+	mDirty.reserve(nodeCount);
+	mUpdateFrames.reserve(nodeCount);
+}
+
+int32_t TransformHierarchy::AddNode(int32_t parent, const glm::mat4& localTransform)
+{
+	const int32_t node = static_cast<int32_t>(mParents.size());
+	Debug_AssertMsg(parent == INVALID_NODE || (parent >= 0 && parent < node), "parent %d has to be added before node %d", parent, node);
+
+	// the world transform is valid after the next Update
+	mParents.push_back(parent);
+	mLocalTransforms.push_back(localTransform);
+	mWorldTransforms.push_back(localTransform);
+	mDirty.push_back(1);
+	mUpdateFrames.push_back(mUpdateFrame - 1);
+
+	mFirstDirty = std::min(mFirstDirty, static_cast<size_t>(node));
+	return node;
+}
+
+void TransformHierarchy::SetLocalTransform(int32_t node, const glm::mat4& localTransform)
+{
+	Debug_Assert(node >= 0 && static_cast<size_t>(node) < mParents.size());
+
+	mLocalTransforms[node] = localTransform;
+	mDirty[node] = 1;
+	mFirstDirty = std::min(mFirstDirty, static_cast<size_t>(node));
+}
+
+bool TransformHierarchy::Update()
+{
+	const size_t nodeCount = mParents.size();
+	if (mFirstDirty >= nodeCount)
+		return false;
+
+	++mUpdateFrame;
+
+	// A row is recomputed when it was set or its parent was recomputed earlier in this pass
+	for (size_t node = mFirstDirty; node < nodeCount; ++node)
+	{
+		const int32_t parent = mParents[node];
+		const bool parentUpdated = (parent != INVALID_NODE) && (mUpdateFrames[parent] == mUpdateFrame);
+		if (mDirty[node] == 0 && parentUpdated == false)
+			continue;
+
+		if (parent != INVALID_NODE)
+		{
+			MultiplyMatrix(mWorldTransforms[parent], mLocalTransforms[node], mWorldTransforms[node]);
+		}
+		else
+		{
+			mWorldTransforms[node] = mLocalTransforms[node];
+		}
+
+		mDirty[node] = 0;
+		mUpdateFrames[node] = mUpdateFrame;
+	}
+
+	mFirstDirty = nodeCount;
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Flat table of scene node transforms, one row per node stored as structure of arrays.
+// Rows are added parents first, so a single forward pass sees every parent before its children.
+class TransformHierarchy
+{
+public:
+	static const int32_t INVALID_NODE = -1;
+
+	void Clear();
+	void Reserve(size_t nodeCount);
+
+	// Adds a row below parent (INVALID_NODE for a root), parent has to be an existing row
+	int32_t AddNode(int32_t parent, const glm::mat4& localTransform);
+
+	// Marks the row dirty, its subtree is recomputed by the next Update
+	void SetLocalTransform(int32_t node, const glm::mat4& localTransform);
+
+	// Recomputes the world transforms of the dirty subtrees, returns false without touching the table when nothing moved
+	bool Update();
+
+	// True when the world transform of the row changed in the last Update that did any work
+	bool IsUpdated(int32_t node) const { return mUpdateFrames[node] == mUpdateFrame; }
+
+	size_t GetNodeCount() const { return mParents.size(); }
+	int32_t GetParent(int32_t node) const { return mParents[node]; }
+	const glm::mat4& GetLocalTransform(int32_t node) const { return mLocalTransforms[node]; }
+	const glm::mat4& GetWorldTransform(int32_t node) const { return mWorldTransforms[node]; }
+
+	const std::vector<int32_t>& GetParents() const { return mParents; }
+	const std::vector<glm::mat4>& GetLocalTransforms() const { return mLocalTransforms; }
+
+private:
+	std::vector<int32_t> mParents;
+	std::vector<glm::mat4> mLocalTransforms;
+	std::vector<glm::mat4> mWorldTransforms;
+	std::vector<uint8_t> mDirty;
+	std::vector<uint32_t> mUpdateFrames;	// mUpdateFrame of the last Update that recomputed the row
+
+	uint32_t mUpdateFrame = 0;
+	size_t mFirstDirty = 0;					// rows before it are clean, GetNodeCount() when nothing is dirty
+};
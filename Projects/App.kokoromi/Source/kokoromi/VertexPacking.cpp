@@ -0,0 +1,139 @@
+#include "VertexPacking.h"
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+static const float UNORM16_MAX = 65535.0f;
+static const float SNORM16_MAX = 32767.0f;
+static const uint16_t RGB565_WHITE = 0xFFFF;
+
+template <typename T>
+static ArrayView<uint8_t> ByteView(const std::vector<T>& data)
+{
+	return ArrayView<uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size() * sizeof(T));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                          Vertex Quantization                         //
+//////////////////////////////////////////////////////////////////////////
+static uint16_t QuantizeUnorm16(float value)
+{
+	return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * UNORM16_MAX));
+}
+
+static int16_t QuantizeSnorm16(float value)
+{
+	return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * SNORM16_MAX));
+}
+
+static uint16_t EncodeRGB565(const glm::vec3& color)
+{
+	const uint32_t r = static_cast<uint32_t>(std::lround(glm::clamp(color.x, 0.0f, 1.0f) * 31.0f));
+	const uint32_t g = static_cast<uint32_t>(std::lround(glm::clamp(color.y, 0.0f, 1.0f) * 63.0f));
+	const uint32_t b = static_cast<uint32_t>(std::lround(glm::clamp(color.z, 0.0f, 1.0f) * 31.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+// Octahedral normal encoding (Meyer et al. 2010), decoded by OctDecode in shader_packed.vert
+static glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	const float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length <= 0.0f)
+		return glm::vec2(0.0f, 0.0f);
+
+	const glm::vec3 n = normal / length;
+	if (n.z >= 0.0f)
+		return glm::vec2(n.x, n.y);
+
+	// fold the lower hemisphere over the diagonals
+	const float signX = (n.x >= 0.0f) ? 1.0f : -1.0f;
+	const float signY = (n.y >= 0.0f) ? 1.0f : -1.0f;
+	return glm::vec2((1.0f - std::fabs(n.y)) * signX, (1.0f - std::fabs(n.x)) * signY);
+}
+
+static void QuantizeVertices(Model& model)
+{
+	// BoundingVolumes::Build has already reduced the positions
+	const glm::vec3 boundsMin = model.LocalBounds.Min;
+	const glm::vec3 boundsMax = model.LocalBounds.Max;
+
+	// a flat axis keeps a zero scale, every vertex then decodes to the offset
+	const glm::vec3 extent = boundsMax - boundsMin;
+	glm::vec3 inverseExtent(0.0f);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		inverseExtent[axis] = (extent[axis] > 0.0f) ? 1.0f / extent[axis] : 0.0f;
+	}
+
+	model.PositionScale = glm::vec4(extent / UNORM16_MAX, 0.0f);
+	model.PositionOffset = glm::vec4(boundsMin, 0.0f);
+
+	model.PackedVertices.resize(model.Vertices.size());
+	for (size_t i = 0; i < model.Vertices.size(); ++i)
+	{
+		const Vertex& vertex = model.Vertices[i];
+		PackedVertex& packedVertex = model.PackedVertices[i];
+
+		const glm::vec3 position = (vertex.Position - boundsMin) * inverseExtent;
+		packedVertex.Position[0] = QuantizeUnorm16(position.x);
+		packedVertex.Position[1] = QuantizeUnorm16(position.y);
+		packedVertex.Position[2] = QuantizeUnorm16(position.z);
+		packedVertex.Position[3] = model.HasVertexColor ? EncodeRGB565(vertex.Color) : RGB565_WHITE;
+
+		const glm::vec2 normal = EncodeOctahedral(vertex.Normal);
+		packedVertex.Normal[0] = QuantizeSnorm16(normal.x);
+		packedVertex.Normal[1] = QuantizeSnorm16(normal.y);
+
+		packedVertex.UV[0] = glm::packHalf1x16(vertex.UV.x);
+		packedVertex.UV[1] = glm::packHalf1x16(vertex.UV.y);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                            Vertex Packing                            //
+//////////////////////////////////////////////////////////////////////////
+void VertexPacking::Pack(Model& model, bool quantize)
+{
+	if (quantize)
+	{
+		QuantizeVertices(model);
+
+		model.Format = VertexFormat::Packed;
+		model.VertexData = ByteView(model.PackedVertices);
+	}
+	else
+	{
+		model.Format = VertexFormat::Float;
+		model.VertexData = ByteView(model.Vertices);
+	}
+
+	if (model.Vertices.size() <= MAX_INDEX16_VERTEX_COUNT)
+	{
+		model.PackedIndices.resize(model.Indices.size());
+		for (size_t i = 0; i < model.Indices.size(); ++i)
+		{
+			model.PackedIndices[i] = static_cast<uint16_t>(model.Indices[i]);
+		}
+
+		model.IndexStride = sizeof(uint16_t);
+		model.IndexData = ByteView(model.PackedIndices);
+	}
+	else
+	{
+		model.IndexStride = sizeof(uint32_t);
+		model.IndexData = ByteView(model.Indices);
+	}
+
+	const size_t vertexBytes = model.Vertices.size() * sizeof(Vertex);
+	const size_t indexBytes = model.Indices.size() * sizeof(uint32_t);
+	W::Logger::PrintFormat("VertexPacking - %s: vertices %zu -> %zu bytes, indices %zu -> %zu bytes\n",
+		model.Name.c_str(),
+		vertexBytes, model.VertexData.size(),
+		indexBytes, model.IndexData.size());
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+struct Model;
+
+namespace VertexPacking
+{
+	// 16 bit indices address vertices 0..65535
+	const uint32_t MAX_INDEX16_VERTEX_COUNT = 65536;
+
+	// Fills the GPU ready data of the model from its Vertices/Indices. With quantize the vertices
+	// are stored as PackedVertex, the indices are stored as 16 bit whenever the vertex count allows it.
+	void Pack(Model& model, bool quantize);
+} // namespace VertexPacking
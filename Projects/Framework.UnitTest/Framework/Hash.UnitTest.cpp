@@ -31,4 +31,24 @@ namespace W
 		uint64_t helloWorldHash64Combined = Hash::StringHash64("World", helloHash64);
 		EXPECT_EQ(helloWorldHash64, helloWorldHash64Combined);
 	}
+
+	TEST(Framework, DataHash64)
+	{
+		EXPECT_EQ(Hash::DataHash64(nullptr, 0), Hash::DataHashSeed64);
+
+		const char helloWorld[] = "HelloWorld";
+		uint64_t helloHash64 = Hash::DataHash64(helloWorld, 5);
+		uint64_t worldHash64 = Hash::DataHash64(helloWorld + 5, 5);
+		EXPECT_NE(helloHash64, worldHash64);
+
+		uint64_t helloWorldHash64 = Hash::DataHash64(helloWorld, 10);
+		uint64_t helloWorldHash64Combined = Hash::DataHash64(helloWorld + 5, 5, helloHash64);
+		EXPECT_EQ(helloWorldHash64, helloWorldHash64Combined);
+
+		// zero bytes are not absorbed by the seed
+		const uint8_t zeros[4] = {};
+		EXPECT_NE(Hash::DataHash64(zeros, 4), Hash::EmptyHash64);
+		EXPECT_NE(Hash::DataHash64(zeros, 4), Hash::DataHash64(zeros, 3));
+		EXPECT_NE(Hash::DataHash64(zeros, 1), Hash::DataHash64(nullptr, 0));
+	}
 }
\ No newline at end of file
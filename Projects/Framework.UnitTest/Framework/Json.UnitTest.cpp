@@ -0,0 +1,73 @@
+#include "pch.h"
+
+#include <Framework/Text/Json.hpp>
+
+#include <string.h>
+
+namespace W
+{
+	static bool ParseJson(const char* text, JsonValue& value)
+	{
+		return Json::Parse(text, strlen(text), value);
+	}
+
+	TEST(Framework, Json)
+	{
+		JsonValue document;
+		ASSERT_TRUE(ParseJson(u8R"({ "name": "Box\u00e9 \"1\"", "count": 3, "scale": -1.5e2, "visible": true, "parent": null,
+			"values": [0, 1, 2], "nested": { "empty": [], "inner": {} } })", document));
+
+		EXPECT_TRUE(document.IsObject());
+		EXPECT_EQ(document.Size(), 7u);
+		EXPECT_STREQ(document["name"].AsString(), u8"Boxé \"1\"");
+		EXPECT_EQ(document["count"].AsInt(), 3);
+		EXPECT_DOUBLE_EQ(document["scale"].AsNumber(), -150.0);
+		EXPECT_TRUE(document["visible"].AsBool());
+		EXPECT_TRUE(document["parent"].IsNull());
+		EXPECT_TRUE(document.HasMember("parent"));
+
+		const JsonValue& values = document["values"];
+		EXPECT_TRUE(values.IsArray());
+		EXPECT_EQ(values.Size(), 3u);
+		EXPECT_EQ(values[2].AsInt(), 2);
+
+		EXPECT_EQ(document["nested"]["empty"].Size(), 0u);
+		EXPECT_TRUE(document["nested"]["inner"].IsObject());
+
+		// missing members and elements read as the defaults
+		EXPECT_FALSE(document.HasMember("missing"));
+		EXPECT_TRUE(document["missing"]["deeper"][4].IsNull());
+		EXPECT_EQ(values[3].AsInt(-1), -1);
+		EXPECT_FLOAT_EQ(document["name"].AsFloat(2.0f), 2.0f);
+		EXPECT_STREQ(document["count"].AsString("none"), "none");
+
+		ASSERT_TRUE(ParseJson(R"("\ud83d\ude00")", document));
+		EXPECT_STREQ(document.AsString(), u8"\U0001F600");
+
+		// only the given length is parsed, the text does not need a terminator
+		const char* truncated = "[1, 2]garbage";
+		EXPECT_TRUE(Json::Parse(truncated, 6, document));
+		EXPECT_EQ(document.Size(), 2u);
+	}
+
+	TEST(Framework, JsonInvalid)
+	{
+		JsonValue document;
+		EXPECT_FALSE(ParseJson("", document));
+		EXPECT_FALSE(ParseJson("{", document));
+		EXPECT_FALSE(ParseJson("[1, 2,]", document));
+		EXPECT_FALSE(ParseJson("{\"a\" 1}", document));
+		EXPECT_FALSE(ParseJson("01", document));
+		EXPECT_FALSE(ParseJson("0x10", document));
+		EXPECT_FALSE(ParseJson("+1", document));
+		EXPECT_FALSE(ParseJson("\"\\x\"", document));
+		EXPECT_FALSE(ParseJson("\"\\udc00\"", document));
+		EXPECT_FALSE(ParseJson("tru", document));
+		EXPECT_FALSE(ParseJson("[] []", document));
+
+		size_t errorOffset = 0;
+		EXPECT_FALSE(Json::Parse("[1, x]", 6, document, &errorOffset));
+		EXPECT_EQ(errorOffset, 4u);
+		EXPECT_TRUE(document.IsNull());
+	}
+}
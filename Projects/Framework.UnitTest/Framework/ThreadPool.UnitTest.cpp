@@ -0,0 +1,79 @@
+#include "pch.h"
+
+#include <Framework/Threading/ThreadPool.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace W
+{
+	TEST(Framework, ThreadPool)
+	{
+		ThreadPool threadPool(4);
+		EXPECT_EQ(threadPool.GetThreadCount(), 4u);
+
+		std::atomic<int> counter{ 0 };
+		for (int i = 0; i < 100; ++i)
+		{
+			threadPool.Submit([&counter]() { counter.fetch_add(1); });
+		}
+
+		threadPool.WaitIdle();
+		EXPECT_EQ(counter.load(), 100);
+
+		std::vector<int> results(1000, 0);
+		threadPool.ParallelFor(results.size(), [&results](size_t index) { results[index] += static_cast<int>(index); });
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			EXPECT_EQ(results[i], static_cast<int>(i));
+		}
+
+		// fewer items than threads, and none at all
+		threadPool.ParallelFor(2, [&counter](size_t) { counter.fetch_add(1); });
+		threadPool.ParallelFor(0, [&counter](size_t) { counter.fetch_add(1); });
+		EXPECT_EQ(counter.load(), 102);
+	}
+
+	TEST(Framework, ThreadPoolParallelForBehindQueuedTask)
+	{
+		ThreadPool threadPool(1);
+
+		// the only worker is busy until the loop below is done, so the calling thread has to run every index
+		std::mutex mutex;
+		std::condition_variable released;
+		bool release = false;
+		threadPool.Submit([&]()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			released.wait(lock, [&release]() { return release; });
+		});
+
+		std::atomic<int> counter{ 0 };
+		threadPool.ParallelFor(100, [&counter](size_t) { counter.fetch_add(1); });
+		EXPECT_EQ(counter.load(), 100);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			release = true;
+		}
+		released.notify_one();
+		threadPool.WaitIdle();
+	}
+
+	TEST(Framework, ThreadPoolNestedParallelFor)
+	{
+		ThreadPool threadPool(2);
+
+		// every task runs its own loop while the other tasks hold the workers
+		std::atomic<int> counter{ 0 };
+		threadPool.ParallelFor(8, [&threadPool, &counter](size_t)
+		{
+			threadPool.ParallelFor(50, [&counter](size_t) { counter.fetch_add(1); });
+		});
+
+		EXPECT_EQ(counter.load(), 400);
+	}
+}
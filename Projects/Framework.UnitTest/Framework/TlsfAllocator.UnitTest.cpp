@@ -0,0 +1,110 @@
+#include "pch.h"
+
+#include <Framework/Memory/TlsfAllocator.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace W
+{
+	TEST(Framework, TlsfAllocator)
+	{
+		TlsfAllocator allocator(1024);
+		EXPECT_TRUE(allocator.IsEmpty());
+
+		TlsfAllocator::Allocation a = allocator.Allocate(100, 1);
+		ASSERT_TRUE(a.IsValid());
+		EXPECT_EQ(a.Offset, 0u);
+
+		// aligned after the first range
+		TlsfAllocator::Allocation b = allocator.Allocate(64, 256);
+		ASSERT_TRUE(b.IsValid());
+		EXPECT_EQ(b.Offset, 256u);
+		EXPECT_EQ(allocator.GetUsedSize(), 164u);
+		EXPECT_EQ(allocator.GetAllocationCount(), 2u);
+
+		// the alignment padding in front of b is still free
+		TlsfAllocator::Allocation c = allocator.Allocate(128, 4);
+		ASSERT_TRUE(c.IsValid());
+		EXPECT_GE(c.Offset, 100u);
+		EXPECT_LE(c.Offset + c.Size, 256u);
+
+		EXPECT_FALSE(allocator.Allocate(2048, 1).IsValid());
+		EXPECT_FALSE(allocator.Allocate(0, 1).IsValid());
+
+		allocator.Free(b);
+		allocator.Free(a);
+		allocator.Free(c);
+
+		// everything merged back into one range
+		const TlsfAllocator::Statistics statistics = allocator.GetStatistics();
+		EXPECT_TRUE(allocator.IsEmpty());
+		EXPECT_EQ(statistics.FreeRangeCount, 1u);
+		EXPECT_EQ(statistics.LargestFreeRange, 1024u);
+
+		TlsfAllocator::Allocation whole = allocator.Allocate(1024, 1024);
+		ASSERT_TRUE(whole.IsValid());
+		EXPECT_EQ(whole.Offset, 0u);
+		EXPECT_FALSE(allocator.Allocate(1, 1).IsValid());
+		allocator.Free(whole);
+
+		// a range just large enough is found even though its size class is rounded past it
+		TlsfAllocator::Allocation front = allocator.Allocate(14, 1);
+		TlsfAllocator::Allocation rest = allocator.Allocate(1000, 2);
+		ASSERT_TRUE(front.IsValid());
+		ASSERT_TRUE(rest.IsValid());
+		EXPECT_EQ(rest.Offset, 14u);
+	}
+
+	TEST(Framework, TlsfAllocatorRandom)
+	{
+		const uint64_t size = 64ull << 20;
+		TlsfAllocator allocator(size);
+
+		std::mt19937 random(1234);
+		std::vector<TlsfAllocator::Allocation> allocations;
+
+		for (int iteration = 0; iteration < 20000; ++iteration)
+		{
+			if (allocations.empty() == false && random() % 3 == 0)
+			{
+				const size_t index = random() % allocations.size();
+				allocator.Free(allocations[index]);
+				allocations[index] = allocations.back();
+				allocations.pop_back();
+				continue;
+			}
+
+			const uint64_t allocationSize = 1 + random() % (256 << 10);
+			const uint64_t alignment = 1ull << (random() % 17);
+			const TlsfAllocator::Allocation allocation = allocator.Allocate(allocationSize, alignment);
+			if (allocation.IsValid() == false)
+				continue;
+
+			EXPECT_EQ(allocation.Offset % alignment, 0u);
+			EXPECT_LE(allocation.Offset + allocation.Size, size);
+			allocations.push_back(allocation);
+		}
+
+		// no two ranges overlap
+		std::sort(allocations.begin(), allocations.end(), [](const TlsfAllocator::Allocation& a, const TlsfAllocator::Allocation& b) { return a.Offset < b.Offset; });
+		uint64_t usedSize = 0;
+		for (size_t i = 0; i < allocations.size(); ++i)
+		{
+			usedSize += allocations[i].Size;
+			if (i > 0)
+			{
+				EXPECT_LE(allocations[i - 1].Offset + allocations[i - 1].Size, allocations[i].Offset);
+			}
+		}
+		EXPECT_EQ(allocator.GetUsedSize(), usedSize);
+
+		for (const TlsfAllocator::Allocation& allocation : allocations)
+			allocator.Free(allocation);
+
+		EXPECT_TRUE(allocator.IsEmpty());
+		EXPECT_EQ(allocator.GetStatistics().FreeRangeCount, 1u);
+		EXPECT_EQ(allocator.GetStatistics().LargestFreeRange, size);
+	}
+}
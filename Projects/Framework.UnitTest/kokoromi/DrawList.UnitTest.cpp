@@ -0,0 +1,133 @@
+#include "pch.h"
+
+#include <kokoromi/DrawList.h>
+
+#include <algorithm>
+#include <random>
+
+namespace W
+{
+	static DrawCommand MakeCommand(uint32_t modelIndex)
+	{
+		DrawCommand command = {};
+		command.ModelIndex = modelIndex;
+		return command;
+	}
+
+	// Sorts the list and checks it against std::sort of the same keys, every sorted key still maps to its command
+	static void ExpectSorted(DrawList& drawList)
+	{
+		std::vector<uint64_t> expectedKeys(drawList.GetDrawCount());
+		for (size_t i = 0; i < drawList.GetDrawCount(); ++i)
+		{
+			expectedKeys[i] = drawList.GetKey(i);
+		}
+		std::sort(expectedKeys.begin(), expectedKeys.end());
+
+		drawList.Sort();
+
+		ASSERT_EQ(drawList.GetDrawCount(), expectedKeys.size());
+		for (size_t i = 0; i < expectedKeys.size(); ++i)
+		{
+			ASSERT_EQ(drawList.GetKey(i), expectedKeys[i]);
+			ASSERT_EQ(drawList.GetDraw(i).ModelIndex, static_cast<uint32_t>(expectedKeys[i] & (DrawList::MAX_DRAWS - 1)));
+		}
+	}
+
+	TEST(kokoromi, DrawListSort)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> depths(0.0f, 1.0f);
+		DrawList drawList;
+
+		// every field random, none of the passes is skipped
+		for (uint32_t i = 0; i < 5000; ++i)
+		{
+			const uint32_t pipeline = random() % DrawList::MAX_PIPELINES;
+			const uint32_t material = random() % DrawList::MAX_MATERIALS;
+			const uint32_t geometry = random() % DrawList::MAX_GEOMETRIES;
+			drawList.Add(pipeline, material, geometry, depths(random), MakeCommand(i));
+		}
+		ExpectSorted(drawList);
+
+		// one pipeline and fewer than 1024 materials skip the top byte, an odd number of passes ends in the scratch keys
+		drawList.Clear();
+		for (uint32_t i = 0; i < 5000; ++i)
+		{
+			drawList.Add(0, random() % 1000, random() % DrawList::MAX_GEOMETRIES, depths(random), MakeCommand(i));
+		}
+		ExpectSorted(drawList);
+
+		// one state and one depth leave only the passes of the draw index
+		drawList.Clear();
+		for (uint32_t i = 0; i < 300; ++i)
+		{
+			drawList.Add(1, 7, 0, 0.5f, MakeCommand(i));
+		}
+		ExpectSorted(drawList);
+
+		// added far to near they come out reversed
+		drawList.Clear();
+		for (uint32_t i = 0; i < 300; ++i)
+		{
+			drawList.Add(2, 9, 1, 1.0f - i / 300.0f, MakeCommand(i));
+		}
+		ExpectSorted(drawList);
+		EXPECT_EQ(drawList.GetDraw(0).ModelIndex, 299u);
+		EXPECT_EQ(drawList.GetDraw(299).ModelIndex, 0u);
+
+		// nothing to sort
+		drawList.Clear();
+		ExpectSorted(drawList);
+		drawList.Add(3, 3, 1, 0.25f, MakeCommand(0));
+		ExpectSorted(drawList);
+	}
+
+	TEST(kokoromi, DrawListKey)
+	{
+		const uint32_t maxPipeline = DrawList::MAX_PIPELINES - 1;
+		const uint32_t maxMaterial = DrawList::MAX_MATERIALS - 1;
+		const uint32_t maxGeometry = DrawList::MAX_GEOMETRIES - 1;
+
+		// pipeline 2 | material 16 | geometry 1 | depth 24 | index 21, every field at its maximum fills the key
+		DrawList drawList;
+		drawList.Add(maxPipeline, maxMaterial, maxGeometry, 1.0f, MakeCommand(0));
+
+		uint64_t key = drawList.GetKey(0);
+		EXPECT_EQ(key, ~0ull << 21);
+		EXPECT_EQ(DrawList::GetPipeline(key), maxPipeline);
+		EXPECT_EQ(DrawList::GetMaterial(key), maxMaterial);
+		EXPECT_EQ(DrawList::GetGeometry(key), maxGeometry);
+		EXPECT_EQ(DrawList::GetState(key), ~0ull >> 45);
+
+		// the fields do not bleed into each other
+		drawList.Clear();
+		drawList.Add(maxPipeline, 0, 0, 0.0f, MakeCommand(0));
+		drawList.Add(0, maxMaterial, 0, 0.0f, MakeCommand(1));
+		drawList.Add(0, 0, maxGeometry, 0.0f, MakeCommand(2));
+		drawList.Add(0, 0, 0, 1.0f, MakeCommand(3));
+		drawList.Add(0, 0, 0, 2.0f, MakeCommand(4));		// clamped to the far plane
+		drawList.Add(0, 0, 0, -1.0f, MakeCommand(5));		// clamped to the camera
+
+		EXPECT_EQ(drawList.GetKey(0), 3ull << 62);
+		EXPECT_EQ(drawList.GetKey(1), 0xFFFFull << 46 | 1);
+		EXPECT_EQ(drawList.GetKey(2), 1ull << 45 | 2);
+		EXPECT_EQ(drawList.GetKey(3), 0xFFFFFFull << 21 | 3);
+		EXPECT_EQ(drawList.GetKey(4), 0xFFFFFFull << 21 | 4);
+		EXPECT_EQ(drawList.GetKey(5), 5ull);
+
+		key = drawList.GetKey(1);
+		EXPECT_EQ(DrawList::GetPipeline(key), 0u);
+		EXPECT_EQ(DrawList::GetMaterial(key), maxMaterial);
+		EXPECT_EQ(DrawList::GetGeometry(key), 0u);
+
+		// a full list, the last draw index fills its field and still maps back to its command
+		drawList.Clear();
+		for (uint32_t i = 0; i < DrawList::MAX_DRAWS; ++i)
+		{
+			drawList.Add(maxPipeline, maxMaterial, maxGeometry, 1.0f, MakeCommand(i));
+		}
+		EXPECT_EQ(drawList.GetKey(DrawList::MAX_DRAWS - 1), ~0ull);
+		EXPECT_EQ(drawList.GetDraw(DrawList::MAX_DRAWS - 1).ModelIndex, DrawList::MAX_DRAWS - 1);
+	}
+}
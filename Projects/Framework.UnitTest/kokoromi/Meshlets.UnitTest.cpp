@@ -0,0 +1,70 @@
+#include "pch.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <kokoromi/Meshlets.h>
+#include <kokoromi/Scene.h>
+
+namespace W
+{
+	static Meshlet MakeMeshlet(const glm::vec4& boundingSphere, const glm::vec4& coneAxisCutoff, uint32_t triangleCount)
+	{
+		Meshlet meshlet = {};
+		meshlet.BoundingSphere = boundingSphere;
+		meshlet.ConeAxisCutoff = coneAxisCutoff;
+		meshlet.TriangleCount = triangleCount;
+		return meshlet;
+	}
+
+	TEST(kokoromi, MeshletsCull)
+	{
+		// camera 10 units away on -Y looking at the origin, z up like the Renderer
+		const glm::vec3 cameraPosition(0.0f, -10.0f, 0.0f);
+		const glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+		const glm::mat4 viewProjection = projection * view;
+
+		const glm::vec4 facingCamera(0.0f, -1.0f, 0.0f, 0.5f);
+		const glm::vec4 facingAway(0.0f, 1.0f, 0.0f, 0.5f);
+		const glm::vec4 noCone(0.0f, 1.0f, 0.0f, 1.0f);
+
+		const Meshlet meshlets[] =
+		{
+			MakeMeshlet(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), facingCamera, 10),		// visible
+			MakeMeshlet(glm::vec4(50.0f, 0.0f, 0.0f, 1.0f), facingCamera, 20),		// right of the frustum
+			MakeMeshlet(glm::vec4(0.0f, -20.0f, 0.0f, 1.0f), facingCamera, 30),	// behind the camera
+			MakeMeshlet(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), facingAway, 40),		// backfacing
+			MakeMeshlet(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), noCone, 50),			// backfacing but the cone can not cull
+			MakeMeshlet(glm::vec4(5.5f, 0.0f, 0.0f, 1.0f), facingCamera, 60),		// crosses the right plane
+		};
+		const size_t meshletCount = sizeof(meshlets) / sizeof(meshlets[0]);
+
+		Meshlets::CullStats stats = Meshlets::Cull(meshlets, meshletCount, glm::mat4(1.0f), viewProjection, cameraPosition);
+		EXPECT_EQ(stats.MeshletCount, 6u);
+		EXPECT_EQ(stats.FrustumCulledCount, 2u);
+		EXPECT_EQ(stats.BackfaceCulledCount, 1u);
+		EXPECT_EQ(stats.TriangleCount, 210u);
+		EXPECT_EQ(stats.VisibleTriangleCount, 120u);
+
+		// moved 50 units right the model only keeps the meshlet that was right of the frustum, the cones move with it
+		const glm::mat4 worldTransform = glm::translate(glm::mat4(1.0f), glm::vec3(-50.0f, 0.0f, 0.0f));
+		stats = Meshlets::Cull(meshlets, meshletCount, worldTransform, viewProjection, cameraPosition);
+		EXPECT_EQ(stats.MeshletCount, 6u);
+		EXPECT_EQ(stats.FrustumCulledCount, 5u);
+		EXPECT_EQ(stats.BackfaceCulledCount, 0u);
+		EXPECT_EQ(stats.VisibleTriangleCount, 20u);
+
+		// stats of several models add up
+		Meshlets::CullStats total;
+		total += Meshlets::Cull(meshlets, meshletCount, glm::mat4(1.0f), viewProjection, cameraPosition);
+		total += stats;
+		EXPECT_EQ(total.MeshletCount, 12u);
+		EXPECT_EQ(total.FrustumCulledCount, 7u);
+		EXPECT_EQ(total.VisibleTriangleCount, 140u);
+
+		EXPECT_EQ(Meshlets::Cull(meshlets, 0, glm::mat4(1.0f), viewProjection, cameraPosition).MeshletCount, 0u);
+	}
+}
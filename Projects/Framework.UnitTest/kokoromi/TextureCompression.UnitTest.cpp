@@ -0,0 +1,152 @@
+#include "pch.h"
+
+#include <kokoromi/Scene.h>
+#include <kokoromi/TextureCompression.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace W
+{
+	static const uint32_t IMAGE_SIZE = 8;
+
+	// 8x8 RGBA image of four blocks: solid, a horizontal and a vertical gradient between two colors, and two colors
+	// split down the middle. A grey image keeps red, green and blue equal, alpha fades over the gradients when it is used.
+	static std::vector<uint8_t> MakeImage(bool grey, bool alpha)
+	{
+		const uint8_t color0[4] = { 200, grey ? uint8_t(200) : uint8_t(40), grey ? uint8_t(200) : uint8_t(90), 255 };
+		const uint8_t color1[4] = { 30, grey ? uint8_t(30) : uint8_t(220), grey ? uint8_t(30) : uint8_t(150), uint8_t(alpha ? 0 : 255) };
+
+		std::vector<uint8_t> pixels(IMAGE_SIZE * IMAGE_SIZE * 4);
+		for (uint32_t y = 0; y < IMAGE_SIZE; ++y)
+		{
+			for (uint32_t x = 0; x < IMAGE_SIZE; ++x)
+			{
+				const uint32_t blockX = x % 4;
+				const uint32_t blockY = y % 4;
+
+				float weight = 0.0f;
+				if (x >= 4 && y < 4)
+					weight = blockX / 3.0f;
+				else if (x < 4 && y >= 4)
+					weight = blockY / 3.0f;
+				else if (x >= 4 && y >= 4)
+					weight = (blockX < 2) ? 0.0f : 1.0f;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					const float value = color0[c] + (color1[c] - color0[c]) * weight;
+					pixels[(y * IMAGE_SIZE + x) * 4 + c] = static_cast<uint8_t>(value + 0.5f);
+				}
+			}
+		}
+		return pixels;
+	}
+
+	// Blocks of the test image, see MakeImage
+	enum TestBlock
+	{
+		SOLID_BLOCK,
+		HORIZONTAL_BLOCK,
+		VERTICAL_BLOCK,
+		SPLIT_BLOCK,
+		TEST_BLOCK_COUNT
+	};
+
+	// Largest difference of a channel in each block after a round trip through the format
+	static void GetRoundTripErrors(TextureFormat format, const std::vector<uint8_t>& pixels, std::vector<uint8_t>& data, int errors[TEST_BLOCK_COUNT])
+	{
+		data.resize(TextureCompression::GetImageSize(format, IMAGE_SIZE, IMAGE_SIZE));
+		TextureCompression::Compress(format, pixels.data(), IMAGE_SIZE, IMAGE_SIZE, data.data(), nullptr);
+
+		std::vector<uint8_t> decompressed(pixels.size());
+		TextureCompression::Decompress(format, data.data(), IMAGE_SIZE, IMAGE_SIZE, decompressed.data());
+
+		std::fill(errors, errors + TEST_BLOCK_COUNT, 0);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			const size_t x = (i / 4) % IMAGE_SIZE;
+			const size_t y = (i / 4) / IMAGE_SIZE;
+			const int block = (x < 4) ? ((y < 4) ? SOLID_BLOCK : VERTICAL_BLOCK) : ((y < 4) ? HORIZONTAL_BLOCK : SPLIT_BLOCK);
+			errors[block] = std::max(errors[block], std::abs(static_cast<int>(decompressed[i]) - pixels[i]));
+		}
+	}
+
+	static void ExpectRoundTrip(TextureFormat format, const std::vector<uint8_t>& pixels, std::vector<uint8_t>& data, int solidTolerance, int tolerance)
+	{
+		int errors[TEST_BLOCK_COUNT];
+		GetRoundTripErrors(format, pixels, data, errors);
+
+		EXPECT_LE(errors[SOLID_BLOCK], solidTolerance) << TextureCompression::GetFormatName(format);
+		EXPECT_LE(errors[HORIZONTAL_BLOCK], tolerance) << TextureCompression::GetFormatName(format);
+		EXPECT_LE(errors[VERTICAL_BLOCK], tolerance) << TextureCompression::GetFormatName(format);
+		EXPECT_LE(errors[SPLIT_BLOCK], solidTolerance) << TextureCompression::GetFormatName(format);
+	}
+
+	TEST(kokoromi, TextureCompressionBC1)
+	{
+		const std::vector<uint8_t> pixels = MakeImage(false, false);
+		std::vector<uint8_t> data;
+
+		// 5 and 6 bit endpoints, four levels land on the gradients in thirds
+		EXPECT_EQ(TextureCompression::GetImageSize(TextureFormat::BC1, IMAGE_SIZE, IMAGE_SIZE), 32u);
+		ExpectRoundTrip(TextureFormat::BC1, pixels, data, 4, 8);
+
+		// every block is in four color mode, three color mode would decode index 3 as transparent black
+		for (size_t block = 0; block < data.size(); block += 8)
+		{
+			uint16_t color0, color1;
+			memcpy(&color0, &data[block + 0], 2);
+			memcpy(&color1, &data[block + 2], 2);
+			EXPECT_GT(color0, color1);
+		}
+
+		// a solid black block can only have its other endpoint above it
+		const std::vector<uint8_t> black(IMAGE_SIZE * IMAGE_SIZE * 4, 0);
+		std::vector<uint8_t> blackData(TextureCompression::GetImageSize(TextureFormat::BC1, IMAGE_SIZE, IMAGE_SIZE));
+		TextureCompression::Compress(TextureFormat::BC1, black.data(), IMAGE_SIZE, IMAGE_SIZE, blackData.data(), nullptr);
+
+		uint16_t color0, color1;
+		memcpy(&color0, &blackData[0], 2);
+		memcpy(&color1, &blackData[2], 2);
+		EXPECT_GT(color0, color1);
+
+		std::vector<uint8_t> decompressed(black.size());
+		TextureCompression::Decompress(TextureFormat::BC1, blackData.data(), IMAGE_SIZE, IMAGE_SIZE, decompressed.data());
+		for (size_t i = 0; i < decompressed.size(); ++i)
+		{
+			EXPECT_EQ(decompressed[i], (i % 4 == 3) ? 255 : 0);
+		}
+	}
+
+	TEST(kokoromi, TextureCompressionBC4)
+	{
+		const std::vector<uint8_t> pixels = MakeImage(true, false);
+		std::vector<uint8_t> data;
+
+		// 8 bit endpoints, the gradients in thirds fall between the eight levels. Grey comes back in red, green and blue.
+		EXPECT_EQ(TextureCompression::GetImageSize(TextureFormat::BC4, IMAGE_SIZE, IMAGE_SIZE), 32u);
+		ExpectRoundTrip(TextureFormat::BC4, pixels, data, 0, 255 / 14);
+	}
+
+	TEST(kokoromi, TextureCompressionBC5)
+	{
+		const std::vector<uint8_t> pixels = MakeImage(true, true);
+		std::vector<uint8_t> data;
+
+		// grey and alpha, each as a BC4 block
+		EXPECT_EQ(TextureCompression::GetImageSize(TextureFormat::BC5, IMAGE_SIZE, IMAGE_SIZE), 64u);
+		ExpectRoundTrip(TextureFormat::BC5, pixels, data, 0, 255 / 14);
+	}
+
+	TEST(kokoromi, TextureCompressionBC7)
+	{
+		// 7 bit endpoints with a parity bit and sixteen levels, opaque and with alpha
+		std::vector<uint8_t> data;
+		EXPECT_EQ(TextureCompression::GetImageSize(TextureFormat::BC7, IMAGE_SIZE, IMAGE_SIZE), 64u);
+		ExpectRoundTrip(TextureFormat::BC7, MakeImage(false, false), data, 2, 8);
+		ExpectRoundTrip(TextureFormat::BC7, MakeImage(false, true), data, 2, 8);
+	}
+}
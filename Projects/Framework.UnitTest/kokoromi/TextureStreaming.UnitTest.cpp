@@ -0,0 +1,178 @@
+#include "pch.h"
+
+#include <kokoromi/Scene.h>
+#include <kokoromi/TextureStreaming.h>
+
+namespace W
+{
+	// Square RGBA8 texture with its full chain, only the tail is resident like right after the load
+	static std::unique_ptr<Texture> MakeTexture(int size)
+	{
+		std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+		texture->TextureWidth = size;
+		texture->TextureHeight = size;
+		texture->Format = TextureFormat::RGBA8;
+
+		uint64_t offset = 0;
+		for (int mipSize = size; ; mipSize /= 2)
+		{
+			TextureMip mip;
+			mip.Offset = offset;
+			mip.Size = static_cast<uint64_t>(mipSize) * mipSize * 4;
+			texture->Mips.push_back(mip);
+			offset += mip.Size;
+
+			if (mipSize == 1)
+				break;
+		}
+
+		texture->MipLevels = static_cast<uint32_t>(texture->Mips.size());
+		texture->ResidentMip = TextureStreaming::GetTailMip(*texture);
+		texture->TargetMip = texture->ResidentMip;
+		return texture;
+	}
+
+	static uint64_t GetMipBytes(int size)
+	{
+		return static_cast<uint64_t>(size) * size * 4;
+	}
+
+	TEST(kokoromi, TextureStreamingSelectMip)
+	{
+		std::unique_ptr<Texture> texture = MakeTexture(1024);
+
+		// the levels up to 64 pixels are the tail
+		EXPECT_EQ(texture->MipLevels, 11u);
+		EXPECT_EQ(TextureStreaming::GetTailMip(*texture), 4u);
+		EXPECT_EQ(TextureStreaming::GetTailMip(*MakeTexture(32)), 0u);
+
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 2048.0f), 0u);
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 1024.0f), 0u);
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 512.0f), 1u);
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 300.0f), 1u);
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 8.0f), 4u);
+		EXPECT_EQ(TextureStreaming::SelectMip(*texture, 0.0f), 4u);
+
+		// the finest level and the largest size of the frame win
+		TextureStreaming::RequestMip(*texture, 300.0f);
+		TextureStreaming::RequestMip(*texture, 1024.0f);
+		TextureStreaming::RequestMip(*texture, 100.0f);
+		EXPECT_EQ(texture->WantedMip, 0u);
+		EXPECT_EQ(texture->ScreenSize, 1024.0f);
+
+		// only the block compressed levels are expanded, and only without the device support
+		EXPECT_FALSE(TextureStreaming::NeedsDecompress(*texture, false));
+		texture->Format = TextureFormat::BC1;
+		EXPECT_TRUE(TextureStreaming::NeedsDecompress(*texture, false));
+		EXPECT_FALSE(TextureStreaming::NeedsDecompress(*texture, true));
+	}
+
+	TEST(kokoromi, TextureStreamingPlanUnderBudget)
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		textures.push_back(MakeTexture(1024));
+		textures.push_back(MakeTexture(512));
+		textures.push_back(MakeTexture(1024));
+
+		TextureStreaming::RequestMip(*textures[0], 300.0f);
+		TextureStreaming::RequestMip(*textures[1], 4096.0f);
+		TextureStreaming::RequestMip(*textures[2], 2048.0f);
+
+		// everything fits, each gets the finest level it asked for and the loads go by screen size
+		std::vector<Texture*> changes;
+		TextureStreaming::Plan(textures, 64ull << 20, true, changes);
+
+		EXPECT_EQ(textures[0]->TargetMip, 1u);
+		EXPECT_EQ(textures[1]->TargetMip, 0u);
+		EXPECT_EQ(textures[2]->TargetMip, 0u);
+
+		ASSERT_EQ(changes.size(), 3u);
+		EXPECT_EQ(changes[0], textures[1].get());
+		EXPECT_EQ(changes[1], textures[2].get());
+		EXPECT_EQ(changes[2], textures[0].get());
+
+		// the requests are consumed
+		for (const std::unique_ptr<Texture>& texture : textures)
+		{
+			EXPECT_EQ(texture->WantedMip, UINT32_MAX);
+			EXPECT_EQ(texture->ScreenSize, 0.0f);
+		}
+
+		// once resident and still drawn the same, nothing changes
+		for (const std::unique_ptr<Texture>& texture : textures)
+		{
+			texture->ResidentMip = texture->TargetMip;
+		}
+		TextureStreaming::RequestMip(*textures[0], 300.0f);
+		TextureStreaming::RequestMip(*textures[1], 4096.0f);
+		TextureStreaming::RequestMip(*textures[2], 2048.0f);
+		TextureStreaming::Plan(textures, 64ull << 20, true, changes);
+		EXPECT_TRUE(changes.empty());
+	}
+
+	TEST(kokoromi, TextureStreamingPlanOverBudget)
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		textures.push_back(MakeTexture(1024));
+		textures.push_back(MakeTexture(1024));
+		textures.push_back(MakeTexture(1024));
+
+		const uint64_t tailSize = TextureStreaming::GetResidentSize(*textures[0], 4, false);
+		EXPECT_EQ(TextureStreaming::GetResidentSize(*textures[0], 0, false), GetMipBytes(1024) + GetMipBytes(512) + GetMipBytes(256) + GetMipBytes(128) + tailSize);
+
+		// the first was fully resident and is not drawn anymore, the second is under way
+		textures[0]->ResidentMip = 0;
+		textures[0]->TargetMip = 0;
+		textures[2]->StreamingPending = true;
+
+		TextureStreaming::RequestMip(*textures[1], 2048.0f);
+		TextureStreaming::RequestMip(*textures[2], 1024.0f);
+
+		// the tails and one full chain above them, the largest on screen takes it and the others give theirs up
+		const uint64_t budget = 3 * tailSize + GetMipBytes(1024) + GetMipBytes(512) + GetMipBytes(256) + GetMipBytes(128);
+		std::vector<Texture*> changes;
+		TextureStreaming::Plan(textures, budget, true, changes);
+
+		EXPECT_EQ(textures[0]->TargetMip, 4u);
+		EXPECT_EQ(textures[1]->TargetMip, 0u);
+		EXPECT_EQ(textures[2]->TargetMip, 4u);
+
+		// the eviction frees the memory before the load, the pending texture waits for its upload
+		ASSERT_EQ(changes.size(), 2u);
+		EXPECT_EQ(changes[0], textures[0].get());
+		EXPECT_EQ(changes[1], textures[1].get());
+
+		// without the room for the top levels each is pushed down until it fits in what the larger ones left
+		for (const std::unique_ptr<Texture>& texture : textures)
+		{
+			texture->ResidentMip = 4;
+			texture->StreamingPending = false;
+		}
+		TextureStreaming::RequestMip(*textures[0], 2048.0f);
+		TextureStreaming::RequestMip(*textures[1], 1024.0f);
+		const uint64_t smallBudget = 3 * tailSize + GetMipBytes(512) + GetMipBytes(256) + GetMipBytes(128) + GetMipBytes(128);
+		TextureStreaming::Plan(textures, smallBudget, true, changes);
+
+		EXPECT_EQ(textures[0]->TargetMip, 1u);
+		EXPECT_EQ(textures[1]->TargetMip, 3u);
+		EXPECT_EQ(textures[2]->TargetMip, 4u);
+	}
+
+	TEST(kokoromi, TextureStreamingPlanTailOverBudget)
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		textures.push_back(MakeTexture(1024));
+		textures.push_back(MakeTexture(32));
+
+		TextureStreaming::RequestMip(*textures[0], 2048.0f);
+		TextureStreaming::RequestMip(*textures[1], 2048.0f);
+
+		// the tails stay resident over the budget, nothing above them is loaded
+		std::vector<Texture*> changes;
+		TextureStreaming::Plan(textures, GetMipBytes(64) / 2, true, changes);
+
+		EXPECT_EQ(textures[0]->TargetMip, 4u);
+		EXPECT_EQ(textures[1]->TargetMip, 0u);
+		EXPECT_TRUE(changes.empty());
+	}
+}
@@ -107,4 +107,17 @@ namespace W
 
 		return crc;
 	}
+
+	uint64_t Hash::DataHash64(const void* data, size_t size, uint64_t previousHash)
+	{
+		uint64_t crc = previousHash;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc = s_crc64[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+		}
+
+		return crc;
+	}
 } // namespace W
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 namespace W
 {
@@ -9,7 +10,12 @@ namespace W
 		constexpr uint32_t EmptyHash32 = 0;
 		constexpr uint64_t EmptyHash64 = 0;
 
+		// Start of DataHash64, all bits set so leading zero bytes still change the CRC
+		constexpr uint64_t DataHashSeed64 = ~0ull;
+
 		uint32_t StringHash32(const char* text, uint32_t previousHash = EmptyHash32);
 		uint64_t StringHash64(const char* text, uint64_t previousHash = EmptyHash64);
+
+		uint64_t DataHash64(const void* data, size_t size, uint64_t previousHash = DataHashSeed64);
 	} // namespace Hash
 } // namespace W
\ No newline at end of file
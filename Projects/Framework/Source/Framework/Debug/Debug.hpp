@@ -1,9 +1,12 @@
 #pragma once
 #include <Framework/Debug/Logger.hpp>
 
+#if defined(_MSC_VER)
 #include <intrin.h>
-
 #define Debug_BreakPoint() __debugbreak()
+#else
+#define Debug_BreakPoint() __builtin_trap()
+#endif
 
 #define Debug_Assert(condition)						do { if (!(condition)) { ::W::Logger::AssertFailure(__FILE__, __LINE__, #condition, nullptr             ); Debug_BreakPoint(); } } while(false)
-#define Debug_AssertMsg(condition, message, ...)	do { if (!(condition)) { ::W::Logger::AssertFailure(__FILE__, __LINE__, #condition, message, __VA_ARGS__); Debug_BreakPoint(); } } while(false)
+#define Debug_AssertMsg(condition, message, ...)	do { if (!(condition)) { ::W::Logger::AssertFailure(__FILE__, __LINE__, #condition, message, ##__VA_ARGS__); Debug_BreakPoint(); } } while(false)
@@ -0,0 +1,11 @@
+#include <Framework/Debug/Logger.hpp>
+
+#include <stdio.h>
+
+namespace W
+{
+	void Logger::Print(const char* text)
+	{
+		fputs(text, stdout);
+	}
+} // namespace W
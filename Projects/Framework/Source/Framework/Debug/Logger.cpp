@@ -34,7 +34,7 @@ namespace W
 		}
 		else
 		{
-			strcpy_s(buffer, "[ASSERT]");
+			Text::Format(buffer, "%s", "[ASSERT]");
 		}
 
 		PrintFormat(
@@ -2,9 +2,15 @@
 
 namespace W
 {
+	class StringBuilder;
+
 	namespace ShaderCompiler
 	{
-		void Compile_SPIRV_GLSLC();
-		void Compile_SPIRV_DXC();
+		// Command line compiling one shader to SPIR-V, hashed by kokoromi-cook with the source so a change of compiler or flags rebuilds it
+		void GetCommandLine_SPIRV_GLSLC(const char* shaderPath, const char* outputPath, StringBuilder& commandLine);
+		void GetCommandLine_SPIRV_DXC(const char* shaderPath, const char* outputPath, StringBuilder& commandLine);
+
+		// Runs one of the command lines above, logs the compiler output and returns false when it fails
+		bool Compile(const char* shaderPath, const char* commandLine);
 	} // namespace ShaderCompiler
 } // namespace W
@@ -7,38 +7,34 @@
 
 namespace W
 {
-	void ShaderCompiler::Compile_SPIRV_GLSLC()
-	{
-		OS::CreateDirectory("build");
-		OS::CreateDirectory("build\\Data");
-		OS::CreateDirectory("build\\Data\\Shaders");
+#if defined(_WIN32)
+	static const char* SDK_TOOL_FORMAT = "%s\\Bin\\%s.exe";
+#else
+	static const char* SDK_TOOL_FORMAT = "%s/bin/%s";
+#endif
 
+	static void AppendTool(const char* toolName, StringBuilder& commandLine)
+	{
 		const char* vulkan_sdk_path = OS::GetEnvironmentVariable("VULKAN_SDK");
+#if defined(_WIN32)
 		Debug_AssertMsg(vulkan_sdk_path != nullptr, "missing VULKAN_SDK environment variable");
-
-		StringBuilder command_line;
-		Process process;
-
-		const char* shader_build_list[] = {
-			"Data\\Shaders\\shader.vert",
-			"Data\\Shaders\\shader.frag",
-		};
-
-		for (const char* shader_path : shader_build_list)
+#else
+		// the distribution packages put the tools on the PATH
+		if (vulkan_sdk_path == nullptr)
 		{
-			command_line.Clear();
-			command_line.AppendFormat("%s\\Bin\\glslc.exe", vulkan_sdk_path);
-			command_line.AppendFormat(" %s", shader_path);
-			command_line.AppendFormat(" -o build\\%s.spv", shader_path);
-
-			process.Start(command_line.Text());
-			process.WaitForExit();
-			if (process.GetExitCode() != 0)
-			{
-				process.ReadOutput();
-				Debug_AssertMsg(false, "Shader Build Failed - %s\n%s", shader_path, process.GetOutputText());
-			}
+			commandLine.Append(toolName);
+			return;
 		}
+#endif
+		commandLine.AppendFormat(SDK_TOOL_FORMAT, vulkan_sdk_path, toolName);
+	}
+
+	void ShaderCompiler::GetCommandLine_SPIRV_GLSLC(const char* shaderPath, const char* outputPath, StringBuilder& commandLine)
+	{
+		commandLine.Clear();
+		AppendTool("glslc", commandLine);
+		commandLine.AppendFormat(" %s", shaderPath);
+		commandLine.AppendFormat(" -o %s", outputPath);
 	}
 
 	enum class ShaderStage
@@ -67,56 +63,44 @@ namespace W
 		return nullptr;
 	}
 
-	void ShaderCompiler::Compile_SPIRV_DXC()
+	void ShaderCompiler::GetCommandLine_SPIRV_DXC(const char* shaderPath, const char* outputPath, StringBuilder& commandLine)
 	{
-		OS::CreateDirectory("build");
-		OS::CreateDirectory("build\\Data");
-		OS::CreateDirectory("build\\Data\\Shaders");
+		ShaderStage shader_stage = ShaderStage::Vertex;
+		const char* entry_point = "PS";
 
-		const char* vulkan_sdk_path = OS::GetEnvironmentVariable("VULKAN_SDK");
-		Debug_AssertMsg(vulkan_sdk_path != nullptr, "missing VULKAN_SDK environment variable");
+		commandLine.Clear();
+		AppendTool("dxc", commandLine);
 
-		StringBuilder command_line;
-		Process process;
-
-		const char* shader_build_list[] = {
-			"Data\\Shaders\\Debug.hlsl",
-		};
-
-		for (const char* shader_path : shader_build_list)
-		{
-			ShaderStage shader_stage = ShaderStage::Vertex;
-			const char* entry_point = "PS";
-
-			command_line.Clear();
-			command_line.AppendFormat("%s\\Bin\\dxc.exe", vulkan_sdk_path);
-
-			command_line.Append(" -Zpr"); // Pack matrices in row-major order.
-			command_line.Append(" -Ges"); // Enable strict mode.
-			command_line.Append(" -WX"); // Treat warnings as errors.
-			// command_line.Append(" -no-warnings"); // Suppresses all warnings
+		commandLine.Append(" -Zpr"); // Pack matrices in row-major order.
+		commandLine.Append(" -Ges"); // Enable strict mode.
+		commandLine.Append(" -WX"); // Treat warnings as errors.
+		// commandLine.Append(" -no-warnings"); // Suppresses all warnings
 
-			command_line.Append(" -spirv"); // Generates SPIR-V code.
-			command_line.Append(" -fspv-reflect"); // Emits additional SPIR-V instructions to aid reflection.
+		commandLine.Append(" -spirv"); // Generates SPIR-V code.
+		commandLine.Append(" -fspv-reflect"); // Emits additional SPIR-V instructions to aid reflection.
 
-			// Shader profile
-			const char* profile_name = GetShaderTargetProfile(shader_stage);
+		// Shader profile
+		const char* profile_name = GetShaderTargetProfile(shader_stage);
 
-			// Command line
-			command_line.AppendFormat(" -T %s", profile_name);
-			command_line.AppendFormat(" -E %s", entry_point);
-			command_line.AppendFormat(" -Fo build\\%s.spv", shader_path);
+		// Command line
+		commandLine.AppendFormat(" -T %s", profile_name);
+		commandLine.AppendFormat(" -E %s", entry_point);
+		commandLine.AppendFormat(" -Fo %s", outputPath);
 
-			command_line.AppendFormat(" %s", shader_path);
+		commandLine.AppendFormat(" %s", shaderPath);
+	}
 
-			process.Start(command_line.Text());
-			process.WaitForExit();
-			if (process.GetExitCode() != 0)
-			{
-				process.ReadOutput();
-				Debug_AssertMsg(false, "Shader Build Failed - %s\n%s", shader_path, process.GetOutputText());
-			}
+	bool ShaderCompiler::Compile(const char* shaderPath, const char* commandLine)
+	{
+		Process process;
+		process.Start(commandLine);
+		process.WaitForExit();
+		if (process.GetExitCode() != 0)
+		{
+			process.ReadOutput();
+			Logger::PrintFormat("Shader Build Failed - %s\n%s", shaderPath, process.GetOutputText());
+			return false;
 		}
+		return true;
 	}
-
 } // namespace W
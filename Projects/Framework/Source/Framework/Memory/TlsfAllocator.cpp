@@ -0,0 +1,312 @@
+#include "TlsfAllocator.hpp"
+
+#include <Framework/Debug/Debug.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace W
+{
+	static uint32_t FindLastSet(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	static uint32_t FindFirstSet(uint64_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// Size classes - sizes below SECOND_LEVEL_COUNT get one class each, above that every power of two
+	// is split into SECOND_LEVEL_COUNT linear classes
+	static void GetSizeClass(uint64_t size, uint32_t secondLevelLog2, uint32_t& firstLevel, uint32_t& secondLevel)
+	{
+		if (size < (1ull << secondLevelLog2))
+		{
+			firstLevel = 0;
+			secondLevel = static_cast<uint32_t>(size);
+			return;
+		}
+
+		const uint32_t lastSet = FindLastSet(size);
+		firstLevel = lastSet - secondLevelLog2 + 1;
+		secondLevel = static_cast<uint32_t>(size >> (lastSet - secondLevelLog2)) ^ (1u << secondLevelLog2);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//                            TlsfAllocator                             //
+	//////////////////////////////////////////////////////////////////////////
+	TlsfAllocator::TlsfAllocator(uint64_t size)
+		: mSize(size)
+	{
+		for (uint32_t (&freeLists)[SECOND_LEVEL_COUNT] : mFreeLists)
+		{
+			for (uint32_t& freeList : freeLists)
+				freeList = INVALID_NODE;
+		}
+
+		if (size > 0)
+		{
+			const uint32_t node = CreateNode();
+			mNodes[node].Offset = 0;
+			mNodes[node].Size = size;
+			InsertFree(node);
+		}
+	}
+
+	TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		Debug_Assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+		Allocation allocation;
+		if (size == 0 || size > mSize)
+			return allocation;
+
+		// Usually the head of the class of the size is aligned already. When it is not, any range of the class
+		// of the size with the worst case padding fits. Last, the ranges of the class the size itself falls in
+		// are walked, a nearly full allocator still finds a range just large enough.
+		uint32_t node = FindFree(size);
+		if (node != INVALID_NODE && Fits(node, size, alignment) == false)
+		{
+			const uint64_t searchSize = size + alignment - 1;
+			node = (searchSize > size) ? FindFree(searchSize) : INVALID_NODE;
+		}
+
+		if (node == INVALID_NODE)
+		{
+			uint32_t firstLevel, secondLevel;
+			GetSizeClass(size, SECOND_LEVEL_LOG2, firstLevel, secondLevel);
+
+			node = mFreeLists[firstLevel][secondLevel];
+			while (node != INVALID_NODE && Fits(node, size, alignment) == false)
+				node = mNodes[node].NextFree;
+		}
+
+		if (node == INVALID_NODE)
+			return allocation;
+
+		RemoveFree(node);
+
+		// the padding in front becomes a free range of its own, its previous neighbour is used or the free ranges would have merged
+		const uint64_t alignedOffset = (mNodes[node].Offset + alignment - 1) & ~(alignment - 1);
+		const uint64_t padding = alignedOffset - mNodes[node].Offset;
+		if (padding > 0)
+		{
+			const uint32_t paddingNode = CreateNode();
+			mNodes[paddingNode].Offset = mNodes[node].Offset;
+			mNodes[paddingNode].Size = padding;
+			mNodes[paddingNode].PreviousPhysical = mNodes[node].PreviousPhysical;
+			mNodes[paddingNode].NextPhysical = node;
+			if (mNodes[node].PreviousPhysical != INVALID_NODE)
+				mNodes[mNodes[node].PreviousPhysical].NextPhysical = paddingNode;
+
+			mNodes[node].PreviousPhysical = paddingNode;
+			mNodes[node].Offset = alignedOffset;
+			mNodes[node].Size -= padding;
+			InsertFree(paddingNode);
+		}
+
+		// and so does the remainder behind it
+		const uint64_t remainder = mNodes[node].Size - size;
+		if (remainder > 0)
+		{
+			const uint32_t remainderNode = CreateNode();
+			mNodes[remainderNode].Offset = mNodes[node].Offset + size;
+			mNodes[remainderNode].Size = remainder;
+			mNodes[remainderNode].PreviousPhysical = node;
+			mNodes[remainderNode].NextPhysical = mNodes[node].NextPhysical;
+			if (mNodes[node].NextPhysical != INVALID_NODE)
+				mNodes[mNodes[node].NextPhysical].PreviousPhysical = remainderNode;
+
+			mNodes[node].NextPhysical = remainderNode;
+			mNodes[node].Size = size;
+			InsertFree(remainderNode);
+		}
+
+		mUsedSize += size;
+		++mAllocationCount;
+
+		allocation.Offset = mNodes[node].Offset;
+		allocation.Size = size;
+		allocation.Node = node;
+		return allocation;
+	}
+
+	void TlsfAllocator::Free(const Allocation& allocation)
+	{
+		uint32_t node = allocation.Node;
+		Debug_Assert(node < mNodes.size() && mNodes[node].Free == false && mNodes[node].Offset == allocation.Offset);
+
+		mUsedSize -= mNodes[node].Size;
+		--mAllocationCount;
+
+		// merge with the free neighbours
+		const uint32_t previous = mNodes[node].PreviousPhysical;
+		if (previous != INVALID_NODE && mNodes[previous].Free)
+		{
+			RemoveFree(previous);
+			mNodes[previous].Size += mNodes[node].Size;
+			mNodes[previous].NextPhysical = mNodes[node].NextPhysical;
+			if (mNodes[node].NextPhysical != INVALID_NODE)
+				mNodes[mNodes[node].NextPhysical].PreviousPhysical = previous;
+
+			ReleaseNode(node);
+			node = previous;
+		}
+
+		const uint32_t next = mNodes[node].NextPhysical;
+		if (next != INVALID_NODE && mNodes[next].Free)
+		{
+			RemoveFree(next);
+			mNodes[node].Size += mNodes[next].Size;
+			mNodes[node].NextPhysical = mNodes[next].NextPhysical;
+			if (mNodes[next].NextPhysical != INVALID_NODE)
+				mNodes[mNodes[next].NextPhysical].PreviousPhysical = node;
+
+			ReleaseNode(next);
+		}
+
+		InsertFree(node);
+	}
+
+	TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const
+	{
+		Statistics statistics;
+		statistics.Size = mSize;
+		statistics.UsedSize = mUsedSize;
+		statistics.FreeSize = mSize - mUsedSize;
+		statistics.AllocationCount = mAllocationCount;
+		statistics.FreeRangeCount = mFreeRangeCount;
+
+		// the largest free range is in the highest non-empty class
+		if (mFirstLevelBitmap != 0)
+		{
+			const uint32_t firstLevel = FindLastSet(mFirstLevelBitmap);
+			const uint32_t secondLevel = FindLastSet(mSecondLevelBitmaps[firstLevel]);
+			for (uint32_t node = mFreeLists[firstLevel][secondLevel]; node != INVALID_NODE; node = mNodes[node].NextFree)
+			{
+				if (mNodes[node].Size > statistics.LargestFreeRange)
+					statistics.LargestFreeRange = mNodes[node].Size;
+			}
+		}
+
+		return statistics;
+	}
+
+	bool TlsfAllocator::Fits(uint32_t node, uint64_t size, uint64_t alignment) const
+	{
+		const uint64_t alignedOffset = (mNodes[node].Offset + alignment - 1) & ~(alignment - 1);
+		return alignedOffset + size <= mNodes[node].Offset + mNodes[node].Size;
+	}
+
+	uint32_t TlsfAllocator::CreateNode()
+	{
+		if (mUnusedNodes.empty() == false)
+		{
+			const uint32_t node = mUnusedNodes.back();
+			mUnusedNodes.pop_back();
+			mNodes[node] = Node();
+			return node;
+		}
+
+		mNodes.emplace_back();
+		return static_cast<uint32_t>(mNodes.size() - 1);
+	}
+
+	void TlsfAllocator::ReleaseNode(uint32_t node)
+	{
+		mNodes[node] = Node();
+		mUnusedNodes.push_back(node);
+	}
+
+	void TlsfAllocator::InsertFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		GetSizeClass(mNodes[node].Size, SECOND_LEVEL_LOG2, firstLevel, secondLevel);
+
+		const uint32_t head = mFreeLists[firstLevel][secondLevel];
+		mNodes[node].Free = true;
+		mNodes[node].PreviousFree = INVALID_NODE;
+		mNodes[node].NextFree = head;
+		if (head != INVALID_NODE)
+			mNodes[head].PreviousFree = node;
+
+		mFreeLists[firstLevel][secondLevel] = node;
+		mFirstLevelBitmap |= 1ull << firstLevel;
+		mSecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+		++mFreeRangeCount;
+	}
+
+	void TlsfAllocator::RemoveFree(uint32_t node)
+	{
+		uint32_t firstLevel, secondLevel;
+		GetSizeClass(mNodes[node].Size, SECOND_LEVEL_LOG2, firstLevel, secondLevel);
+
+		const uint32_t previous = mNodes[node].PreviousFree;
+		const uint32_t next = mNodes[node].NextFree;
+		if (previous != INVALID_NODE)
+			mNodes[previous].NextFree = next;
+		else
+			mFreeLists[firstLevel][secondLevel] = next;
+
+		if (next != INVALID_NODE)
+			mNodes[next].PreviousFree = previous;
+
+		if (mFreeLists[firstLevel][secondLevel] == INVALID_NODE)
+		{
+			mSecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (mSecondLevelBitmaps[firstLevel] == 0)
+				mFirstLevelBitmap &= ~(1ull << firstLevel);
+		}
+
+		mNodes[node].Free = false;
+		mNodes[node].PreviousFree = INVALID_NODE;
+		mNodes[node].NextFree = INVALID_NODE;
+		--mFreeRangeCount;
+	}
+
+	// Head of the first non-empty class whose every range is at least size
+	uint32_t TlsfAllocator::FindFree(uint64_t size) const
+	{
+		// round up to the next class boundary, so a range of the class found is never too small
+		if (size >= (1ull << SECOND_LEVEL_LOG2))
+		{
+			const uint64_t roundUp = (1ull << (FindLastSet(size) - SECOND_LEVEL_LOG2)) - 1;
+			if (size + roundUp < size)
+				return INVALID_NODE;
+
+			size += roundUp;
+		}
+
+		uint32_t firstLevel, secondLevel;
+		GetSizeClass(size, SECOND_LEVEL_LOG2, firstLevel, secondLevel);
+
+		uint32_t secondLevelMap = mSecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+		if (secondLevelMap == 0)
+		{
+			// nothing in this power of two, take the smallest class of the next non-empty one
+			const uint64_t firstLevelMap = (firstLevel + 1 < 64) ? mFirstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+			if (firstLevelMap == 0)
+				return INVALID_NODE;
+
+			firstLevel = FindFirstSet(firstLevelMap);
+			secondLevelMap = mSecondLevelBitmaps[firstLevel];
+		}
+
+		secondLevel = FindFirstSet(secondLevelMap);
+		return mFreeLists[firstLevel][secondLevel];
+	}
+} // namespace W
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace W
+{
+	// Two level segregated fit allocator over the range [0, size). It only hands out offsets, the memory itself
+	// lives elsewhere (a VkDeviceMemory block, a buffer), so it can manage memory the CPU can not touch.
+	// Allocate and Free are O(1), free ranges are merged with their neighbours as soon as they are freed.
+	class TlsfAllocator
+	{
+	public:
+		static const uint32_t INVALID_NODE = UINT32_MAX;
+
+		struct Allocation
+		{
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			uint32_t Node = INVALID_NODE;	// handle for Free
+
+			bool IsValid() const { return Node != INVALID_NODE; }
+		};
+
+		struct Statistics
+		{
+			uint64_t Size = 0;
+			uint64_t UsedSize = 0;
+			uint64_t FreeSize = 0;
+			uint64_t LargestFreeRange = 0;
+			uint32_t AllocationCount = 0;
+			uint32_t FreeRangeCount = 0;
+		};
+
+	private:
+		static const uint32_t SECOND_LEVEL_LOG2 = 5;
+		static const uint32_t SECOND_LEVEL_COUNT = 1u << SECOND_LEVEL_LOG2;
+		static const uint32_t FIRST_LEVEL_COUNT = 64 - SECOND_LEVEL_LOG2 + 1;
+
+		// A used or free range, physically linked to its neighbours and free ranges to the others of their size class
+		struct Node
+		{
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			uint32_t PreviousPhysical = INVALID_NODE;
+			uint32_t NextPhysical = INVALID_NODE;
+			uint32_t PreviousFree = INVALID_NODE;
+			uint32_t NextFree = INVALID_NODE;
+			bool Free = false;
+		};
+
+		uint64_t mSize = 0;
+		uint64_t mUsedSize = 0;
+		uint32_t mAllocationCount = 0;
+		uint32_t mFreeRangeCount = 0;
+
+		std::vector<Node> mNodes;
+		std::vector<uint32_t> mUnusedNodes;
+
+		uint64_t mFirstLevelBitmap = 0;
+		uint32_t mSecondLevelBitmaps[FIRST_LEVEL_COUNT] = {};
+		uint32_t mFreeLists[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+	public:
+		explicit TlsfAllocator(uint64_t size);
+
+	public:
+		// alignment has to be a power of two. Returns an invalid allocation when no free range fits.
+		Allocation Allocate(uint64_t size, uint64_t alignment);
+		void Free(const Allocation& allocation);
+
+		uint64_t GetSize() const { return mSize; }
+		uint64_t GetUsedSize() const { return mUsedSize; }
+		uint32_t GetAllocationCount() const { return mAllocationCount; }
+		bool IsEmpty() const { return mAllocationCount == 0; }
+
+		Statistics GetStatistics() const;
+
+	private:
+		uint32_t CreateNode();
+		void ReleaseNode(uint32_t node);
+
+		void InsertFree(uint32_t node);
+		void RemoveFree(uint32_t node);
+		uint32_t FindFree(uint64_t size) const;
+		bool Fits(uint32_t node, uint64_t size, uint64_t alignment) const;
+	};
+} // namespace W
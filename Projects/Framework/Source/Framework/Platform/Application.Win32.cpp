@@ -2,7 +2,6 @@
 
 #include <Framework/Debug/Debug.hpp>
 #include <Framework/Graphics/Graphics.hpp>
-#include <Framework/Graphics/ShaderCompiler.hpp>
 
 // C++ Standard Library
 #include <chrono>
@@ -81,10 +80,6 @@ namespace W
 		// startup graphics engine
 		Graphics::Startup();
 
-		// build shaders
-		ShaderCompiler::Compile_SPIRV_GLSLC();
-		ShaderCompiler::Compile_SPIRV_DXC();
-
 		// application startup
 		if (mStartupCallback != nullptr)
 		{
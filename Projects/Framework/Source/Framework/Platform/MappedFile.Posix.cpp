@@ -0,0 +1,80 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace W
+{
+	struct MappedFile::PlatformImpl
+	{
+		int mFile = -1;
+		void* mView = nullptr;
+		size_t mSize = 0;
+
+		PlatformImpl() = default;
+		~PlatformImpl() { Close(); }
+
+		void Close()
+		{
+			if (mView != nullptr)
+			{
+				munmap(mView, mSize);
+				mView = nullptr;
+				mSize = 0;
+			}
+
+			if (mFile != -1)
+			{
+				close(mFile);
+				mFile = -1;
+			}
+		}
+	};
+
+	MappedFile::MappedFile()
+	{
+		mImpl = std::make_unique<PlatformImpl>();
+	}
+
+	MappedFile::~MappedFile() = default;
+
+	bool MappedFile::Open(const char* filePath)
+	{
+		Close();
+
+		mImpl->mFile = open(filePath, O_RDONLY);
+		if (mImpl->mFile == -1)
+			return false;
+
+		struct stat fileStatus = {};
+		if (fstat(mImpl->mFile, &fileStatus) != 0 || fileStatus.st_size == 0)
+		{
+			Close();
+			return false;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, mImpl->mFile, 0);
+		if (view == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+
+		mImpl->mView = view;
+		mImpl->mSize = static_cast<size_t>(fileStatus.st_size);
+
+		mData = static_cast<const uint8_t*>(view);
+		mSize = mImpl->mSize;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		mImpl->Close();
+
+		mData = nullptr;
+		mSize = 0;
+	}
+} // namespace W
@@ -0,0 +1,93 @@
+#include "MappedFile.hpp"
+
+#include <Framework/Text/Text.hpp>
+
+#include <windows.h>
+
+namespace W
+{
+	struct MappedFile::PlatformImpl
+	{
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = NULL;
+		LPVOID mView = nullptr;
+
+		PlatformImpl() = default;
+		~PlatformImpl() { Close(); }
+
+		void Close()
+		{
+			if (mView != nullptr)
+			{
+				UnmapViewOfFile(mView);
+				mView = nullptr;
+			}
+
+			if (mMapping != NULL)
+			{
+				CloseHandle(mMapping);
+				mMapping = NULL;
+			}
+
+			if (mFile != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(mFile);
+				mFile = INVALID_HANDLE_VALUE;
+			}
+		}
+	};
+
+	MappedFile::MappedFile()
+	{
+		mImpl = std::make_unique<PlatformImpl>();
+	}
+
+	MappedFile::~MappedFile() = default;
+
+	bool MappedFile::Open(const char* filePath)
+	{
+		Close();
+
+		// convert to wide character path
+		wchar_t wchar_file_path[MAX_PATH];
+		Text::UTF8::Decode(filePath, wchar_file_path);
+
+		mImpl->mFile = CreateFileW(wchar_file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (mImpl->mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size = {};
+		if (GetFileSizeEx(mImpl->mFile, &file_size) == 0 || file_size.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		// The mapping spans the whole file, both size arguments of zero mean "use the file size"
+		mImpl->mMapping = CreateFileMappingW(mImpl->mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mImpl->mMapping == NULL)
+		{
+			Close();
+			return false;
+		}
+
+		mImpl->mView = MapViewOfFile(mImpl->mMapping, FILE_MAP_READ, 0, 0, 0);
+		if (mImpl->mView == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		mData = static_cast<const uint8_t*>(mImpl->mView);
+		mSize = static_cast<size_t>(file_size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		mImpl->Close();
+
+		mData = nullptr;
+		mSize = 0;
+	}
+} // namespace W
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace W
+{
+	// Read-only view of a whole file mapped into the address space
+	class MappedFile
+	{
+	private:
+		struct PlatformImpl;
+		std::unique_ptr<PlatformImpl> mImpl;
+
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+	public:
+		bool Open(const char* filePath);
+		void Close();
+
+		bool IsOpen() const { return mData != nullptr; }
+
+		const uint8_t* Data() const { return mData; }
+		size_t Size() const { return mSize; }
+	};
+} // namespace W
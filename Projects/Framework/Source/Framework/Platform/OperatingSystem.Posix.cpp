@@ -0,0 +1,55 @@
+#include "OperatingSystem.hpp"
+
+#include <Framework/Debug/Debug.hpp>
+
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+namespace W
+{
+	const char* OS::GetEnvironmentVariable(const char* variableName)
+	{
+		return getenv(variableName);
+	}
+
+	void OS::CreateDirectory(const char* path)
+	{
+		int result = mkdir(path, 0755);
+		Debug_AssertMsg(result == 0 || errno != ENOENT, "CreateDirectory - One or more intermediate directories do not exist; this function will only create the final directory in the path.");
+	}
+
+	void OS::ListFiles(const char* directory, std::vector<std::string>& filePaths)
+	{
+		DIR* directoryHandle = opendir(directory);
+		if (directoryHandle == nullptr)
+			return;
+
+		while (dirent* entry = readdir(directoryHandle))
+		{
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+				continue;
+
+			const std::string filePath = std::string(directory) + "/" + entry->d_name;
+
+			struct stat fileStatus = {};
+			if (stat(filePath.c_str(), &fileStatus) != 0)
+				continue;
+
+			if (S_ISDIR(fileStatus.st_mode))
+			{
+				ListFiles(filePath.c_str(), filePaths);
+			}
+			else if (S_ISREG(fileStatus.st_mode))
+			{
+				filePaths.push_back(filePath);
+			}
+		}
+
+		closedir(directoryHandle);
+	}
+} // namespace W
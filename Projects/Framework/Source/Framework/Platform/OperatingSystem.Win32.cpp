@@ -5,6 +5,7 @@
 #include <Framework/Debug/Debug.hpp>
 
 #include <string>
+#include <string.h>
 
 #include <windows.h>
 #undef GetEnvironmentVariable
@@ -22,4 +23,32 @@ namespace W
 		BOOL result = CreateDirectoryA(path, NULL);
 		Debug_AssertMsg(result != ERROR_PATH_NOT_FOUND, "CreateDirectory - One or more intermediate directories do not exist; this function will only create the final directory in the path.");
 	}
+
+	void OS::ListFiles(const char* directory, std::vector<std::string>& filePaths)
+	{
+		const std::string searchPath = std::string(directory) + "/*";
+
+		WIN32_FIND_DATAA findData = {};
+		HANDLE findHandle = FindFirstFileA(searchPath.c_str(), &findData);
+		if (findHandle == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0)
+				continue;
+
+			const std::string filePath = std::string(directory) + "/" + findData.cFileName;
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				ListFiles(filePath.c_str(), filePaths);
+			}
+			else
+			{
+				filePaths.push_back(filePath);
+			}
+		} while (FindNextFileA(findHandle, &findData));
+
+		FindClose(findHandle);
+	}
 } // namespace W
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace W
 {
@@ -11,5 +12,8 @@ namespace W
         const char* GetEnvironmentVariable(const char* variableName);
 
         void CreateDirectory(const char* path);
+
+        // Appends the path of every file under directory and its sub-directories, starting with directory and separated by '/'
+        void ListFiles(const char* directory, std::vector<std::string>& filePaths);
     } // namespace OS
 } // namespace W
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "Process.hpp"
+
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace W
+{
+	struct Process::PlatformImpl
+	{
+		pid_t mProcessId = -1;
+		int mStdOutRead = -1;
+		int mExitStatus = 0;
+		bool mExited = false;
+
+		// the pipe is drained while waiting so a child writing more than the pipe holds does not block forever
+		std::string mPendingOutput;
+
+		PlatformImpl() = default;
+		~PlatformImpl() { Close(); }
+
+		void DrainOutput()
+		{
+			char buffer[4096];
+			ssize_t bytesRead = 0;
+			while (mStdOutRead != -1 && (bytesRead = read(mStdOutRead, buffer, sizeof(buffer))) > 0)
+			{
+				mPendingOutput.append(buffer, static_cast<size_t>(bytesRead));
+			}
+		}
+
+		void Wait()
+		{
+			if (mProcessId == -1 || mExited)
+				return;
+
+			DrainOutput();
+
+			int status = 0;
+			if (waitpid(mProcessId, &status, 0) == mProcessId)
+			{
+				mExitStatus = status;
+				mExited = true;
+			}
+		}
+
+		void Close()
+		{
+			Wait();
+
+			if (mStdOutRead != -1)
+			{
+				close(mStdOutRead);
+				mStdOutRead = -1;
+			}
+
+			mProcessId = -1;
+			mExitStatus = 0;
+			mExited = false;
+			mPendingOutput.clear();
+		}
+	};
+
+	Process::Process()
+	{
+		mImpl = std::make_unique<PlatformImpl>();
+	}
+
+	Process::~Process() = default;
+
+	void Process::Start(const char* commandLine)
+	{
+		Close();
+
+		// Create a pipe for the child process's STDOUT and STDERR.
+		int pipeHandles[2] = { -1, -1 };
+		int error = pipe(pipeHandles);
+		Debug_Assert(error == 0);
+
+		pid_t processId = fork();
+		Debug_AssertMsg(processId != -1, "fork failed");
+
+		if (processId == 0)
+		{
+			// child, the command line goes through the shell like it does through CreateProcess on Windows
+			dup2(pipeHandles[1], STDOUT_FILENO);
+			dup2(pipeHandles[1], STDERR_FILENO);
+			close(pipeHandles[0]);
+			close(pipeHandles[1]);
+
+			execl("/bin/sh", "sh", "-c", commandLine, static_cast<char*>(nullptr));
+			_exit(127);
+		}
+
+		close(pipeHandles[1]);
+		mImpl->mProcessId = processId;
+		mImpl->mStdOutRead = pipeHandles[0];
+	}
+
+	bool Process::IsRunning() const
+	{
+		if (mImpl->mProcessId == -1 || mImpl->mExited)
+			return false;
+
+		int status = 0;
+		if (waitpid(mImpl->mProcessId, &status, WNOHANG) == mImpl->mProcessId)
+		{
+			mImpl->mExitStatus = status;
+			mImpl->mExited = true;
+			return false;
+		}
+		return true;
+	}
+
+	void Process::WaitForExit() const
+	{
+		mImpl->Wait();
+	}
+
+	uint32_t Process::GetExitCode() const
+	{
+		Debug_AssertMsg(mImpl->mExited, "GetExitCode - the process is still running");
+
+		if (WIFEXITED(mImpl->mExitStatus))
+			return static_cast<uint32_t>(WEXITSTATUS(mImpl->mExitStatus));
+
+		// killed by a signal
+		return 128 + static_cast<uint32_t>(WTERMSIG(mImpl->mExitStatus));
+	}
+
+	const char* Process::GetOutputText() const
+	{
+		return mOutput.c_str();
+	}
+
+	void Process::ReadOutput()
+	{
+		mImpl->DrainOutput();
+
+		mOutput += mImpl->mPendingOutput;
+		mImpl->mPendingOutput.clear();
+	}
+
+	void Process::Close()
+	{
+		mImpl->Close();
+		mOutput.clear();
+	}
+} // namespace W
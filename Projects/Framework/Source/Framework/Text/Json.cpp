@@ -0,0 +1,382 @@
+#include "Json.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace W
+{
+	static const JsonValue s_NullValue;
+
+	// Nesting deeper than this is rejected instead of running out of stack
+	static const int MAX_DEPTH = 256;
+
+	//////////////////////////////////////////////////////////////////////////
+	//                              JsonValue                               //
+	//////////////////////////////////////////////////////////////////////////
+	size_t JsonValue::Size() const
+	{
+		if (mType == Type::Array)
+			return mElements.size();
+		if (mType == Type::Object)
+			return mMembers.size();
+		return 0;
+	}
+
+	const JsonValue& JsonValue::operator[](size_t index) const
+	{
+		if (mType != Type::Array || index >= mElements.size())
+			return s_NullValue;
+
+		return mElements[index];
+	}
+
+	const JsonValue& JsonValue::operator[](const char* key) const
+	{
+		if (mType != Type::Object)
+			return s_NullValue;
+
+		// glTF objects have a handful of members, a linear scan beats building a map
+		for (const std::pair<std::string, JsonValue>& member : mMembers)
+		{
+			if (member.first == key)
+				return member.second;
+		}
+		return s_NullValue;
+	}
+
+	bool JsonValue::HasMember(const char* key) const
+	{
+		return &(*this)[key] != &s_NullValue;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//                              JsonParser                              //
+	//////////////////////////////////////////////////////////////////////////
+	class JsonParser
+	{
+	private:
+		const char* mText;
+		const char* mEnd;
+		const char* mCursor;
+
+	public:
+		JsonParser(const char* text, size_t length)
+			: mText(text), mEnd(text + length), mCursor(text)
+		{
+		}
+
+		size_t GetOffset() const { return static_cast<size_t>(mCursor - mText); }
+
+		bool ParseDocument(JsonValue& result)
+		{
+			SkipWhitespace();
+			if (ParseValue(result, 0) == false)
+				return false;
+
+			SkipWhitespace();
+			return mCursor == mEnd;
+		}
+
+	private:
+		void SkipWhitespace()
+		{
+			while (mCursor < mEnd && (*mCursor == ' ' || *mCursor == '\t' || *mCursor == '\n' || *mCursor == '\r'))
+				++mCursor;
+		}
+
+		bool Consume(char c)
+		{
+			if (mCursor < mEnd && *mCursor == c)
+			{
+				++mCursor;
+				return true;
+			}
+			return false;
+		}
+
+		bool ConsumeLiteral(const char* literal)
+		{
+			const size_t length = strlen(literal);
+			if (static_cast<size_t>(mEnd - mCursor) < length || memcmp(mCursor, literal, length) != 0)
+				return false;
+
+			mCursor += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value, int depth)
+		{
+			if (mCursor >= mEnd || depth > MAX_DEPTH)
+				return false;
+
+			switch (*mCursor)
+			{
+			case '{': return ParseObject(value, depth);
+			case '[': return ParseArray(value, depth);
+			case '"':
+				value.mType = JsonValue::Type::String;
+				return ParseString(value.mString);
+			case 't':
+				value.mType = JsonValue::Type::Bool;
+				value.mBool = true;
+				return ConsumeLiteral("true");
+			case 'f':
+				value.mType = JsonValue::Type::Bool;
+				value.mBool = false;
+				return ConsumeLiteral("false");
+			case 'n':
+				value.mType = JsonValue::Type::Null;
+				return ConsumeLiteral("null");
+			default:
+				return ParseNumber(value);
+			}
+		}
+
+		bool ParseObject(JsonValue& value, int depth)
+		{
+			value.mType = JsonValue::Type::Object;
+			++mCursor; // {
+
+			SkipWhitespace();
+			if (Consume('}'))
+				return true;
+
+			for (;;)
+			{
+				SkipWhitespace();
+				value.mMembers.emplace_back();
+				std::pair<std::string, JsonValue>& member = value.mMembers.back();
+				if (mCursor >= mEnd || *mCursor != '"' || ParseString(member.first) == false)
+					return false;
+
+				SkipWhitespace();
+				if (Consume(':') == false)
+					return false;
+
+				SkipWhitespace();
+				if (ParseValue(member.second, depth + 1) == false)
+					return false;
+
+				SkipWhitespace();
+				if (Consume('}'))
+					return true;
+				if (Consume(',') == false)
+					return false;
+			}
+		}
+
+		bool ParseArray(JsonValue& value, int depth)
+		{
+			value.mType = JsonValue::Type::Array;
+			++mCursor; // [
+
+			SkipWhitespace();
+			if (Consume(']'))
+				return true;
+
+			for (;;)
+			{
+				SkipWhitespace();
+				value.mElements.emplace_back();
+				if (ParseValue(value.mElements.back(), depth + 1) == false)
+					return false;
+
+				SkipWhitespace();
+				if (Consume(']'))
+					return true;
+				if (Consume(',') == false)
+					return false;
+			}
+		}
+
+		bool ParseNumber(JsonValue& value)
+		{
+			// validate the JSON grammar, strtod alone also takes hex, inf and leading '+'
+			const char* start = mCursor;
+			const char* cursor = mCursor;
+
+			if (cursor < mEnd && *cursor == '-')
+				++cursor;
+
+			if (cursor < mEnd && *cursor == '0')
+			{
+				++cursor;
+			}
+			else
+			{
+				if (cursor >= mEnd || *cursor < '1' || *cursor > '9')
+					return false;
+				while (cursor < mEnd && *cursor >= '0' && *cursor <= '9')
+					++cursor;
+			}
+
+			if (cursor < mEnd && *cursor == '.')
+			{
+				++cursor;
+				if (cursor >= mEnd || *cursor < '0' || *cursor > '9')
+					return false;
+				while (cursor < mEnd && *cursor >= '0' && *cursor <= '9')
+					++cursor;
+			}
+
+			if (cursor < mEnd && (*cursor == 'e' || *cursor == 'E'))
+			{
+				++cursor;
+				if (cursor < mEnd && (*cursor == '+' || *cursor == '-'))
+					++cursor;
+				if (cursor >= mEnd || *cursor < '0' || *cursor > '9')
+					return false;
+				while (cursor < mEnd && *cursor >= '0' && *cursor <= '9')
+					++cursor;
+			}
+
+			// the text is not null terminated, numbers are short so copy them out
+			char buffer[64];
+			const size_t length = static_cast<size_t>(cursor - start);
+			if (length >= sizeof(buffer))
+				return false;
+
+			memcpy(buffer, start, length);
+			buffer[length] = '\0';
+
+			value.mType = JsonValue::Type::Number;
+			value.mNumber = strtod(buffer, nullptr);
+			mCursor = cursor;
+			return true;
+		}
+
+		static int HexDigit(char c)
+		{
+			if (c >= '0' && c <= '9') return c - '0';
+			if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+
+		bool ParseHex4(uint32_t& codeUnit)
+		{
+			if (mEnd - mCursor < 4)
+				return false;
+
+			codeUnit = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				const int digit = HexDigit(*mCursor++);
+				if (digit < 0)
+					return false;
+				codeUnit = (codeUnit << 4) | static_cast<uint32_t>(digit);
+			}
+			return true;
+		}
+
+		static void AppendUTF8(uint32_t codePoint, std::string& text)
+		{
+			if (codePoint < 0x80)
+			{
+				text.push_back(static_cast<char>(codePoint));
+			}
+			else if (codePoint < 0x800)
+			{
+				text.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+				text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+			else if (codePoint < 0x10000)
+			{
+				text.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+				text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+				text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+			else
+			{
+				text.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+				text.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+				text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+				text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+		}
+
+		bool ParseString(std::string& text)
+		{
+			++mCursor; // "
+
+			for (;;)
+			{
+				// copy the run up to the next quote or escape in one go
+				const char* runStart = mCursor;
+				while (mCursor < mEnd && *mCursor != '"' && *mCursor != '\\')
+				{
+					if (static_cast<unsigned char>(*mCursor) < 0x20)
+						return false;
+					++mCursor;
+				}
+				text.append(runStart, mCursor);
+
+				if (mCursor >= mEnd)
+					return false;
+
+				if (*mCursor++ == '"')
+					return true;
+
+				if (mCursor >= mEnd)
+					return false;
+
+				switch (*mCursor++)
+				{
+				case '"': text.push_back('"'); break;
+				case '\\': text.push_back('\\'); break;
+				case '/': text.push_back('/'); break;
+				case 'b': text.push_back('\b'); break;
+				case 'f': text.push_back('\f'); break;
+				case 'n': text.push_back('\n'); break;
+				case 'r': text.push_back('\r'); break;
+				case 't': text.push_back('\t'); break;
+				case 'u':
+				{
+					uint32_t codePoint = 0;
+					if (ParseHex4(codePoint) == false)
+						return false;
+
+					// surrogate pair
+					if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+					{
+						uint32_t lowSurrogate = 0;
+						if (Consume('\\') == false || Consume('u') == false || ParseHex4(lowSurrogate) == false)
+							return false;
+						if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF)
+							return false;
+
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+					}
+					else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+					{
+						return false;
+					}
+
+					AppendUTF8(codePoint, text);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	//                                 Json                                 //
+	//////////////////////////////////////////////////////////////////////////
+	bool Json::Parse(const char* text, size_t length, JsonValue& result, size_t* errorOffset)
+	{
+		result = JsonValue();
+
+		JsonParser parser(text, length);
+		if (parser.ParseDocument(result))
+			return true;
+
+		if (errorOffset != nullptr)
+			*errorOffset = parser.GetOffset();
+
+		result = JsonValue();
+		return false;
+	}
+} // namespace W
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace W
+{
+	// Read-only JSON DOM. Lookups never fail, a missing member or an out of range element is a Null value,
+	// so optional fields read as value["key"].AsNumber(defaultValue).
+	class JsonValue
+	{
+	public:
+		enum class Type : uint8_t
+		{
+			Null,
+			Bool,
+			Number,
+			String,
+			Array,
+			Object,
+		};
+
+	private:
+		Type mType = Type::Null;
+		bool mBool = false;
+		double mNumber = 0.0;
+		std::string mString;
+		std::vector<JsonValue> mElements;
+		std::vector<std::pair<std::string, JsonValue>> mMembers;
+
+		friend class JsonParser;
+
+	public:
+		Type GetType() const { return mType; }
+		bool IsNull() const { return mType == Type::Null; }
+		bool IsNumber() const { return mType == Type::Number; }
+		bool IsString() const { return mType == Type::String; }
+		bool IsArray() const { return mType == Type::Array; }
+		bool IsObject() const { return mType == Type::Object; }
+
+		bool AsBool(bool defaultValue = false) const { return (mType == Type::Bool) ? mBool : defaultValue; }
+		double AsNumber(double defaultValue = 0.0) const { return (mType == Type::Number) ? mNumber : defaultValue; }
+		float AsFloat(float defaultValue = 0.0f) const { return (mType == Type::Number) ? static_cast<float>(mNumber) : defaultValue; }
+		int64_t AsInt(int64_t defaultValue = 0) const { return (mType == Type::Number) ? static_cast<int64_t>(mNumber) : defaultValue; }
+		const char* AsString(const char* defaultValue = "") const { return (mType == Type::String) ? mString.c_str() : defaultValue; }
+
+		// Element count of an array, member count of an object, 0 otherwise
+		size_t Size() const;
+
+		const JsonValue& operator[](size_t index) const;
+		const JsonValue& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }	// a literal 0 would be ambiguous with the key
+		const JsonValue& operator[](const char* key) const;
+		bool HasMember(const char* key) const;
+
+		// Members of an object in document order
+		const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return mMembers; }
+	};
+
+	namespace Json
+	{
+		// Parses UTF-8 JSON text (RFC 8259). On failure returns false and errorOffset is the byte the parser stopped at.
+		bool Parse(const char* text, size_t length, JsonValue& result, size_t* errorOffset = nullptr);
+	} // namespace Json
+} // namespace W
@@ -0,0 +1,77 @@
+#include <Framework/Text/Text.hpp>
+#include <Framework/Debug/Debug.hpp>
+
+#include <stdint.h>
+
+namespace W
+{
+    // wchar_t holds a whole code point here (UTF-32), not UTF-16 like on Windows
+
+    // Convert a wide Unicode string to an UTF8 string
+    void Text::UTF8::Encode(const wchar_t* str, char* outBuffer, int outBufferSize)
+    {
+        int length = 0;
+        for (; *str != L'\0'; ++str)
+        {
+            const uint32_t codePoint = static_cast<uint32_t>(*str);
+
+            char bytes[4];
+            int byteCount = 0;
+            if (codePoint < 0x80)
+            {
+                bytes[byteCount++] = static_cast<char>(codePoint);
+            }
+            else if (codePoint < 0x800)
+            {
+                bytes[byteCount++] = static_cast<char>(0xC0 | (codePoint >> 6));
+                bytes[byteCount++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                bytes[byteCount++] = static_cast<char>(0xE0 | (codePoint >> 12));
+                bytes[byteCount++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes[byteCount++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                bytes[byteCount++] = static_cast<char>(0xF0 | (codePoint >> 18));
+                bytes[byteCount++] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                bytes[byteCount++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                bytes[byteCount++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+
+            Debug_Assert(length + byteCount < outBufferSize);
+            for (int i = 0; i < byteCount; ++i)
+            {
+                outBuffer[length++] = bytes[i];
+            }
+        }
+        outBuffer[length] = '\0';
+    }
+
+    // Convert an UTF8 string to a wide Unicode string
+    void Text::UTF8::Decode(const char* str, wchar_t* outBuffer, int outBufferSize)
+    {
+        const unsigned char* text = reinterpret_cast<const unsigned char*>(str);
+
+        int length = 0;
+        while (*text != '\0')
+        {
+            uint32_t codePoint = *text++;
+
+            int continuationCount = 0;
+            if (codePoint >= 0xF0)      { codePoint &= 0x07; continuationCount = 3; }
+            else if (codePoint >= 0xE0) { codePoint &= 0x0F; continuationCount = 2; }
+            else if (codePoint >= 0xC0) { codePoint &= 0x1F; continuationCount = 1; }
+
+            for (int i = 0; i < continuationCount && (*text & 0xC0) == 0x80; ++i)
+            {
+                codePoint = (codePoint << 6) | (*text++ & 0x3F);
+            }
+
+            Debug_Assert(length + 1 < outBufferSize);
+            outBuffer[length++] = static_cast<wchar_t>(codePoint);
+        }
+        outBuffer[length] = L'\0';
+    }
+} // namespace W
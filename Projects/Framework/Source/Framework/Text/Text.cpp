@@ -34,6 +34,10 @@ namespace W
 
 	void Text::Format(char* outBuffer, int outBufferSize, const char* format, va_list args)
 	{
+#if defined(_MSC_VER)
 		vsprintf_s(outBuffer, outBufferSize, format, args);
+#else
+		vsnprintf(outBuffer, outBufferSize, format, args);
+#endif
 	}
 } // namespace W
\ No newline at end of file
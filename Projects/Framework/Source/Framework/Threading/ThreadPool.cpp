@@ -0,0 +1,131 @@
+#include "ThreadPool.hpp"
+
+#include <Framework/Debug/Debug.hpp>
+
+namespace W
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			const uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+			threadCount = (hardwareThreadCount > 1) ? hardwareThreadCount - 1 : 1;
+		}
+
+		mThreads.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			mThreads.emplace_back(&ThreadPool::WorkerMain, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mTaskAvailable.notify_all();
+
+		for (std::thread& thread : mThreads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			Debug_Assert(mStopping == false);
+
+			mTasks.push_back(std::move(task));
+		}
+		mTaskAvailable.notify_one();
+	}
+
+	void ThreadPool::WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mTaskFinished.wait(lock, [this]() { return mTasks.empty() && mActiveTaskCount == 0; });
+	}
+
+	void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& function)
+	{
+		if (count == 0)
+			return;
+
+		// every participant pulls the next index, so uneven work balances itself. The state is shared with the helpers
+		// because a helper queued behind other tasks may only start after the loop is done, it then finds no index left.
+		struct ParallelForState
+		{
+			std::atomic<size_t> NextIndex{ 0 };
+			std::mutex Mutex;
+			std::condition_variable Done;
+			size_t FinishedCount = 0;
+		};
+
+		std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+
+		auto runIndices = [&function, count](ParallelForState& loopState)
+		{
+			size_t finishedCount = 0;
+			for (size_t index = loopState.NextIndex.fetch_add(1); index < count; index = loopState.NextIndex.fetch_add(1))
+			{
+				function(index);
+				finishedCount += 1;
+			}
+
+			if (finishedCount > 0)
+			{
+				std::lock_guard<std::mutex> lock(loopState.Mutex);
+				loopState.FinishedCount += finishedCount;
+				if (loopState.FinishedCount == count)
+				{
+					loopState.Done.notify_one();
+				}
+			}
+		};
+
+		const size_t helperCount = (count - 1 < mThreads.size()) ? count - 1 : mThreads.size();
+		for (size_t i = 0; i < helperCount; ++i)
+		{
+			Submit([state, runIndices]()
+			{
+				runIndices(*state);
+			});
+		}
+
+		runIndices(*state);
+
+		std::unique_lock<std::mutex> lock(state->Mutex);
+		state->Done.wait(lock, [&state, count]() { return state->FinishedCount == count; });
+	}
+
+	void ThreadPool::WorkerMain()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mTaskAvailable.wait(lock, [this]() { return mStopping || mTasks.empty() == false; });
+
+				if (mTasks.empty())
+					return;
+
+				task = std::move(mTasks.front());
+				mTasks.pop_front();
+				mActiveTaskCount += 1;
+			}
+
+			task();
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mActiveTaskCount -= 1;
+			}
+			mTaskFinished.notify_all();
+		}
+	}
+} // namespace W
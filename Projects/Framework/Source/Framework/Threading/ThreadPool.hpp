@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace W
+{
+	// Fixed set of worker threads consuming a FIFO of tasks
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> mThreads;
+
+		std::mutex mMutex;
+		std::condition_variable mTaskAvailable;
+		std::condition_variable mTaskFinished;
+		std::deque<std::function<void()>> mTasks;
+		size_t mActiveTaskCount = 0;
+		bool mStopping = false;
+
+	public:
+		// threadCount 0 uses one worker per hardware thread, minus the calling thread
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+	public:
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(mThreads.size()); }
+
+		void Submit(std::function<void()> task);
+
+		// Blocks until every submitted task has finished
+		void WaitIdle();
+
+		// Calls function(index) for every index in [0, count), the calling thread takes part and returns once all of them are done.
+		// Tasks submitted earlier do not hold it up, the calling thread works through the indices the workers cannot get to.
+		// Safe to call from inside a pool task, the task runs the indices itself when every worker is busy.
+		void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+	private:
+		void WorkerMain();
+	};
+} // namespace W
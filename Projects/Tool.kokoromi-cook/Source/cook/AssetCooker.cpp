@@ -0,0 +1,231 @@
+#include "AssetCooker.h"
+
+#include <Framework/Debug/Debug.hpp>
+#include <Framework/Cryptography/Hash.hpp>
+#include <Framework/Graphics/ShaderCompiler.hpp>
+#include <Framework/Platform/MappedFile.hpp>
+#include <Framework/Platform/OperatingSystem.hpp>
+#include <Framework/Text/StringBuilder.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+static const char* MANIFEST_PATH = "build/kokoromi-cook.manifest";
+
+static std::string GetExtension(const std::string& filePath)
+{
+	const size_t dot = filePath.find_last_of('.');
+	if (dot == std::string::npos || filePath.find_first_of("/\\", dot) != std::string::npos)
+		return std::string();
+
+	std::string extension = filePath.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return extension;
+}
+
+static void CreateParentDirectories(const std::string& filePath)
+{
+	for (size_t separator = filePath.find_first_of("/\\"); separator != std::string::npos; separator = filePath.find_first_of("/\\", separator + 1))
+	{
+		W::OS::CreateDirectory(filePath.substr(0, separator).c_str());
+	}
+}
+
+static const char* GetResultName(CookResult result)
+{
+	switch (result)
+	{
+	case CookResult::UpToDate: return "up to date";
+	case CookResult::Cooked: return "cooked";
+	case CookResult::Failed: return "FAILED";
+	default: return "unknown";
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                             AssetCooker                              //
+//////////////////////////////////////////////////////////////////////////
+AssetCooker::AssetCooker(uint32_t threadCount)
+	: mThreadPool(threadCount)
+{
+}
+
+AssetCooker::AssetType AssetCooker::GetAssetType(const std::string& filePath)
+{
+	const std::string extension = GetExtension(filePath);
+
+	if (extension == ".fbx" || extension == ".gltf" || extension == ".glb")
+		return AssetType::Scene;
+
+	if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+		return AssetType::Texture;
+
+	if (extension == ".vert" || extension == ".frag" || extension == ".comp" || extension == ".geom" || extension == ".tesc" || extension == ".tese")
+		return AssetType::Shader_GLSL;
+
+	if (extension == ".hlsl")
+		return AssetType::Shader_HLSL;
+
+	return AssetType::Unknown;
+}
+
+bool AssetCooker::CookDirectory(const char* sourceDirectory)
+{
+	using ChronoClock = std::chrono::steady_clock;
+	const ChronoClock::time_point startTime = ChronoClock::now();
+
+	std::vector<std::string> filePaths;
+	W::OS::ListFiles(sourceDirectory, filePaths);
+	std::sort(filePaths.begin(), filePaths.end());
+
+	W::OS::CreateDirectory("build");
+	LoadManifest();
+
+	// The shaders are independent tasks. The scenes are imported one at a time on this thread, the FBX SDK does not
+	// promise more, and each spreads its meshes and textures over the same workers. The loose textures go last, a scene
+	// may reference one of them and two cooks must not write the same .ktex.
+	std::vector<std::string> scenePaths;
+	std::vector<std::string> texturePaths;
+	for (const std::string& filePath : filePaths)
+	{
+		const AssetType type = GetAssetType(filePath);
+		switch (type)
+		{
+		case AssetType::Scene:
+			scenePaths.push_back(filePath);
+			break;
+
+		case AssetType::Texture:
+			texturePaths.push_back(filePath);
+			break;
+
+		case AssetType::Shader_GLSL:
+		case AssetType::Shader_HLSL:
+			mThreadPool.Submit([this, filePath, type]()
+			{
+				AddResult(filePath, CookShader(filePath, type));
+			});
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	for (const std::string& scenePath : scenePaths)
+	{
+		AddResult(scenePath, Scene::Cook(scenePath.c_str(), mThreadPool));
+	}
+
+	for (const std::string& texturePath : texturePaths)
+	{
+		mThreadPool.Submit([this, texturePath]()
+		{
+			AddResult(texturePath, Texture::Cook(texturePath.c_str(), mThreadPool));
+		});
+	}
+
+	mThreadPool.WaitIdle();
+	SaveManifest();
+
+	const float cookTime = std::chrono::duration<float, std::milli>(ChronoClock::now() - startTime).count();
+	W::Logger::PrintFormat("kokoromi-cook - %s: %zu cooked, %zu up to date, %zu failed, %.2f ms on %u threads\n",
+		sourceDirectory, mStats.CookedCount, mStats.UpToDateCount, mStats.FailedCount, cookTime, mThreadPool.GetThreadCount() + 1);
+
+	return mStats.FailedCount == 0;
+}
+
+CookResult AssetCooker::CookShader(const std::string& filePath, AssetType type)
+{
+	const std::string outputPath = "build/" + filePath + ".spv";
+
+	W::StringBuilder commandLine;
+	if (type == AssetType::Shader_HLSL)
+	{
+		W::ShaderCompiler::GetCommandLine_SPIRV_DXC(filePath.c_str(), outputPath.c_str(), commandLine);
+	}
+	else
+	{
+		W::ShaderCompiler::GetCommandLine_SPIRV_GLSLC(filePath.c_str(), outputPath.c_str(), commandLine);
+	}
+
+	// keyed by the source and the compiler command line, #includes are not followed
+	uint64_t sourceHash = W::Hash::EmptyHash64;
+	{
+		W::MappedFile sourceFile;
+		if (sourceFile.Open(filePath.c_str()) == false)
+			return CookResult::Failed;
+
+		sourceHash = W::Hash::DataHash64(sourceFile.Data(), sourceFile.Size());
+	}
+	sourceHash = W::Hash::StringHash64(commandLine.Text(), sourceHash);
+
+	{
+		std::lock_guard<std::mutex> lock(mManifestMutex);
+		auto it = mShaderManifest.find(outputPath);
+		if (it != mShaderManifest.end() && it->second == sourceHash && W::MappedFile().Open(outputPath.c_str()))
+			return CookResult::UpToDate;
+	}
+
+	CreateParentDirectories(outputPath);
+	if (W::ShaderCompiler::Compile(filePath.c_str(), commandLine.Text()) == false)
+		return CookResult::Failed;
+
+	std::lock_guard<std::mutex> lock(mManifestMutex);
+	mShaderManifest[outputPath] = sourceHash;
+	return CookResult::Cooked;
+}
+
+void AssetCooker::AddResult(const std::string& filePath, CookResult result)
+{
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	switch (result)
+	{
+	case CookResult::UpToDate: ++mStats.UpToDateCount; break;
+	case CookResult::Cooked: ++mStats.CookedCount; break;
+	case CookResult::Failed: ++mStats.FailedCount; break;
+	}
+
+	W::Logger::PrintFormat("kokoromi-cook - %s %s\n", filePath.c_str(), GetResultName(result));
+}
+
+//////////////////////////////////////////////////////////////////////////
+//                               Manifest                               //
+//////////////////////////////////////////////////////////////////////////
+// One "<hash> <output path>" line per compiled shader
+void AssetCooker::LoadManifest()
+{
+	std::ifstream file(MANIFEST_PATH);
+	if (file.is_open() == false)
+		return;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		unsigned long long hash = 0;
+		char outputPath[1024] = {};
+		if (sscanf(line.c_str(), "%llx %1023[^\n]", &hash, outputPath) == 2)
+		{
+			mShaderManifest[outputPath] = static_cast<uint64_t>(hash);
+		}
+	}
+}
+
+void AssetCooker::SaveManifest()
+{
+	std::vector<std::pair<std::string, uint64_t>> entries(mShaderManifest.begin(), mShaderManifest.end());
+	std::sort(entries.begin(), entries.end());
+
+	std::ofstream file(MANIFEST_PATH, std::ios::trunc);
+	Debug_AssertMsg(file.is_open(), "failed to write %s", MANIFEST_PATH);
+
+	char hashText[32];
+	for (const std::pair<std::string, uint64_t>& entry : entries)
+	{
+		snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(entry.second));
+		file << hashText << ' ' << entry.first << '\n';
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <kokoromi/Scene.h>
+
+#include <Framework/Threading/ThreadPool.hpp>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Cooks the FBX and glTF scenes, textures and shaders of a source directory into build/, where the application loads them from.
+// Every output is keyed by the content of its source and the cook settings, unchanged assets are skipped.
+class AssetCooker
+{
+private:
+	enum class AssetType
+	{
+		Scene,
+		Texture,
+		Shader_GLSL,
+		Shader_HLSL,
+		Unknown,
+	};
+
+	struct CookStats
+	{
+		size_t UpToDateCount = 0;
+		size_t CookedCount = 0;
+		size_t FailedCount = 0;
+	};
+
+	W::ThreadPool mThreadPool;
+
+	// SPIR-V has nowhere to keep the source hash, the shaders keep theirs in the manifest instead
+	std::mutex mManifestMutex;
+	std::unordered_map<std::string, uint64_t> mShaderManifest;
+
+	std::mutex mStatsMutex;
+	CookStats mStats;
+
+public:
+	// threadCount 0 uses one worker per hardware thread, minus the calling thread
+	explicit AssetCooker(uint32_t threadCount);
+
+	// Paths are relative to the working directory, the same one the application runs from.
+	// Returns false when one of the assets failed to cook.
+	bool CookDirectory(const char* sourceDirectory);
+
+private:
+	static AssetType GetAssetType(const std::string& filePath);
+
+	CookResult CookShader(const std::string& filePath, AssetType type);
+	void AddResult(const std::string& filePath, CookResult result);
+
+	void LoadManifest();
+	void SaveManifest();
+};
@@ -0,0 +1,52 @@
+// kokoromi
+#include "cook/AssetCooker.h"
+
+#include <Framework/Debug/Logger.hpp>
+
+// C RunTime Header Files
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage()
+{
+	W::Logger::Print(
+		"usage: kokoromi-cook [-j <threads>] <source directory>\n"
+		"\n"
+		"  -j <threads>  worker threads, one per hardware thread by default\n"
+		"\n"
+		"Cooks the scenes (.fbx, .gltf, .glb), textures and shaders under the source directory into build/.\n"
+		"Run it from the working directory of the application, e.g. kokoromi-cook Data\n");
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t threadCount = 0;
+	const char* sourceDirectory = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			const int workerCount = atoi(argv[++i]);
+			threadCount = (workerCount > 0) ? static_cast<uint32_t>(workerCount) : 0;
+		}
+		else if (sourceDirectory == nullptr && argv[i][0] != '-')
+		{
+			sourceDirectory = argv[i];
+		}
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (sourceDirectory == nullptr)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	AssetCooker cooker(threadCount);
+	return cooker.CookDirectory(sourceDirectory) ? EXIT_SUCCESS : EXIT_FAILURE;
+}